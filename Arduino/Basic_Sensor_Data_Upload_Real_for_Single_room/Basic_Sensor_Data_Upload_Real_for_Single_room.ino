@@ -2,111 +2,197 @@
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 #include <Wire.h>
+#include <LittleFS.h>
+
+// 日志级别：LOG_LEVEL_DEBUG输出每次采样、上传和收到的帧；发布版本改为LOG_LEVEL_WARN
+#define LOG_LEVEL LOG_LEVEL_INFO
+#include <logging.h>
+
+// 多房间集线器模式：一块板通过TCA9548A驱动多组传感器，所有房间合并成一帧上传（房间表见hub.h）
+#define HUB_MODE false
+
+#include <telemetry.h>
+#include "sample_buffer.h"
 #include "sensor.h"
+#include "offline_queue.h"
+#include "binary_frame.h"
+#include "report_policy.h"
+#if HUB_MODE
+#include "hub.h"
+#endif
+#include "wifi_manager.h"
 #include "network.h"
+#include "power.h"
 
-// 传感器数据读取频率控制
-#define SENSOR_READ_INTERVAL 15000  // 15秒读取一次传感器
-unsigned long lastSensorReadTime = 0;
+// 基准测试模式：在实际硬件上测量传感器、JSON、WS2812和WS往返耗时，串口输出BENCH报告，不进入正常上报流程
+#define BENCHMARK_MODE false
+#if BENCHMARK_MODE
+#if POWER_MODE == POWER_MODE_DEEP_SLEEP
+#error "基准测试模式需要POWER_MODE_ALWAYS_ON"
+#endif
+#include "benchmark.h"
+#endif
 
-#define SENSOR_INTERVAL 15000 // 15秒发送一次
-unsigned long lastSensorTime = 0;
+#if HUB_MODE && (POWER_MODE != POWER_MODE_ALWAYS_ON || BENCHMARK_MODE)
+#error "集线器模式需要POWER_MODE_ALWAYS_ON，且不支持基准测试模式"
+#endif
 
 void setup() {
   Serial.begin(115200);
   delay(200);
   
-  Serial.println("============================================================");
-  Serial.printf("🌡️ ESP8266 IoT Sensor Node - Room: %s Only\n", TARGET_ROOM);
-  Serial.println("============================================================");
+  // 深度睡眠模式下先关闭射频
+  beginPowerMode();
+  
+  LOG_INFO("============================================================\n");
+  #if HUB_MODE
+  LOG_INFO("🌡️ ESP8266 IoT Sensor Hub - %u Rooms\n", HUB_ROOM_COUNT);
+  #else
+  LOG_INFO("🌡️ ESP8266 IoT Sensor Node - Room: %s Only\n", TARGET_ROOM);
+  #endif
+  LOG_INFO("============================================================\n");
 
   // 初始化I2C和传感器
   Wire.begin();
   
-  Serial.println("\n=== ESP8266 传感器初始化 ===");
+  LOG_INFO("\n=== ESP8266 传感器初始化 ===\n");
   
   // 扫描I2C设备
   scanI2CDevices();
   
-  // 初始化传感器
+  // 初始化遥测（传感器通道在initSensors()/initHub()中注册）
+  initTelemetry();
+  
+  // 初始化传感器；集线器模式按房间表探测各通道
+  #if HUB_MODE
+  initHub();
+  #else
   initSensors();
+  #endif
+  
+  // 挂载文件系统并初始化离线上传队列
+  mountFileSystem();
+  initOfflineQueue();
   
   // 首次读取传感器数据
-  Serial.println("📊 首次读取传感器数据...");
+  LOG_INFO("📊 首次读取传感器数据...\n");
+  #if HUB_MODE
+  bool initialRead = readAllHubRooms();
+  #else
   bool initialRead = readAllSensors();
   
+  // setup阶段等待异步测量（AHT21）完成，确保首次上传有完整数据
+  while (sensorsBusy()) {
+    if (runSensorScheduler()) {
+      initialRead = true;
+    }
+    yield();
+  }
+  #endif
+  
   if (initialRead) {
-    Serial.println("✅ 传感器初始化成功，将使用真实传感器数据");
+    LOG_INFO("✅ 传感器初始化成功，将使用真实传感器数据\n");
+    #if HUB_MODE
+    printHubData();
+    #else
     printAllSensorData();
+    #endif
   } else {
-    Serial.println("⚠️ 传感器初始化失败，将使用模拟数据作为备用");
+    LOG_WARN("⚠️ 传感器初始化失败，将使用模拟数据作为备用\n");
   }
   
-  Serial.println("\n=== 网络连接 ===");
+  initDeviceId();
   
-  // 连接WiFi
-  connectWiFi();
+  #if BENCHMARK_MODE
+  runBenchmark();
+  #endif
   
-  if (wifiConnected) {
-    Serial.println("⏳ 等待3秒后初始化WebSocket连接...");
-    delay(3000);
-    initWebSocket();
-  } else {
-    Serial.println("❌ WiFi连接失败，无法上传数据");
-  }
+  #if POWER_MODE == POWER_MODE_DEEP_SLEEP
+  // 深度睡眠模式：暂存读数、按需上报后直接睡眠，不进入loop()
+  runDeepSleepCycle();
+  #endif
+  
+  LOG_INFO("\n=== 网络连接 ===\n");
+  
+  // 开始连接WiFi（不等待），连上后WebSocket在loop()中自动建立连接
+  initWiFiManager();
+  initWebSocket();
   
-  Serial.println("\n=== 初始化完成 ===");
-  Serial.printf("📍 目标房间: %s\n", TARGET_ROOM);
-  Serial.printf("🌡️ 传感器状态: %s\n", g_sensor_data_valid ? "真实数据可用" : "仅模拟数据");
-  Serial.printf("📶 网络状态: %s\n", wifiConnected ? "已连接" : "未连接");
-  Serial.println("============================================================\n");
+  LOG_INFO("\n=== 初始化完成 ===\n");
+  LOG_INFO("📍 目标房间: %s\n", NODE_LOCATION);
+  LOG_INFO("🌡️ 传感器状态: %s\n", g_sensor_data_valid ? "真实数据可用" : "仅模拟数据");
+  LOG_INFO("📶 网络状态: %s\n", wifiConnected ? "已连接" : "连接中");
+  LOG_INFO("============================================================\n\n");
 }
 
 void loop() {
-  // 检查WiFi连接状态
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("❌ WiFi lost, reconnecting...");
-    connectWiFi();
-    return;
-  }
-  
-  // 处理WebSocket通信
-  webSocket.loop();
+  telemetryLoopBegin();
 
-  // 定期读取传感器数据（每5秒一次）
-  if (millis() - lastSensorReadTime >= SENSOR_READ_INTERVAL) {
-    Serial.println("\n📊 ===== 定期传感器读取 =====");
-    
-    bool readSuccess = readAllSensors();
+  // 传感器调度：各传感器按自己的采样周期读取（不阻塞）
+  #if HUB_MODE
+  runHubScheduler();
+  const char* reportReason = checkHubReportTrigger();
+  #else
+  runSensorScheduler();
+  const char* reportReason = checkReportTrigger();
+  #endif
+
+  // 读数变化超出死区或静默超时时上传，未连接时存入离线队列
+  if (reportReason) {
+    LOG_DEBUG("\n📤 ===== 数据上传 (%s) =====\n", reportReason);
     
-    if (readSuccess) {
-      Serial.println("✅ 传感器读取成功");
-      printAllSensorData();
-    } else {
-      Serial.println("⚠️ 传感器读取失败，保持上次数据");
+    #if HUB_MODE
+    // 所有房间合并成一帧，没有任何房间发出时下一轮继续尝试
+    if (sendHubData()) {
+      markHubReported();
+    }
+    #else
+    // 省电模式下运动事件提前打开射频
+    if (strcmp(reportReason, "motion") == 0) {
+      requestRadioWake();
     }
-    
-    lastSensorReadTime = millis();
-    Serial.println("================================\n");
-  }
-
-  // 定期发送传感器数据到服务器（每30秒一次）
-  if (wsConnected && (millis() - lastSensorTime >= SENSOR_INTERVAL)) {
-    Serial.println("\n📤 ===== 数据上传周期 =====");
     
     // 发送传感器数据
     sendSensorData();
-    lastSensorTime = millis();
+    markReported();
+    #endif
     
-    Serial.println("============================\n");
+    LOG_DEBUG("============================\n\n");
   }
 
-  // 每10秒发送一次ping来维持连接
-  static unsigned long lastPingTime = 0;
-  if (wsConnected && (millis() - lastPingTime >= 10000)) {
+  // 省电模式下射频睡眠期间跳过网络处理，读数已进入离线队列
+  if (!updatePowerManager()) {
+    telemetryLoopEnd();
+    delay(100);
+    return;
+  }
+
+  // 推进WiFi连接状态机；关联期间传感器采样和离线缓存照常进行
+  if (!wifiManagerLoop()) {
+    telemetryLoopEnd();
+    delay(100);
+    return;
+  }
+  
+  // 处理WebSocket通信
+  webSocket.loop();
+  
+  // 连接建立后的首次上传等延后任务
+  runConnectionTasks();
+  
+  // 重连后限速补传离线数据
+  drainOfflineQueue();
+
+  // 保活由协议层心跳负责，链路空闲时才补发应用层ping
+  if (wsConnected && linkIdle()) {
     sendPing();
-    lastPingTime = millis();
   }
 
+  // 周期性遥测
+  if (wsConnected && telemetryDue()) {
+    sendTelemetry();
+  }
+
+  telemetryLoopEnd();
   delay(100);
-}
\ No newline at end of file
+}
@@ -0,0 +1,384 @@
+// 基准测试模式（BENCHMARK_MODE）：在实际硬件上测量固件热点路径的耗时
+// 直接调用sensor.h / network.h中的真实代码，setup()进入runBenchmark()后不再返回
+// 基准测试随本ESP8266固件一起编译，只支持ESP8266（用到ESP.getCoreVersion()等ESP8266专有接口）
+//
+// 每轮输出一份固定格式的报告，每个指标一行，便于脚本对比不同固件版本：
+//   BENCH_BEGIN round=1 board=esp8266 cpu_mhz=80 flash_hz=40000000 core=... sketch_md5=... free_heap=...
+//   BENCH name=<指标> unit=us n=<样本数> errors=<失败次数> min=... p50=... mean=... max=... [bytes=...]
+//   BENCH_END round=1 duration_ms=...
+// 报告直接写串口，不受LOG_LEVEL影响；建议配合LOG_LEVEL_WARN，避免被测代码的日志混进计时
+//
+// WS往返测试会向IoT服务发送真实的ping和data_update帧，服务器会记录这些读数
+
+#include <Adafruit_NeoPixel.h>
+
+#define BENCH_ITERATIONS 32             // 每个指标最多保留的样本数
+#define BENCH_SENSOR_ITERATIONS 10
+#define BENCH_SENSOR_SPACING_MS 1100    // ENS160每秒更新一次，间隔略大于1s保证每次都读到新数据
+#define BENCH_RTT_ITERATIONS 20
+#define BENCH_RTT_TIMEOUT_MS 2000
+#define BENCH_CONNECT_TIMEOUT_MS 20000
+#define BENCH_SETTLE_MS 500             // 连接/订阅后等待init等帧收完，避免混入往返计时
+#define BENCH_REPEAT_INTERVAL_MS 60000
+
+// GPIO4是I2C的SDA，不能和家具固件一样用D2，改用GPIO14 (D5)；没有接灯带时输出时间不变
+#define BENCH_WS2812_PIN 14
+#define BENCH_WS2812_COUNT 12
+
+#define BENCH_BOARD "esp8266"
+
+struct BenchResult {
+  uint32_t samples[BENCH_ITERATIONS];
+  uint8_t count;
+  uint8_t errors;
+};
+
+BenchResult g_bench_result;
+BenchResult g_bench_sensor_active[SENSOR_DRIVER_COUNT];
+BenchResult g_bench_sensor_latency[SENSOR_DRIVER_COUNT];
+
+// IoT服务对data_update的典型回复，用于测量入站解析
+static const char BENCH_CONTROL_RESULTS[] PROGMEM =
+  "{\"type\":\"control_results\",\"results\":[{\"status\":\"success\",\"device\":\"sensors\","
+  "\"location\":\"living_room\",\"action\":\"data_update\",\"parameters\":{\"temperature\":23.41,"
+  "\"humidity\":54.87,\"co2\":452,\"voc\":18,\"light_level\":312,\"motion\":false,"
+  "\"device_id\":\"AA:BB:CC:DD:EE:FF\",\"source\":\"esp8266_real_sensors\",\"data_type\":\"real\","
+  "\"timestamp\":123456},\"current_state\":{\"temperature\":23.4,\"humidity\":54.9,\"co2\":452,"
+  "\"voc\":18,\"light_level\":312,\"motion\":false,\"last_update\":\"2025-01-01T12:00:00\","
+  "\"source\":\"esp8266_real_sensors\",\"device_id\":\"AA:BB:CC:DD:EE:FF\",\"real_data\":true,"
+  "\"last_real_update\":1735732800.12}}],\"timestamp\":1735732800.13}";
+
+// 解析会原地修改输入（zero-copy），每次计时前先复制到这里
+char g_bench_scratch[TX_BUFFER_SIZE];
+StaticJsonDocument<1536> g_bench_doc;
+
+Adafruit_NeoPixel g_bench_strip(BENCH_WS2812_COUNT, BENCH_WS2812_PIN, NEO_GRB + NEO_KHZ800);
+
+void benchReset(BenchResult& result) {
+  result.count = 0;
+  result.errors = 0;
+}
+
+void benchAdd(BenchResult& result, uint32_t elapsed_us, bool ok) {
+  if (result.count < BENCH_ITERATIONS) {
+    result.samples[result.count++] = elapsed_us;
+  }
+  if (!ok) {
+    result.errors++;
+  }
+}
+
+// 输出一行指标；样本原地排序取中位数
+void benchReport(const char* name, BenchResult& result, size_t bytes) {
+  uint8_t n = result.count;
+  if (n == 0) {
+    Serial.printf_P(PSTR("BENCH name=%s unit=us n=0 errors=%u\n"), name, result.errors);
+    return;
+  }
+
+  uint32_t* s = result.samples;
+  uint64_t total = 0;
+  for (uint8_t i = 1; i < n; i++) {
+    uint32_t value = s[i];
+    int8_t j = i - 1;
+    while (j >= 0 && s[j] > value) {
+      s[j + 1] = s[j];
+      j--;
+    }
+    s[j + 1] = value;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    total += s[i];
+  }
+
+  Serial.printf_P(PSTR("BENCH name=%s unit=us n=%u errors=%u min=%u p50=%u mean=%u max=%u"),
+                  name, n, result.errors, s[0], s[n / 2], (uint32_t)(total / n), s[n - 1]);
+  if (bytes) {
+    Serial.printf_P(PSTR(" bytes=%u"), bytes);
+  }
+  Serial.print('\n');
+}
+
+// 保持WiFi/WS状态机运转，期间不计时
+void benchService(unsigned long duration_ms) {
+  unsigned long start = millis();
+  while (millis() - start < duration_ms) {
+    if (wifiManagerLoop()) {
+      webSocket.loop();
+    }
+    yield();
+  }
+}
+
+// ===== 传感器 =====
+// active  - start/poll/read调用本身的耗时之和（I2C事务 + 换算），即占用loop()的时间
+// latency - 从触发测量到拿到数据的总时间，异步传感器包含转换等待（AHT21约80ms）
+void benchSensorOnce(size_t i) {
+  const SensorDriver& driver = SENSOR_DRIVERS[i];
+  uint32_t active = 0;
+  uint32_t begin = micros();
+  bool ok = true;
+
+  if (driver.start) {
+    uint32_t t = micros();
+    ok = driver.start();
+    active += micros() - t;
+
+    while (ok && driver.poll) {
+      t = micros();
+      SensorPollResult result = driver.poll();
+      active += micros() - t;
+      if (result != SENSOR_PENDING) {
+        ok = result == SENSOR_OK;
+        break;
+      }
+      yield();
+    }
+  }
+
+  if (ok && driver.read) {
+    uint32_t t = micros();
+    ok = driver.read();
+    active += micros() - t;
+  }
+
+  benchAdd(g_bench_sensor_active[i], active, ok);
+  benchAdd(g_bench_sensor_latency[i], micros() - begin, ok);
+}
+
+void benchSensors() {
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    benchReset(g_bench_sensor_active[i]);
+    benchReset(g_bench_sensor_latency[i]);
+  }
+
+  for (uint8_t k = 0; k < BENCH_SENSOR_ITERATIONS; k++) {
+    unsigned long start = millis();
+    for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+      benchSensorOnce(i);
+    }
+    unsigned long elapsed = millis() - start;
+    if (elapsed < BENCH_SENSOR_SPACING_MS) {
+      benchService(BENCH_SENSOR_SPACING_MS - elapsed);
+    }
+  }
+
+  char name[32];
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    snprintf(name, sizeof(name), "sensor.%s.active", SENSOR_DRIVERS[i].name);
+    benchReport(name, g_bench_sensor_active[i], 0);
+    if (SENSOR_DRIVERS[i].start) {
+      snprintf(name, sizeof(name), "sensor.%s.latency", SENSOR_DRIVERS[i].name);
+      benchReport(name, g_bench_sensor_latency[i], 0);
+    }
+  }
+  markSensorUpdated();
+}
+
+// ===== JSON =====
+// 与buildSensorDataMessage()内容相同的ArduinoJson版本，作为snprintf路径的对照
+size_t benchSerializeUpload(bool withStats) {
+  g_bench_doc.clear();
+  g_bench_doc["type"] = "control";
+  JsonObject command = g_bench_doc["commands"].createNestedObject();
+  command["device"] = "sensors";
+  command["action"] = "data_update";
+  command["location"] = TARGET_ROOM;
+  JsonObject parameters = command.createNestedObject("parameters");
+  parameters["temperature"] = g_temperature;
+  parameters["humidity"] = g_humidity;
+  parameters["co2"] = g_co2;
+  parameters["voc"] = g_voc;
+  parameters["light_level"] = g_light_level;
+  parameters["motion"] = g_motion;
+  parameters["device_id"] = g_device_id;
+  parameters["source"] = g_sensor_data_valid ? "esp8266_real_sensors" : "esp8266_simulated";
+  parameters["data_type"] = g_sensor_data_valid ? "real" : "simulated";
+  parameters["timestamp"] = millis();
+
+  if (withStats) {
+    JsonObject statsObject = parameters.createNestedObject("stats");
+    for (int i = 0; i < SAMPLE_FIELD_COUNT; i++) {
+      WindowStats stats;
+      if (!getWindowStats((SampleField)i, stats)) {
+        continue;
+      }
+      JsonObject field = statsObject.createNestedObject(SAMPLE_FIELD_NAMES[i]);
+      field["min"] = stats.min;
+      field["max"] = stats.max;
+      field["mean"] = stats.mean;
+      field["last"] = stats.last;
+      field["n"] = stats.count;
+      field["span_ms"] = stats.span_ms;
+    }
+  }
+  return serializeJson(g_bench_doc, g_bench_scratch, sizeof(g_bench_scratch));
+}
+
+void benchJson() {
+  // 上传帧：实际使用的snprintf路径
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_ITERATIONS; k++) {
+    uint32_t t = micros();
+    buildSensorDataMessage(g_temperature, g_humidity, g_co2, g_voc, g_light_level, g_motion, true);
+    benchAdd(g_bench_result, micros() - t, !g_tx_overflow);
+  }
+  benchReport("json.upload.build", g_bench_result, g_tx_len);
+
+  // 上传帧：ArduinoJson构建 + 序列化
+  size_t length = 0;
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_ITERATIONS; k++) {
+    uint32_t t = micros();
+    length = benchSerializeUpload(true);
+    benchAdd(g_bench_result, micros() - t, length > 0 && !g_bench_doc.overflowed());
+  }
+  benchReport("json.upload.serialize_arduinojson", g_bench_result, length);
+
+  // 上传帧解析（服务器或其他节点收到control帧时的工作量），不带过滤器
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_ITERATIONS; k++) {
+    memcpy(g_bench_scratch, g_tx_buffer, g_tx_len);
+    uint32_t t = micros();
+    DeserializationError error = deserializeJson(g_bench_doc, g_bench_scratch, g_tx_len);
+    benchAdd(g_bench_result, micros() - t, !error);
+  }
+  benchReport("json.upload.parse", g_bench_result, g_tx_len);
+
+  // 入站control_results：完整的handleMessage()，包括过滤解析和分发
+  initInboundFilter();
+  size_t replyLength = strlen_P(BENCH_CONTROL_RESULTS);
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_ITERATIONS; k++) {
+    memcpy_P(g_bench_scratch, BENCH_CONTROL_RESULTS, replyLength + 1);
+    uint32_t t = micros();
+    handleMessage(g_bench_scratch, replyLength);
+    benchAdd(g_bench_result, micros() - t, true);
+  }
+  benchReport("json.control_results.handle", g_bench_result, replyLength);
+}
+
+// ===== WS2812 =====
+// show()关中断逐位输出，12颗约360us；两次show之间等待锁存时间，不把等待算进去
+void benchStrip() {
+  g_bench_strip.begin();
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_ITERATIONS; k++) {
+    uint32_t color = g_bench_strip.Color(k * 8, 255 - k * 8, k & 1 ? 64 : 0);
+    for (int i = 0; i < BENCH_WS2812_COUNT; i++) {
+      g_bench_strip.setPixelColor(i, color);
+    }
+    delay(1);
+    uint32_t t = micros();
+    g_bench_strip.show();
+    benchAdd(g_bench_result, micros() - t, true);
+  }
+  g_bench_strip.clear();
+  g_bench_strip.show();
+  benchReport("ws2812.show12", g_bench_result, 0);
+}
+
+// ===== WebSocket往返 =====
+bool benchConnect(uint32_t& elapsed_ms) {
+  unsigned long start = millis();
+  initWiFiManager();
+  initWebSocket();
+  while (!wsConnected && millis() - start < BENCH_CONNECT_TIMEOUT_MS) {
+    if (wifiManagerLoop()) {
+      webSocket.loop();
+    }
+    yield();
+  }
+  elapsed_ms = millis() - start;
+  if (!wsConnected) {
+    return false;
+  }
+
+  // 只订阅本房间的device_update，往返计时期间不会收到别的广播
+  sendSubscribe();
+  benchService(BENCH_SETTLE_MS);
+  return true;
+}
+
+// 发送g_tx_buffer中的帧，等待下一个文本帧到达
+bool benchRoundTrip(uint32_t& elapsed_us) {
+  uint32_t before = g_rx_text_frames;
+  uint32_t start = micros();
+  if (!txSend()) {
+    return false;
+  }
+
+  unsigned long deadline = millis() + BENCH_RTT_TIMEOUT_MS;
+  while (g_rx_text_frames == before) {
+    if ((long)(millis() - deadline) >= 0) {
+      return false;
+    }
+    webSocket.loop();
+    yield();
+  }
+  elapsed_us = micros() - start;
+  return true;
+}
+
+void benchRoundTrips() {
+  // 应用层ping -> pong
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_RTT_ITERATIONS; k++) {
+    txBegin();
+    txAppend("{\"type\":\"ping\",\"device_id\":\"%s\",\"location\":\"%s\",\"timestamp\":%lu}",
+             g_device_id, TARGET_ROOM, millis());
+    uint32_t elapsed = 0;
+    bool ok = benchRoundTrip(elapsed);
+    benchAdd(g_bench_result, elapsed, ok);
+    benchService(20);
+  }
+  benchReport("ws.rtt.ping", g_bench_result, 0);
+
+  // data_update -> control_results，包含服务器处理和sensor_update广播
+  benchReset(g_bench_result);
+  for (uint8_t k = 0; k < BENCH_RTT_ITERATIONS; k++) {
+    buildSensorDataMessage(g_temperature, g_humidity, g_co2, g_voc, g_light_level, g_motion, true);
+    uint32_t elapsed = 0;
+    bool ok = benchRoundTrip(elapsed);
+    benchAdd(g_bench_result, elapsed, ok);
+    benchService(20);
+  }
+  benchReport("ws.rtt.data_update", g_bench_result, g_tx_len);
+}
+
+void runBenchmark() {
+  uint32_t round = 0;
+  bool connectReported = false;
+
+  for (;;) {
+    round++;
+    unsigned long roundStart = millis();
+    Serial.printf_P(PSTR("BENCH_BEGIN round=%u board=" BENCH_BOARD " cpu_mhz=%u flash_hz=%u core=%s sketch_md5=%s free_heap=%u\n"),
+                    round, ESP.getCpuFreqMHz(), ESP.getFlashChipSpeed(), ESP.getCoreVersion().c_str(),
+                    ESP.getSketchMD5().c_str(), ESP.getFreeHeap());
+
+    benchSensors();
+    benchJson();
+    benchStrip();
+
+    if (!connectReported) {
+      uint32_t connectMs = 0;
+      bool ok = benchConnect(connectMs);
+      benchReset(g_bench_result);
+      benchAdd(g_bench_result, connectMs * 1000, ok);
+      benchReport("ws.connect", g_bench_result, 0);
+      connectReported = true;
+    }
+
+    if (wsConnected) {
+      benchRoundTrips();
+    } else {
+      benchReset(g_bench_result);
+      benchReport("ws.rtt.ping", g_bench_result, 0);
+      benchReport("ws.rtt.data_update", g_bench_result, 0);
+    }
+
+    Serial.printf_P(PSTR("BENCH_END round=%u duration_ms=%lu\n"), round, millis() - roundStart);
+    benchService(BENCH_REPEAT_INTERVAL_MS);
+  }
+}
@@ -0,0 +1,108 @@
+// 二进制传感器帧（WStype_BIN）
+// 26字节小端头部 + 上传窗口统计，取代约700字节的JSON上传；解码器在services/iot/app.py的decode_sensor_frame
+// 服务器在init消息的capabilities中声明支持的版本和房间ID表，协商成功后才使用二进制帧
+// 版本2：光照按SAMPLE_LIGHT的定点值（2lux）编码，头部后追加与JSON "stats"相同内容的窗口统计
+
+#define ENABLE_BINARY_FRAMES true   // 服务器支持时改用二进制帧上传
+
+#define SENSOR_FRAME_VERSION 2
+
+// sensor_bitmap / stats_bitmap：本帧中有效的字段，第i位对应SampleField i
+#define FRAME_HAS_TEMPERATURE 0x01
+#define FRAME_HAS_HUMIDITY 0x02
+#define FRAME_HAS_CO2 0x04
+#define FRAME_HAS_VOC 0x08
+#define FRAME_HAS_LIGHT 0x10
+#define FRAME_HAS_MOTION 0x20
+
+// flags
+#define FRAME_FLAG_REAL_DATA 0x01   // 真实传感器数据（否则为模拟数据）
+#define FRAME_FLAG_MOTION 0x02      // 窗口内检测到运动
+
+struct __attribute__((packed)) SensorFrame {
+  uint8_t version;        // SENSOR_FRAME_VERSION
+  uint8_t room_id;        // init消息中rooms数组的下标
+  uint16_t seq;           // 帧序号，服务器据此发现丢帧
+  uint8_t sensor_bitmap;
+  uint8_t flags;
+  int16_t temperature;    // 0.01°C
+  uint16_t humidity;      // 0.01%
+  uint16_t co2;           // ppm
+  uint16_t voc;           // ppb
+  uint16_t light_level;   // 2lux（SAMPLE_LIGHT定点值）
+  uint32_t timestamp;     // millis()
+  uint8_t mac[6];
+};
+static_assert(sizeof(SensorFrame) == 26, "SensorFrame布局必须与服务器解码器一致");
+
+// 头部之后：1字节stats_bitmap，随后按字段顺序为每个置位字段追加一个FrameFieldStats
+// 数值为sample_buffer.h的定点值（温度按int16解释），均值由服务器用sum / count还原
+struct __attribute__((packed)) FrameFieldStats {
+  uint16_t min;
+  uint16_t max;
+  uint16_t last;
+  int32_t sum;
+  uint8_t count;
+  uint32_t span_ms;
+};
+static_assert(sizeof(FrameFieldStats) == 15, "FrameFieldStats布局必须与服务器解码器一致");
+static_assert(FRAME_HAS_MOTION == 1 << SAMPLE_MOTION, "帧字段位必须与SampleField顺序一致");
+
+#define SENSOR_FRAME_MAX_SIZE (sizeof(SensorFrame) + 1 + SAMPLE_FIELD_COUNT * sizeof(FrameFieldStats))
+
+// 在头部之后写入窗口统计，withStats为false时只写空的stats_bitmap；返回写入的字节数
+size_t appendFrameStats(uint8_t* out, bool withStats) {
+  uint8_t* bitmap = out;
+  size_t len = 1;
+  *bitmap = 0;
+  for (int i = 0; withStats && i < SAMPLE_FIELD_COUNT; i++) {
+    WindowRaw raw;
+    if (!getWindowRaw((SampleField)i, raw)) {
+      continue;
+    }
+    FrameFieldStats stats;
+    stats.min = (uint16_t)raw.min;
+    stats.max = (uint16_t)raw.max;
+    stats.last = (uint16_t)raw.last;
+    stats.sum = raw.sum;
+    stats.count = raw.count;
+    stats.span_ms = raw.span_ms;
+    memcpy(out + len, &stats, sizeof(stats));
+    len += sizeof(stats);
+    *bitmap |= 1 << i;
+  }
+  return len;
+}
+
+// 协商得到的房间ID，-1表示服务器不支持二进制帧，继续使用JSON
+int g_binary_room_id = -1;
+uint16_t g_sensor_frame_seq = 0;
+
+bool binaryFramesActive() {
+  #if ENABLE_BINARY_FRAMES
+  return g_binary_room_id >= 0;
+  #else
+  return false;
+  #endif
+}
+
+// 根据init消息的capabilities协商二进制帧
+void negotiateBinaryFrames(JsonVariantConst capabilities, const char* room) {
+  g_binary_room_id = -1;
+
+  #if ENABLE_BINARY_FRAMES
+  if (capabilities["binary_sensor_frame"].as<int>() != SENSOR_FRAME_VERSION) {
+    return;
+  }
+
+  int index = 0;
+  for (JsonVariantConst name : capabilities["rooms"].as<JsonArrayConst>()) {
+    const char* roomName = name.as<const char*>();
+    if (roomName && strcmp(roomName, room) == 0) {
+      g_binary_room_id = index;
+      break;
+    }
+    index++;
+  }
+  #endif
+}
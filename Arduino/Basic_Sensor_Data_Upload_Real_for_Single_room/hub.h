@@ -0,0 +1,458 @@
+// 多房间集线器模式（HUB_MODE）
+// 一个ESP8266通过TCA9548A I2C多路复用器驱动多组传感器，每个通道对应一个房间
+// 各通道上的传感器地址相同（AHT21 0x38、ENS160 0x53、VEML7700 0x10），靠切换通道区分
+// 所有房间的读数合并成一个control帧（每个房间一条data_update命令），通过同一条WebSocket上传
+//
+// 传感器驱动复用sensor.h中的I2C函数，是否编译由ENABLE_AHT21/ENABLE_ENS160/ENABLE_VEML7700决定；
+// 各房间用不用由下面的房间表决定。GL5539和运动检测接在ESP8266本地引脚上，不分房间，集线器模式不上报
+
+#define TCA9548A_ADDR 0x70
+#define TCA9548A_CHANNELS 8
+
+// 通道上的传感器
+enum HubSensorKind {
+  HUB_AHT21,
+  HUB_ENS160,
+  HUB_VEML7700,
+  HUB_SENSOR_KIND_COUNT
+};
+
+#define HUB_SENSOR_AHT21 (1 << HUB_AHT21)
+#define HUB_SENSOR_ENS160 (1 << HUB_ENS160)
+#define HUB_SENSOR_VEML7700 (1 << HUB_VEML7700)
+
+const char* const HUB_SENSOR_NAMES[HUB_SENSOR_KIND_COUNT] = {"AHT21", "ENS160", "VEML7700"};
+const uint8_t HUB_SENSOR_ADDRS[HUB_SENSOR_KIND_COUNT] = {AHT21_ADDR, ENS160_ADDR, VEML7700_ADDR};
+
+#define HUB_MAX_FAILURES 3              // 连续失败次数，超过后该传感器的读数不再上报，直到再次读取成功
+
+struct HubRoomConfig {
+  uint8_t channel;     // TCA9548A通道 0-7
+  const char* room;    // 房间名，即IoT服务的location
+  uint8_t sensors;     // 该通道上接的传感器
+};
+
+// 通道与房间对应表
+const HubRoomConfig HUB_ROOMS[] = {
+  {0, "living_room", HUB_SENSOR_AHT21 | HUB_SENSOR_ENS160},
+  {1, "bedroom", HUB_SENSOR_AHT21 | HUB_SENSOR_ENS160},
+  {2, "kitchen", HUB_SENSOR_AHT21 | HUB_SENSOR_ENS160},
+  {3, "study", HUB_SENSOR_AHT21},
+  {4, "bathroom", HUB_SENSOR_AHT21},
+};
+
+constexpr size_t HUB_ROOM_COUNT = sizeof(HUB_ROOMS) / sizeof(HUB_ROOMS[0]);
+static_assert(HUB_ROOM_COUNT <= TCA9548A_CHANNELS, "房间数超过TCA9548A通道数");
+
+struct HubRoomState {
+  uint8_t present;                 // 启动时在通道上探测到的传感器
+  uint8_t valid;                   // 当前有有效读数的传感器
+  uint8_t failures[HUB_SENSOR_KIND_COUNT];
+  bool aht21_pending;              // AHT21测量进行中
+  uint8_t aht21_busy_retries;
+  bool sync_started;
+  unsigned long last_sync_sample;  // ENS160/VEML7700上次采样时间
+  float temperature;
+  float humidity;
+  int co2;
+  int voc;
+  int light_level;
+  SampleRing rings[SAMPLE_FIELD_COUNT];  // 该房间的采样缓冲区，与单房间模式的g_sample_rings相同
+  ReportSnapshot last_report;
+};
+
+HubRoomState g_hub_rooms[HUB_ROOM_COUNT];
+bool g_hub_mux_ready = false;
+uint8_t g_hub_channel = 0xFF;      // 当前选中的通道，避免重复切换
+int8_t g_hub_telemetry[HUB_SENSOR_KIND_COUNT];
+
+// AHT21在所有通道上同时触发，共用一次测量等待
+bool g_hub_aht21_started = false;
+bool g_hub_aht21_measuring = false;
+unsigned long g_hub_aht21_last_start = 0;
+unsigned long g_hub_aht21_deadline = 0;
+
+// ENS160/VEML7700每次loop最多采样一个房间，把I2C耗时分散到多次loop中
+uint8_t g_hub_cursor = 0;
+
+bool g_hub_has_reported = false;
+unsigned long g_hub_last_report_time = 0;
+
+// 切换TCA9548A通道（一次只打开一个通道）
+bool selectHubChannel(uint8_t channel) {
+  if (channel == g_hub_channel) {
+    return true;
+  }
+  Wire.beginTransmission(TCA9548A_ADDR);
+  Wire.write(1 << channel);
+  if (Wire.endTransmission() != 0) {
+    g_hub_channel = 0xFF;
+    return false;
+  }
+  g_hub_channel = channel;
+  return true;
+}
+
+void resetHubWindows() {
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    resetSampleWindow(g_hub_rooms[i].rings);
+  }
+}
+
+// 上传值：窗口内有样本时取均值，否则取最近一次读数
+float hubFieldValue(const HubRoomState& room, SampleField field, float current) {
+  WindowStats stats;
+  return getWindowStats(room.rings[field], field, stats) ? stats.mean : current;
+}
+
+// 记录一次读取结果，连续失败超过HUB_MAX_FAILURES时停止上报该传感器的旧读数
+void hubSensorResult(size_t i, HubSensorKind kind, bool ok) {
+  HubRoomState& room = g_hub_rooms[i];
+  if (ok) {
+    room.failures[kind] = 0;
+    room.valid |= 1 << kind;
+    return;
+  }
+  if (room.failures[kind] < 255 && ++room.failures[kind] == HUB_MAX_FAILURES) {
+    room.valid &= ~(1 << kind);
+    LOG_WARN("⚠️ 集线器 %s (通道%u) %s 连续读取失败，暂停上报\n",
+             HUB_ROOMS[i].room, HUB_ROOMS[i].channel, HUB_SENSOR_NAMES[kind]);
+  }
+}
+
+void initHub() {
+  LOG_INFO("\n=== 集线器初始化（TCA9548A 0x%02X，%u 个房间）===\n", TCA9548A_ADDR, HUB_ROOM_COUNT);
+
+  Wire.beginTransmission(TCA9548A_ADDR);
+  g_hub_mux_ready = Wire.endTransmission() == 0;
+  if (!g_hub_mux_ready) {
+    LOG_ERROR("❌ 未找到TCA9548A多路复用器，集线器没有可用的传感器\n");
+  }
+
+  for (int kind = 0; kind < HUB_SENSOR_KIND_COUNT; kind++) {
+    g_hub_telemetry[kind] = telemetryAddChannel(HUB_SENSOR_NAMES[kind]);
+  }
+
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    const HubRoomConfig& config = HUB_ROOMS[i];
+    HubRoomState& room = g_hub_rooms[i];
+    memset(&room, 0, sizeof(room));
+
+    if (!g_hub_mux_ready || !selectHubChannel(config.channel)) {
+      continue;
+    }
+
+    // 探测房间表中列出的传感器
+    for (int kind = 0; kind < HUB_SENSOR_KIND_COUNT; kind++) {
+      if (!(config.sensors & (1 << kind))) {
+        continue;
+      }
+      Wire.beginTransmission(HUB_SENSOR_ADDRS[kind]);
+      if (Wire.endTransmission() == 0) {
+        room.present |= 1 << kind;
+      } else {
+        LOG_WARN("⚠️ 通道%u (%s) 未找到 %s\n", config.channel, config.room, HUB_SENSOR_NAMES[kind]);
+      }
+    }
+
+    LOG_INFO("🔀 通道%u → %s: AHT21 %s, ENS160 %s, VEML7700 %s\n", config.channel, config.room,
+             (room.present & HUB_SENSOR_AHT21) ? "✅" : "-",
+             (room.present & HUB_SENSOR_ENS160) ? "✅" : "-",
+             (room.present & HUB_SENSOR_VEML7700) ? "✅" : "-");
+
+    // 未编译对应驱动的传感器即使探测到也不使用
+    #if ENABLE_AHT21
+    if ((room.present & HUB_SENSOR_AHT21) && !initAHT21()) {
+      room.present &= ~HUB_SENSOR_AHT21;
+    }
+    #else
+    room.present &= ~HUB_SENSOR_AHT21;
+    #endif
+    #if ENABLE_ENS160
+    if ((room.present & HUB_SENSOR_ENS160) && !initENS160()) {
+      room.present &= ~HUB_SENSOR_ENS160;
+    }
+    #else
+    room.present &= ~HUB_SENSOR_ENS160;
+    #endif
+    #if !ENABLE_VEML7700
+    room.present &= ~HUB_SENSOR_VEML7700;
+    #endif
+  }
+}
+
+#if ENABLE_AHT21
+// 在所有接了AHT21的通道上触发测量
+void startHubAHT21Cycle(unsigned long now) {
+  g_hub_aht21_started = true;
+  g_hub_aht21_last_start = now;
+
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    HubRoomState& room = g_hub_rooms[i];
+    if (!(room.present & HUB_SENSOR_AHT21) || room.aht21_pending) {
+      continue;
+    }
+    uint32_t start = micros();
+    bool ok = selectHubChannel(HUB_ROOMS[i].channel) && triggerAHT21();
+    telemetryRecord(g_hub_telemetry[HUB_AHT21], micros() - start, ok);
+    if (ok) {
+      room.aht21_pending = true;
+      room.aht21_busy_retries = 0;
+      g_hub_aht21_measuring = true;
+    } else {
+      hubSensorResult(i, HUB_AHT21, false);
+    }
+  }
+  g_hub_aht21_deadline = now + AHT21_MEASURE_DELAY_MS;
+}
+
+// 截止时间到后依次取回各通道的结果，仍忙碌的通道推迟重试
+bool pollHubAHT21(unsigned long now) {
+  if (!g_hub_aht21_measuring || (long)(now - g_hub_aht21_deadline) < 0) {
+    return false;
+  }
+
+  bool updated = false;
+  bool stillBusy = false;
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    HubRoomState& room = g_hub_rooms[i];
+    if (!room.aht21_pending) {
+      continue;
+    }
+
+    uint8_t raw[6];
+    uint32_t start = micros();
+    bool ok = selectHubChannel(HUB_ROOMS[i].channel) && fetchAHT21Raw(raw);
+    telemetryRecord(g_hub_telemetry[HUB_AHT21], micros() - start, ok);
+
+    if (ok && (raw[0] & 0x80)) {
+      if (++room.aht21_busy_retries <= AHT21_MAX_BUSY_RETRIES) {
+        stillBusy = true;
+        continue;
+      }
+      ok = false;
+    }
+    room.aht21_pending = false;
+
+    float temperature, humidity;
+    ok = ok && parseAHT21(raw, temperature, humidity);
+    hubSensorResult(i, HUB_AHT21, ok);
+    if (!ok) {
+      continue;
+    }
+
+    room.temperature = temperature;
+    room.humidity = humidity;
+    pushSample(room.rings[SAMPLE_TEMPERATURE], SAMPLE_TEMPERATURE, temperature);
+    pushSample(room.rings[SAMPLE_HUMIDITY], SAMPLE_HUMIDITY, humidity);
+    updated = true;
+    LOG_DEBUG("✅ %s AHT21 - 温度: %.1f°C, 湿度: %.1f%%\n", HUB_ROOMS[i].room, temperature, humidity);
+
+    #if ENABLE_ENS160_COMPENSATION
+    if (room.present & HUB_SENSOR_ENS160) {
+      writeENS160Compensation(temperature, humidity);
+    }
+    #endif
+  }
+
+  if (stillBusy) {
+    g_hub_aht21_deadline = now + AHT21_BUSY_RETRY_MS;
+  } else {
+    g_hub_aht21_measuring = false;
+  }
+  return updated;
+}
+#endif
+
+// 同步读取一个房间的ENS160和VEML7700
+bool sampleHubRoom(size_t i) {
+  HubRoomState& room = g_hub_rooms[i];
+  bool updated = false;
+
+  if (!selectHubChannel(HUB_ROOMS[i].channel)) {
+    return false;
+  }
+
+  #if ENABLE_ENS160
+  if (room.present & HUB_SENSOR_ENS160) {
+    ENS160DataFrame frame;
+    uint32_t start = micros();
+    bool ok = fetchENS160(frame);
+    telemetryRecord(g_hub_telemetry[HUB_ENS160], micros() - start, ok);
+
+    // 数据未就绪不算失败
+    if (ok && (frame.status & 0x02)) {
+      ok = ens160FrameValid(frame);
+      if (ok) {
+        room.co2 = frame.eco2;
+        room.voc = frame.tvoc;
+        pushSample(room.rings[SAMPLE_CO2], SAMPLE_CO2, frame.eco2);
+        pushSample(room.rings[SAMPLE_VOC], SAMPLE_VOC, frame.tvoc);
+        updated = true;
+        LOG_DEBUG("✅ %s ENS160 - TVOC: %u ppb, CO2: %u ppm\n", HUB_ROOMS[i].room, frame.tvoc, frame.eco2);
+      }
+      hubSensorResult(i, HUB_ENS160, ok);
+    } else if (!ok) {
+      hubSensorResult(i, HUB_ENS160, false);
+    }
+  }
+  #endif
+
+  #if ENABLE_VEML7700
+  if (room.present & HUB_SENSOR_VEML7700) {
+    float lux;
+    uint32_t start = micros();
+    bool ok = fetchVEML7700(lux);
+    telemetryRecord(g_hub_telemetry[HUB_VEML7700], micros() - start, ok);
+    hubSensorResult(i, HUB_VEML7700, ok);
+    if (ok) {
+      room.light_level = (int)lux;
+      pushSample(room.rings[SAMPLE_LIGHT], SAMPLE_LIGHT, lux);
+      updated = true;
+      LOG_DEBUG("✅ %s VEML7700 - 光照强度: %.2f lux\n", HUB_ROOMS[i].room, lux);
+    }
+  }
+  #endif
+
+  return updated;
+}
+
+// 集线器调度器，在loop()中每次调用，从不阻塞；有新数据时返回true
+bool runHubScheduler() {
+  if (!g_hub_mux_ready) {
+    return false;
+  }
+
+  bool updated = false;
+  unsigned long now = millis();
+
+  #if ENABLE_AHT21
+  if (g_hub_aht21_measuring) {
+    updated = pollHubAHT21(now);
+  } else if (!g_hub_aht21_started || now - g_hub_aht21_last_start >= AHT21_SAMPLE_PERIOD_MS) {
+    startHubAHT21Cycle(now);
+  }
+  #endif
+
+  // 从上次的位置开始找第一个到期的房间
+  for (size_t k = 0; k < HUB_ROOM_COUNT; k++) {
+    size_t i = (g_hub_cursor + k) % HUB_ROOM_COUNT;
+    HubRoomState& room = g_hub_rooms[i];
+    if (!(room.present & (HUB_SENSOR_ENS160 | HUB_SENSOR_VEML7700))) {
+      continue;
+    }
+    if (room.sync_started && now - room.last_sync_sample < ENS160_SAMPLE_PERIOD_MS) {
+      continue;
+    }
+    room.sync_started = true;
+    room.last_sync_sample = now;
+    g_hub_cursor = (i + 1) % HUB_ROOM_COUNT;
+    if (sampleHubRoom(i)) {
+      updated = true;
+    }
+    break;
+  }
+
+  if (updated) {
+    markSensorUpdated();
+  }
+  return updated;
+}
+
+// 是否还有进行中的AHT21测量
+bool hubBusy() {
+  return g_hub_aht21_measuring;
+}
+
+// 启动时读取所有房间一次（等待AHT21测量完成），返回是否读到任何数据
+bool readAllHubRooms() {
+  bool anyDataRead = false;
+
+  LOG_INFO("📊 读取所有房间的传感器数据...\n");
+  #if ENABLE_AHT21
+  startHubAHT21Cycle(millis());
+  #endif
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    g_hub_rooms[i].sync_started = true;
+    g_hub_rooms[i].last_sync_sample = millis();
+    if ((g_hub_rooms[i].present & (HUB_SENSOR_ENS160 | HUB_SENSOR_VEML7700)) && sampleHubRoom(i)) {
+      anyDataRead = true;
+    }
+  }
+  while (hubBusy()) {
+    if (runHubScheduler()) {
+      anyDataRead = true;
+    }
+    yield();
+  }
+
+  if (anyDataRead) {
+    markSensorUpdated();
+  } else {
+    LOG_WARN("⚠️ 没有成功读取到任何房间的传感器数据\n");
+  }
+  return anyDataRead;
+}
+
+void printHubData() {
+  LOG_INFO("📊 集线器各房间数据:\n");
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    const HubRoomState& room = g_hub_rooms[i];
+    LOG_INFO("   🏠 %s (通道%u): 温度 %.1f°C, 湿度 %.1f%%, CO2 %dppm, VOC %dppb, 光照 %dlux, 有效 0x%02X\n",
+             HUB_ROOMS[i].room, HUB_ROOMS[i].channel, room.temperature, room.humidity,
+             room.co2, room.voc, room.light_level, room.valid);
+  }
+}
+
+// 房间当前读数，用于与report_policy.h共用的死区比较
+ReportSnapshot hubRoomReadings(const HubRoomState& room) {
+  ReportSnapshot current;
+  current.temperature = room.temperature;
+  current.humidity = room.humidity;
+  current.co2 = room.co2;
+  current.voc = room.voc;
+  current.light_level = room.light_level;
+  current.motion = false;
+  return current;
+}
+
+// 只比较有有效读数的字段；集线器不上报运动
+uint8_t hubRoomReportFields(const HubRoomState& room) {
+  uint8_t fields = 0;
+  if (room.valid & HUB_SENSOR_AHT21) {
+    fields |= REPORT_FIELD(SAMPLE_TEMPERATURE) | REPORT_FIELD(SAMPLE_HUMIDITY);
+  }
+  if (room.valid & HUB_SENSOR_ENS160) {
+    fields |= REPORT_FIELD(SAMPLE_CO2) | REPORT_FIELD(SAMPLE_VOC);
+  }
+  if (room.valid & HUB_SENSOR_VEML7700) {
+    fields |= REPORT_FIELD(SAMPLE_LIGHT);
+  }
+  return fields;
+}
+
+// 与report_policy.h相同的上报规则：任一房间超出死区即上报，所有房间合并在同一帧
+const char* checkHubReportTrigger() {
+  bool compare;
+  const char* reason = checkReportSchedule(g_hub_has_reported, g_hub_last_report_time, compare);
+  if (!compare) {
+    return reason;
+  }
+
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    const HubRoomState& room = g_hub_rooms[i];
+    reason = checkDeadband(hubRoomReadings(room), room.last_report, hubRoomReportFields(room));
+    if (reason) {
+      return reason;
+    }
+  }
+  return nullptr;
+}
+
+void markHubReported() {
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    g_hub_rooms[i].last_report = hubRoomReadings(g_hub_rooms[i]);
+  }
+  g_hub_has_reported = true;
+  g_hub_last_report_time = millis();
+}
@@ -1,11 +1,3 @@
-// WiFi配置
-// const char* ssid = "CE-Hub-Student";
-// const char* password = "casa-ce-gagarin-public-service";
-// const char* ssid = "CE-Dankao";
-// const char* password = "CELAB2025";
-const char* ssid = "CE-Wlan-Helper";
-const char* password = "ThanksDankao";
-
 // 服务器配置
 // const char* server_host = "10.129.113.188";
 const char* server_host = "192.168.8.194";
@@ -19,60 +11,201 @@ const char* TARGET_ROOM = "living_room";  // 修改这里指定目标房间
 // const char* TARGET_ROOM = "study";       // 书房
 // const char* TARGET_ROOM = "bathroom";    // 浴室
 
+// ping、遥测和日志中的节点位置；集线器模式下各房间由hub.h的HUB_ROOMS决定
+#if HUB_MODE
+#define NODE_LOCATION "hub"
+#else
+#define NODE_LOCATION TARGET_ROOM
+#endif
+
 // WebSocket客户端
 WebSocketsClient webSocket;
 
 // 状态
-bool wifiConnected = false;
 bool wsConnected = false;
 
-void connectWiFi() {
-  Serial.printf("📶 Connecting to: %s\n", ssid);
+// 保活：使用WebSocket协议层的ping/pong，任何数据帧都视为链路活跃
+// 只有链路空闲超过APP_PING_IDLE_MS时才发送应用层JSON ping（附带堆内存状态）
+#define WS_HEARTBEAT_INTERVAL_MS 15000   // 协议层ping间隔
+#define WS_HEARTBEAT_PONG_TIMEOUT_MS 3000
+#define WS_HEARTBEAT_MAX_MISSED 2        // 连续丢失pong次数，超过则断开重连
+#define APP_PING_IDLE_MS 60000
+
+unsigned long g_last_tx_time = 0;  // 最近一次发送数据帧的时间
+uint32_t g_rx_text_frames = 0;     // 收到的文本帧数，基准测试据此判断回复到达
+
+// 连接建立后的首次上传：收到init帧（完成二进制帧协商）后立即上传，
+// 最多等待WS_FIRST_UPLOAD_MAX_WAIT_MS；由loop()中的runConnectionTasks()执行，不在事件回调里阻塞
+#define WS_FIRST_UPLOAD_MAX_WAIT_MS 500
+bool g_subscribe_pending = false;
+bool g_first_upload_pending = false;
+unsigned long g_first_upload_deadline = 0;
+unsigned long g_ws_connected_time = 0;
+
+// 设备ID（MAC地址），启动时缓存一次，避免每条消息都调用WiFi.macAddress()
+char g_device_id[18] = "";
+uint8_t g_device_mac[6];
+
+// 上行帧发送缓冲区：所有上行消息（JSON和二进制帧）都写入这个静态缓冲区，
+// 前面预留帧头空间，用headerToPayload方式发送，发送时不产生堆分配（见telemetry.h的WS_FRAME_BUFFER_SIZE）
+// 集线器模式一帧包含所有房间的读数和统计
+#if HUB_MODE
+#define TX_BUFFER_SIZE 4096
+#else
+#define TX_BUFFER_SIZE 2048
+#endif
+uint8_t g_tx_frame[WS_FRAME_BUFFER_SIZE(TX_BUFFER_SIZE)];
+char* const g_tx_buffer = WS_FRAME_PAYLOAD(g_tx_frame);
+size_t g_tx_len = 0;
+bool g_tx_overflow = false;
+
+void initDeviceId() {
+  uint8_t* mac = g_device_mac;
+  WiFi.macAddress(mac);
+  snprintf(g_device_id, sizeof(g_device_id), "%02X:%02X:%02X:%02X:%02X:%02X",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+void txBegin() {
+  g_tx_len = 0;
+  g_tx_overflow = false;
+  g_tx_buffer[0] = '\0';
+}
+
+void txAppend(const char* format, ...) {
+  if (g_tx_overflow) {
+    return;
+  }
   
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(g_tx_buffer + g_tx_len, TX_BUFFER_SIZE - g_tx_len, format, args);
+  va_end(args);
   
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(1000);
-    Serial.print(".");
-    attempts++;
+  if (n < 0 || (size_t)n >= TX_BUFFER_SIZE - g_tx_len) {
+    g_tx_overflow = true;
+    return;
   }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnected = true;
-    Serial.println("\n✅ WiFi Connected!");
-    Serial.printf("📍 ESP8266 IP: %s\n", WiFi.localIP().toString().c_str());
-    Serial.printf("📡 Signal: %d dBm\n", WiFi.RSSI());
-  } else {
-    wifiConnected = false;
-    Serial.println("\n❌ WiFi failed!");
+  g_tx_len += n;
+}
+
+bool txSend() {
+  if (g_tx_overflow) {
+    LOG_ERROR("❌ 上行消息超出发送缓冲区，已丢弃\n");
+    return false;
+  }
+  bool result = telemetryWsSendFrame(webSocket, g_tx_frame, g_tx_len);
+  if (result) {
+    g_last_tx_time = millis();
   }
+  return result;
 }
 
-void sendSensorData() {
-  if (!wsConnected) {
-    Serial.println("⚠️ Cannot send sensor data - not connected");
-    return;
+// 发送g_tx_buffer中g_tx_len字节的二进制帧
+bool txSendBinary() {
+  bool result = telemetryWsSendFrame(webSocket, g_tx_frame, g_tx_len, true);
+  if (result) {
+    g_last_tx_time = millis();
+  }
+  return result;
+}
+
+// 是否是本节点负责的房间（集线器模式下为房间表中的任一房间）
+bool isOurRoom(const char* location) {
+  #if HUB_MODE
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    if (strcmp(location, HUB_ROOMS[i].room) == 0) {
+      return true;
+    }
   }
+  return false;
+  #else
+  return strcmp(location, TARGET_ROOM) == 0;
+  #endif
+}
+
+// 本节点负责的房间，写成JSON数组的元素（不含方括号）
+void txAppendRoomList() {
+  #if HUB_MODE
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    txAppend("%s\"%s\"", i == 0 ? "" : ",", HUB_ROOMS[i].room);
+  }
+  #else
+  txAppend("\"%s\"", TARGET_ROOM);
+  #endif
+}
+
+// 链路空闲才需要应用层ping
+bool linkIdle() {
+  return millis() - g_last_tx_time >= APP_PING_IDLE_MS;
+}
+
+// 堆内存状态，用于确认上行路径没有堆分配与碎片增长
+void printHeapStats() {
+  LOG_DEBUG("🧠 Heap - free: %u, max block: %u, fragmentation: %u%%\n",
+                ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation());
+}
+
+// 离线补传的批量大小与最小间隔，避免重连时冲击IoT服务的/ws处理
+#define OFFLINE_DRAIN_BATCH 6
+#define OFFLINE_DRAIN_INTERVAL_MS 1000
+unsigned long lastOfflineDrainTime = 0;
+
+// 把一次读数写成JSON control帧（data_update）到发送缓冲区，withStats时附加上传窗口内的统计
+void buildSensorDataMessage(float temperature, float humidity, int co2, int voc, int light_level,
+                            bool motion, bool withStats) {
+  // 只发送指定房间的传感器数据
+  txBegin();
+  txAppend("{\"type\":\"control\",\"commands\":[{\"device\":\"sensors\",\"action\":\"data_update\","
+           "\"location\":\"%s\",\"parameters\":{", TARGET_ROOM);
+  txAppend("\"temperature\":%.2f,\"humidity\":%.2f,\"co2\":%d,\"voc\":%d,\"light_level\":%d,\"motion\":%s,",
+           temperature, humidity, co2, voc, light_level, motion ? "true" : "false");
+  txAppend("\"device_id\":\"%s\",\"source\":\"%s\",\"data_type\":\"%s\",\"timestamp\":%lu",
+           g_device_id,
+           g_sensor_data_valid ? "esp8266_real_sensors" : "esp8266_simulated",
+           g_sensor_data_valid ? "real" : "simulated",
+           millis());
   
+  // 附加上传窗口内的统计数据
+  if (withStats) {
+    txAppend(",\"stats\":{");
+    bool first = true;
+    for (int i = 0; i < SAMPLE_FIELD_COUNT; i++) {
+      WindowStats stats;
+      if (!getWindowStats((SampleField)i, stats)) {
+        continue;
+      }
+      txAppend("%s\"%s\":{\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"last\":%.2f,\"n\":%u,\"span_ms\":%lu}",
+               first ? "" : ",", SAMPLE_FIELD_NAMES[i],
+               stats.min, stats.max, stats.mean, stats.last, stats.count, stats.span_ms);
+      first = false;
+    }
+    txAppend("}");
+  }
+  txAppend("}}]}");
+}
+
+void sendSensorData() {
   // 使用真实传感器数据，如果数据无效则使用备用值
   float temperature, humidity;
   int co2, voc, light_level;
   bool motion;
   
-  if (g_sensor_data_valid && isSensorDataValid()) {
-    // 使用真实传感器数据
-    temperature = g_temperature;
-    humidity = g_humidity;
-    co2 = g_co2;
-    voc = g_voc;
-    light_level = g_light_level;
-    motion = g_motion;
+  bool useRealData = g_sensor_data_valid && isSensorDataValid();
+  
+  if (useRealData) {
+    // 使用真实传感器数据：连续量取窗口均值，运动取窗口内是否出现过
+    WindowStats stats;
+    temperature = getWindowStats(SAMPLE_TEMPERATURE, stats) ? stats.mean : g_temperature;
+    humidity = getWindowStats(SAMPLE_HUMIDITY, stats) ? stats.mean : g_humidity;
+    co2 = getWindowStats(SAMPLE_CO2, stats) ? (int)(stats.mean + 0.5) : g_co2;
+    voc = getWindowStats(SAMPLE_VOC, stats) ? (int)(stats.mean + 0.5) : g_voc;
+    light_level = getWindowStats(SAMPLE_LIGHT, stats) ? (int)(stats.mean + 0.5) : g_light_level;
+    motion = getWindowStats(SAMPLE_MOTION, stats) ? stats.max > 0 : g_motion;
     
-    Serial.printf("📊 Using REAL sensor data for room: %s\n", TARGET_ROOM);
-    Serial.printf("   🌡️ 真实温度: %.1f°C, 湿度: %.1f%%\n", temperature, humidity);
-    Serial.printf("   🌬️ 真实CO2: %dppm, VOC: %dppb, 光照: %dlux\n", co2, voc, light_level);
+    LOG_DEBUG("📊 Using REAL sensor data for room: %s\n", TARGET_ROOM);
+    LOG_DEBUG("   🌡️ 真实温度: %.1f°C, 湿度: %.1f%%\n", temperature, humidity);
+    LOG_DEBUG("   🌬️ 真实CO2: %dppm, VOC: %dppb, 光照: %dlux\n", co2, voc, light_level);
   } else {
     // 使用模拟数据作为备用
     temperature = 23.5 + random(-50, 50) / 100.0; // 23.0-24.0°C
@@ -82,159 +215,451 @@ void sendSensorData() {
     light_level = 300 + random(-100, 300);        // 200-600 lux
     motion = (random(0, 100) < 10);               // 10% 概率有人
     
-    Serial.printf("⚠️ Using SIMULATED data for room: %s (real sensor data not available)\n", TARGET_ROOM);
-    Serial.printf("   🎲 模拟温度: %.1f°C, 湿度: %.1f%%\n", temperature, humidity);
-    Serial.printf("   🎲 模拟CO2: %dppm, VOC: %dppb, 光照: %dlux\n", co2, voc, light_level);
+    LOG_DEBUG("⚠️ Using SIMULATED data for room: %s (real sensor data not available)\n", TARGET_ROOM);
+    LOG_DEBUG("   🎲 模拟温度: %.1f°C, 湿度: %.1f%%\n", temperature, humidity);
+    LOG_DEBUG("   🎲 模拟CO2: %dppm, VOC: %dppb, 光照: %dlux\n", co2, voc, light_level);
+  }
+  
+  if (!wsConnected) {
+    if (!useRealData) {
+      LOG_DEBUG("⚠️ Cannot send sensor data - not connected\n");
+      return;
+    }
+    
+    // 离线时把真实读数存入离线队列，重连后补传
+    QueuedReading reading;
+    reading.timestamp = millis();
+    reading.temperature = toFixedSample(SAMPLE_TEMPERATURE, temperature);
+    reading.humidity = toFixedSample(SAMPLE_HUMIDITY, humidity);
+    reading.co2 = toFixedSample(SAMPLE_CO2, co2);
+    reading.voc = toFixedSample(SAMPLE_VOC, voc);
+    reading.light_level = toFixedSample(SAMPLE_LIGHT, light_level);
+    reading.flags = motion ? QUEUED_FLAG_MOTION : 0;
+    reading.room = 0;
+    enqueueOfflineReading(reading);
+    resetSampleWindow();
+    
+    LOG_DEBUG("📥 Not connected - queued sensor data (%u pending)\n", offlineQueueSize());
+    return;
   }
 
-  // 只发送指定房间的传感器数据
-  DynamicJsonDocument doc(1024);
-  doc["type"] = "control";
-  
-  JsonArray commands = doc.createNestedArray("commands");
-  JsonObject sensorCmd = commands.createNestedObject();
-  sensorCmd["device"] = "sensors";
-  sensorCmd["action"] = "data_update";
-  sensorCmd["location"] = TARGET_ROOM;  // 使用指定的房间
-  
-  JsonObject params = sensorCmd.createNestedObject("parameters");
-  params["temperature"] = temperature;
-  params["humidity"] = humidity;
-  params["co2"] = co2;
-  params["voc"] = voc;
-  params["light_level"] = light_level;
-  params["motion"] = motion;
-  params["device_id"] = WiFi.macAddress();
-  params["source"] = g_sensor_data_valid ? "esp8266_real_sensors" : "esp8266_simulated";
-  params["data_type"] = g_sensor_data_valid ? "real" : "simulated";
-  params["timestamp"] = millis();
-  
-  String message;
-  serializeJson(doc, message);
-  
-  Serial.printf("📤 准备上传传感器数据到房间: %s\n", TARGET_ROOM);
-  Serial.printf("📊 数据类型: %s\n", g_sensor_data_valid ? "真实传感器数据" : "模拟数据");
-  Serial.printf("📤 发送消息: %s\n", message.c_str());
-  
-  bool result = webSocket.sendTXT(message);
-  Serial.printf("📤 上传结果: %s\n", result ? "成功" : "失败");
+  // 协商成功时改用二进制帧上传，窗口统计随帧发送
+  if (binaryFramesActive()) {
+    static_assert(SENSOR_FRAME_MAX_SIZE <= TX_BUFFER_SIZE, "二进制帧必须能放进发送缓冲区");
+    uint8_t* buffer = (uint8_t*)g_tx_buffer;
+    SensorFrame frame;
+    frame.version = SENSOR_FRAME_VERSION;
+    frame.room_id = g_binary_room_id;
+    frame.seq = g_sensor_frame_seq++;
+    frame.sensor_bitmap = FRAME_HAS_TEMPERATURE | FRAME_HAS_HUMIDITY | FRAME_HAS_CO2 |
+                          FRAME_HAS_VOC | FRAME_HAS_LIGHT | FRAME_HAS_MOTION;
+    frame.flags = (useRealData ? FRAME_FLAG_REAL_DATA : 0) | (motion ? FRAME_FLAG_MOTION : 0);
+    frame.temperature = toFixedSample(SAMPLE_TEMPERATURE, temperature);
+    frame.humidity = toFixedSample(SAMPLE_HUMIDITY, humidity);
+    frame.co2 = toFixedSample(SAMPLE_CO2, co2);
+    frame.voc = toFixedSample(SAMPLE_VOC, voc);
+    frame.light_level = toFixedSample(SAMPLE_LIGHT, light_level);
+    frame.timestamp = millis();
+    memcpy(frame.mac, g_device_mac, sizeof(frame.mac));
+    memcpy(buffer, &frame, sizeof(frame));
+    g_tx_len = sizeof(frame) + appendFrameStats(buffer + sizeof(frame), useRealData);
+    
+    bool result = txSendBinary();
+    LOG_DEBUG("📤 二进制帧上传 (seq %u, %u bytes): %s\n", frame.seq, g_tx_len, result ? "成功" : "失败");
+    if (result) {
+      resetSampleWindow();
+    }
+    return;
+  }
+  
+  buildSensorDataMessage(temperature, humidity, co2, voc, light_level, motion, useRealData);
+  
+  LOG_DEBUG("📤 准备上传传感器数据到房间: %s\n", TARGET_ROOM);
+  LOG_DEBUG("📊 数据类型: %s\n", g_sensor_data_valid ? "真实传感器数据" : "模拟数据");
+  LOG_DEBUG("📤 发送消息: %s\n", g_tx_buffer);
+  
+  bool result = txSend();
+  LOG_DEBUG("📤 上传结果: %s\n", result ? "成功" : "失败");
+  
+  // 发送成功才开始新的统计窗口，失败时继续累积
+  if (result) {
+    resetSampleWindow();
+  }
   
   // 如果是真实数据，额外打印确认信息
-  if (g_sensor_data_valid && isSensorDataValid()) {
-    Serial.printf("✅ 成功上传真实传感器数据到服务器！\n");
+  if (useRealData) {
+    LOG_DEBUG("✅ 成功上传真实传感器数据到服务器！\n");
+  }
+}
+
+#if HUB_MODE
+// 一个房间的data_update命令：只写该通道上有有效读数的字段
+void appendHubRoomCommand(size_t i, bool first) {
+  const HubRoomState& room = g_hub_rooms[i];
+  
+  txAppend("%s{\"device\":\"sensors\",\"action\":\"data_update\",\"location\":\"%s\",\"parameters\":{",
+           first ? "" : ",", HUB_ROOMS[i].room);
+  if (room.valid & HUB_SENSOR_AHT21) {
+    txAppend("\"temperature\":%.2f,\"humidity\":%.2f,",
+             hubFieldValue(room, SAMPLE_TEMPERATURE, room.temperature),
+             hubFieldValue(room, SAMPLE_HUMIDITY, room.humidity));
+  }
+  if (room.valid & HUB_SENSOR_ENS160) {
+    txAppend("\"co2\":%d,\"voc\":%d,",
+             (int)(hubFieldValue(room, SAMPLE_CO2, room.co2) + 0.5),
+             (int)(hubFieldValue(room, SAMPLE_VOC, room.voc) + 0.5));
+  }
+  if (room.valid & HUB_SENSOR_VEML7700) {
+    txAppend("\"light_level\":%d,", (int)(hubFieldValue(room, SAMPLE_LIGHT, room.light_level) + 0.5));
+  }
+  txAppend("\"device_id\":\"%s\",\"source\":\"esp8266_hub\",\"data_type\":\"real\",\"hub_channel\":%u,\"timestamp\":%lu",
+           g_device_id, HUB_ROOMS[i].channel, millis());
+  
+  txAppend(",\"stats\":{");
+  bool firstField = true;
+  for (int f = 0; f < SAMPLE_FIELD_COUNT; f++) {
+    WindowStats stats;
+    if (!getWindowStats(room.rings[f], (SampleField)f, stats)) {
+      continue;
+    }
+    txAppend("%s\"%s\":{\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"last\":%.2f,\"n\":%u,\"span_ms\":%lu}",
+             firstField ? "" : ",", SAMPLE_FIELD_NAMES[f],
+             stats.min, stats.max, stats.mean, stats.last, stats.count, stats.span_ms);
+    firstField = false;
+  }
+  txAppend("}}}");
+}
+
+// 离线时每个房间一条记录，room字段记下房间表下标
+size_t queueHubReadings() {
+  size_t queued = 0;
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    const HubRoomState& room = g_hub_rooms[i];
+    if (!room.valid) {
+      continue;
+    }
+    QueuedReading reading;
+    reading.timestamp = millis();
+    reading.temperature = toFixedSample(SAMPLE_TEMPERATURE, hubFieldValue(room, SAMPLE_TEMPERATURE, room.temperature));
+    reading.humidity = toFixedSample(SAMPLE_HUMIDITY, hubFieldValue(room, SAMPLE_HUMIDITY, room.humidity));
+    reading.co2 = toFixedSample(SAMPLE_CO2, hubFieldValue(room, SAMPLE_CO2, room.co2));
+    reading.voc = toFixedSample(SAMPLE_VOC, hubFieldValue(room, SAMPLE_VOC, room.voc));
+    reading.light_level = toFixedSample(SAMPLE_LIGHT, hubFieldValue(room, SAMPLE_LIGHT, room.light_level));
+    reading.flags = QUEUED_FLAG_NO_MOTION |
+                    ((room.valid & HUB_SENSOR_AHT21) ? 0 : QUEUED_FLAG_NO_CLIMATE) |
+                    ((room.valid & HUB_SENSOR_ENS160) ? 0 : QUEUED_FLAG_NO_AIR) |
+                    ((room.valid & HUB_SENSOR_VEML7700) ? 0 : QUEUED_FLAG_NO_LIGHT);
+    reading.room = i;
+    enqueueOfflineReading(reading);
+    queued++;
+  }
+  return queued;
+}
+
+// 集线器模式上传：所有房间合并成一个control帧，服务器按命令逐条处理并在control_results中逐条回复
+// 返回true表示至少有一个房间的读数已发出或存入离线队列，调用者据此决定是否markHubReported()
+bool sendHubData() {
+  if (!wsConnected) {
+    size_t queued = queueHubReadings();
+    resetHubWindows();
+    LOG_DEBUG("📥 Not connected - queued %u hub rooms (%u pending)\n", queued, offlineQueueSize());
+    return queued > 0;
+  }
+  
+  txBegin();
+  txAppend("{\"type\":\"control\",\"commands\":[");
+  size_t rooms = 0;
+  for (size_t i = 0; i < HUB_ROOM_COUNT; i++) {
+    if (!g_hub_rooms[i].valid) {
+      continue;
+    }
+    appendHubRoomCommand(i, rooms == 0);
+    rooms++;
+  }
+  txAppend("]}");
+  
+  if (rooms == 0) {
+    LOG_DEBUG("⚠️ 集线器还没有任何房间的有效读数\n");
+    return false;
+  }
+  
+  LOG_DEBUG("📤 发送消息: %s\n", g_tx_buffer);
+  bool result = txSend();
+  LOG_DEBUG("📤 集线器上传 %u 个房间 (%u bytes): %s\n", rooms, g_tx_len, result ? "成功" : "失败");
+  
+  if (result) {
+    resetHubWindows();
+  }
+  return result;
+}
+#endif
+
+// 重连后分批补传离线队列，每次调用最多发送一批
+void drainOfflineQueue() {
+  if (!wsConnected || offlineQueueSize() == 0) {
+    return;
+  }
+  if (millis() - lastOfflineDrainTime < OFFLINE_DRAIN_INTERVAL_MS) {
+    return;
+  }
+  lastOfflineDrainTime = millis();
+  
+  QueuedReading batch[OFFLINE_DRAIN_BATCH];
+  bool fromFile;
+  size_t count = peekOfflineReadings(batch, OFFLINE_DRAIN_BATCH, fromFile);
+  if (count == 0) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  
+  txBegin();
+  txAppend("{\"type\":\"control\",\"commands\":[");
+  for (size_t i = 0; i < count; i++) {
+    const QueuedReading& r = batch[i];
+    #if HUB_MODE
+    const char* location = HUB_ROOMS[r.room < HUB_ROOM_COUNT ? r.room : 0].room;
+    #else
+    const char* location = TARGET_ROOM;
+    #endif
+    txAppend("%s{\"device\":\"sensors\",\"action\":\"data_update\",\"location\":\"%s\",\"parameters\":{",
+             i == 0 ? "" : ",", location);
+    if (!(r.flags & QUEUED_FLAG_NO_CLIMATE)) {
+      txAppend("\"temperature\":%.2f,\"humidity\":%.2f,",
+               fromFixedSample(SAMPLE_TEMPERATURE, r.temperature),
+               fromFixedSample(SAMPLE_HUMIDITY, r.humidity));
+    }
+    if (!(r.flags & QUEUED_FLAG_NO_AIR)) {
+      txAppend("\"co2\":%u,\"voc\":%u,", r.co2, r.voc);
+    }
+    if (!(r.flags & QUEUED_FLAG_NO_LIGHT)) {
+      txAppend("\"light_level\":%.0f,", fromFixedSample(SAMPLE_LIGHT, r.light_level));
+    }
+    if (!(r.flags & QUEUED_FLAG_NO_MOTION)) {
+      txAppend("\"motion\":%s,", (r.flags & QUEUED_FLAG_MOTION) ? "true" : "false");
+    }
+    txAppend("\"device_id\":\"%s\",\"source\":\"esp8266_real_sensors\",\"data_type\":\"real\",\"queued\":true",
+             g_device_id);
+    if (!(r.flags & QUEUED_FLAG_PREV_BOOT)) {
+      txAppend(",\"age_ms\":%lu", now - r.timestamp);  // 服务器据此还原采集时间
+    }
+    txAppend("}}");
+  }
+  txAppend("]}");
+  
+  if (txSend()) {
+    popOfflineReadings(count, fromFile);
+    LOG_DEBUG("📤 补传离线数据 %u 条，剩余 %u 条\n", count, offlineQueueSize());
+  } else {
+    LOG_WARN("❌ 离线数据补传失败，稍后重试\n");
   }
 }
 
-void handleMessage(const char* message) {
-  DynamicJsonDocument doc(1024);
-  DeserializationError error = deserializeJson(doc, message);
+// 入站消息过滤：只保留下面用到的字段，init/status_response中其余房间的完整设备状态在解析时直接跳过
+#define INBOUND_DOC_SIZE 768
+
+StaticJsonDocument<384> g_inbound_filter;
+
+void initInboundFilter() {
+  if (!g_inbound_filter.isNull()) {
+    return;
+  }
+  g_inbound_filter["type"] = true;
+  g_inbound_filter["location"] = true;
+  g_inbound_filter["message"] = true;
+  g_inbound_filter["device"] = true;
+  
+  // init：二进制帧协商信息，设备只保留类别名
+  g_inbound_filter["capabilities"] = true;
+  g_inbound_filter["devices"]["*"]["-"] = true;
   
-  if (error) {
-    Serial.printf("❌ JSON parse error: %s\n", error.c_str());
+  // control_results
+  JsonObject result = g_inbound_filter["results"].createNestedObject();
+  result["status"] = true;
+  result["device"] = true;
+  result["action"] = true;
+  result["message"] = true;
+  result["parameters"]["data_type"] = true;
+  
+  // sensor_update
+  g_inbound_filter["sensors"] = true;
+}
+
+// payload按原地（zero-copy）解析，字符串直接指向payload缓冲区
+void handleMessage(char* payload, size_t length) {
+  StaticJsonDocument<INBOUND_DOC_SIZE> doc;
+  DeserializationError error = deserializeJson(doc, payload, length,
+                                               DeserializationOption::Filter(g_inbound_filter));
+  
+  // init消息带有完整设备状态，可能超出文档容量；capabilities在最前面，部分解析结果仍可用
+  if (error && !(error == DeserializationError::NoMemory && doc["type"] == "init")) {
+    LOG_WARN("❌ JSON parse error: %s\n", error.c_str());
     return;
   }
   
-  String type = doc["type"].as<String>();
-  String location = doc["location"].as<String>();
+  const char* type = doc["type"] | "";
+  const char* location = doc["location"] | "";
   
   // 只处理目标房间的消息，忽略其他房间的数据
-  if (!location.isEmpty() && location != TARGET_ROOM) {
-    Serial.printf("🚫 Ignoring message from room: %s (not our target room: %s)\n", 
-                  location.c_str(), TARGET_ROOM);
+  if (location[0] && !isOurRoom(location)) {
+    LOG_DEBUG("🚫 Ignoring message from room: %s (not our target room: %s)\n", 
+                  location, NODE_LOCATION);
     return;
   }
   
-  Serial.printf("📋 Processing message type: %s for room: %s\n", type.c_str(), TARGET_ROOM);
+  LOG_DEBUG("📋 Processing message type: %s for room: %s\n", type, NODE_LOCATION);
   
-  if (type == "init") {
-    Serial.printf("✅ IoT Service initialization received for room: %s\n", TARGET_ROOM);
+  if (strcmp(type, "init") == 0) {
+    LOG_INFO("✅ IoT Service initialization received for room: %s\n", NODE_LOCATION);
+    
+    // 二进制帧只能携带一个房间，集线器模式始终使用JSON
+    #if !HUB_MODE
+    negotiateBinaryFrames(doc["capabilities"], TARGET_ROOM);
+    #endif
+    LOG_INFO("📦 Upload format: %s\n", binaryFramesActive() ? "binary frame" : "JSON");
+    
+    // 协商完成，首次上传不必再等
+    g_first_upload_deadline = millis();
     
     // 只显示目标房间的设备状态
     if (doc["devices"].is<JsonObject>()) {
-      Serial.printf("🏠 Available devices in %s:\n", TARGET_ROOM);
+      LOG_INFO("🏠 Available devices in %s:\n", NODE_LOCATION);
       for (JsonPair device : doc["devices"].as<JsonObject>()) {
-        Serial.printf("   - %s\n", device.key().c_str());
+        LOG_INFO("   - %s\n", device.key().c_str());
       }
     }
     
-  } else if (type == "control_results") {
-    Serial.printf("✅ Control command results received for room: %s\n", TARGET_ROOM);
+  } else if (strcmp(type, "control_results") == 0) {
+    LOG_DEBUG("✅ Control command results received for room: %s\n", NODE_LOCATION);
     
-    if (doc["results"].is<JsonArray>()) {
-      for (JsonObject result : doc["results"].as<JsonArray>()) {
-        String status = result["status"].as<String>();
-        String device = result["device"].as<String>();
-        String action = result["action"].as<String>();
-        String dataType = result["parameters"]["data_type"].as<String>();
-        
-        Serial.printf("   📋 %s %s: %s\n", device.c_str(), action.c_str(), status.c_str());
-        
-        if (status == "success") {
-          if (dataType == "real") {
-            Serial.printf("   ✅ 真实传感器数据成功上传到房间 %s！\n", TARGET_ROOM);
-          } else {
-            Serial.printf("   ⚠️ 模拟传感器数据已上传到房间 %s\n", TARGET_ROOM);
-          }
+    for (JsonObjectConst result : doc["results"].as<JsonArrayConst>()) {
+      const char* status = result["status"] | "";
+      const char* device = result["device"] | "";
+      const char* action = result["action"] | "";
+      const char* dataType = result["parameters"]["data_type"] | "";
+      
+      LOG_DEBUG("   📋 %s %s: %s\n", device, action, status);
+      
+      if (strcmp(status, "success") == 0) {
+        if (strcmp(dataType, "real") == 0) {
+          LOG_DEBUG("   ✅ 真实传感器数据成功上传到房间 %s！\n", NODE_LOCATION);
         } else {
-          Serial.printf("   ❌ Failed: %s\n", result["message"].as<String>().c_str());
+          LOG_DEBUG("   ⚠️ 模拟传感器数据已上传到房间 %s\n", NODE_LOCATION);
         }
+      } else {
+        LOG_WARN("   ❌ Failed: %s\n", result["message"] | "");
       }
     }
     
-  } else if (type == "sensor_update") {
+  } else if (strcmp(type, "sensor_update") == 0) {
     // 只处理目标房间的传感器更新
-    Serial.printf("📊 Sensor update from our room: %s\n", TARGET_ROOM);
+    LOG_DEBUG("📊 Sensor update from our room: %s\n", location[0] ? location : NODE_LOCATION);
     
-    if (doc["sensors"].is<JsonObject>()) {
-      JsonObject sensors = doc["sensors"];
+    JsonObjectConst sensors = doc["sensors"];
+    if (!sensors.isNull()) {
       bool realData = sensors["real_data"].as<bool>();
-      String source = sensors["source"].as<String>();
+      const char* source = sensors["source"] | "";
       
-      Serial.printf("   🌡️ Current data - Temp: %.1f°C, Humidity: %.1f%%\n", 
+      LOG_DEBUG("   🌡️ Current data - Temp: %.1f°C, Humidity: %.1f%%\n", 
                     sensors["temperature"].as<float>(), 
                     sensors["humidity"].as<float>());
-      Serial.printf("   💨 CO2: %dppm, VOC: %dppb\n",
+      LOG_DEBUG("   💨 CO2: %dppm, VOC: %dppb\n",
                     sensors["co2"].as<int>(),
                     sensors["voc"].as<int>());
-      Serial.printf("   ☀️ Light: %dlux, Motion: %s\n",
+      LOG_DEBUG("   ☀️ Light: %dlux, Motion: %s\n",
                     sensors["light_level"].as<int>(),
                     sensors["motion"].as<bool>() ? "Detected" : "None");
-      Serial.printf("   📊 Data source: %s (%s)\n", 
-                    source.c_str(), 
+      LOG_DEBUG("   📊 Data source: %s (%s)\n", 
+                    source, 
                     realData ? "Real" : "Simulated");
     }
     
-  } else if (type == "device_update") {
-    String device = doc["device"].as<String>();
-    Serial.printf("🔌 Device update in our room %s: %s\n", TARGET_ROOM, device.c_str());
+  } else if (strcmp(type, "device_update") == 0) {
+    LOG_DEBUG("🔌 Device update in our room %s: %s\n", location[0] ? location : NODE_LOCATION, doc["device"] | "");
     
-  } else if (type == "error") {
-    String error_msg = doc["message"].as<String>();
-    Serial.printf("❌ Error from server for room %s: %s\n", TARGET_ROOM, error_msg.c_str());
+  } else if (strcmp(type, "subscribed") == 0) {
+    LOG_INFO("📮 Subscription confirmed for room: %s\n", NODE_LOCATION);
+    
+  } else if (strcmp(type, "error") == 0) {
+    LOG_WARN("❌ Error from server for room %s: %s\n", NODE_LOCATION, doc["message"] | "");
     
   } else {
-    Serial.printf("ℹ️ Other message type for room %s: %s\n", TARGET_ROOM, type.c_str());
+    LOG_DEBUG("ℹ️ Other message type for room %s: %s\n", NODE_LOCATION, type);
   }
 }
 
-// 添加一个简单的ping功能，只针对目标房间
+// 应用层ping，只在链路空闲时发送，只针对目标房间
 void sendPing() {
   if (!wsConnected) return;
   
-  DynamicJsonDocument doc(256);
-  doc["type"] = "ping";
-  doc["device_id"] = WiFi.macAddress();
-  doc["location"] = TARGET_ROOM;  // 指定房间
-  doc["timestamp"] = millis();
-  doc["sensor_status"] = g_sensor_data_valid ? "active" : "inactive";
-  
-  String message;
-  serializeJson(doc, message);
+  txBegin();
+  txAppend("{\"type\":\"ping\",\"device_id\":\"%s\",\"location\":\"%s\",\"timestamp\":%lu,\"sensor_status\":\"%s\",",
+           g_device_id, NODE_LOCATION, millis(), g_sensor_data_valid ? "active" : "inactive");
+  #if HUB_MODE
+  txAppend("\"rooms\":[");
+  txAppendRoomList();
+  txAppend("],");
+  #endif
+  txAppend("\"free_heap\":%u,\"max_block\":%u,\"heap_frag\":%u,",
+           ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation());
+  txAppend("\"rssi\":%d,\"wifi_reconnects\":%u,\"wifi_reconnect_ms\":%lu,\"wifi_reconnect_max_ms\":%lu,\"wifi_fast_reconnect\":%s}",
+           WiFi.RSSI(), g_wifi_reconnect_count, g_wifi_last_reconnect_ms, g_wifi_max_reconnect_ms,
+           g_wifi_last_fast ? "true" : "false");
   
-  webSocket.sendTXT(message);
-  Serial.printf("🏓 Ping sent for room: %s (sensors: %s)\n", 
-                TARGET_ROOM, 
+  txSend();
+  g_last_tx_time = millis();  // 发送失败也等下一个空闲周期再试
+  LOG_DEBUG("🏓 Ping sent for room: %s (sensors: %s)\n", 
+                NODE_LOCATION, 
                 g_sensor_data_valid ? "活跃" : "不活跃");
+  printHeapStats();
+}
+
+// 订阅：只接收目标房间、这里列出的广播类型，服务器不再推送其他房间的sensor_update等
+#define WS_SUBSCRIBE_TYPES "\"device_update\""
+
+void sendSubscribe() {
+  txBegin();
+  txAppend("{\"type\":\"subscribe\",\"device_id\":\"%s\",\"rooms\":[", g_device_id);
+  txAppendRoomList();
+  txAppend("],\"types\":[" WS_SUBSCRIBE_TYPES "]}");
+  bool result = txSend();
+  LOG_INFO("📮 订阅房间 %s 的广播: %s\n", NODE_LOCATION, result ? "成功" : "失败");
+}
+
+// 周期性遥测帧：loop耗时分布、传感器I2C耗时、堆与重连，不需要服务器回复
+void sendTelemetry() {
+  txBegin();
+  g_tx_len = telemetryFormat(g_tx_buffer, TX_BUFFER_SIZE, g_device_id, NODE_LOCATION);
+  g_tx_overflow = g_tx_len == 0;
+  bool result = txSend();
+  LOG_DEBUG("📈 遥测 (loop max %u us, %u bytes): %s\n",
+                g_telemetry.loop_max_us, g_tx_len, result ? "成功" : "失败");
+  telemetryResetWindow();
+}
+
+// 连接阶段的延后任务，在webSocket.loop()之后调用
+void runConnectionTasks() {
+  if (g_subscribe_pending && wsConnected) {
+    g_subscribe_pending = false;
+    sendSubscribe();
+  }
+  if (!g_first_upload_pending || !wsConnected) {
+    return;
+  }
+  if ((long)(millis() - g_first_upload_deadline) < 0) {
+    return;
+  }
+  
+  g_first_upload_pending = false;
+  LOG_INFO("📤 连接后首次上传（连接后 %lu ms）\n", millis() - g_ws_connected_time);
+  #if HUB_MODE
+  if (sendHubData()) {
+    markHubReported();
+  }
+  #else
+  sendSensorData();
+  markReported();
+  #endif
 }
 
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
@@ -242,49 +667,62 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
   
   switch(type) {
     case WStype_DISCONNECTED:
+      // 重连失败也会触发DISCONNECTED，只统计从已连接到断开的次数
+      if (wsConnected) {
+        telemetryWsDisconnect();
+      }
       wsConnected = false;
-      Serial.printf("[%lus] 🔴 Disconnected from IoT Service\n", elapsed);
+      g_subscribe_pending = false;
+      g_first_upload_pending = false;
+      g_binary_room_id = -1;  // 重连后重新协商
+      LOG_INFO("[%lus] 🔴 Disconnected from IoT Service\n", elapsed);
       break;
       
     case WStype_CONNECTED:
       wsConnected = true;
-      Serial.printf("[%lus] 🟢 Connected to IoT Service: %s\n", elapsed, payload);
-      Serial.printf("[%lus] 📊 Sensor status: %s\n", elapsed, g_sensor_data_valid ? "真实传感器可用" : "仅模拟数据");
+      LOG_INFO("[%lus] 🟢 Connected to IoT Service: %s\n", elapsed, payload);
+      LOG_INFO("[%lus] 📊 Sensor status: %s\n", elapsed, g_sensor_data_valid ? "真实传感器可用" : "仅模拟数据");
       
-      // 连接成功后等待3秒再发送第一条消息
-      delay(3000);
+      // 首次上传交给runConnectionTasks()，等待init帧或超时
+      g_ws_connected_time = millis();
+      g_subscribe_pending = true;
+      g_first_upload_pending = true;
+      g_first_upload_deadline = g_ws_connected_time + WS_FIRST_UPLOAD_MAX_WAIT_MS;
       break;
       
     case WStype_TEXT:
-      Serial.printf("[%lus] 📨 Received (%d bytes): %s\n", elapsed, length, payload);
-      handleMessage((char*)payload);
+      g_rx_text_frames++;
+      LOG_DEBUG("[%lus] 📨 Received (%d bytes): %s\n", elapsed, length, payload);
+      handleMessage((char*)payload, length);
       break;
       
     case WStype_ERROR:
-      Serial.printf("[%lus] ❌ Error: %s\n", elapsed, payload);
+      LOG_WARN("[%lus] ❌ Error: %s\n", elapsed, payload);
       break;
       
     case WStype_PING:
-      Serial.printf("[%lus] 🏓 Ping\n", elapsed);
+      LOG_DEBUG("[%lus] 🏓 Ping\n", elapsed);
       break;
       
     case WStype_PONG:
-      Serial.printf("[%lus] 🏓 Pong\n", elapsed);
+      LOG_DEBUG("[%lus] 🏓 Pong\n", elapsed);
       break;
       
     default:
-      Serial.printf("[%lus] 🔶 Event type: %d\n", elapsed, type);
+      LOG_DEBUG("[%lus] 🔶 Event type: %d\n", elapsed, type);
       break;
   }
 }
 
 void initWebSocket() {
-  Serial.printf("🔌 WebSocket: ws://%s:%d%s\n", server_host, server_port, server_path);
+  LOG_INFO("🔌 WebSocket: ws://%s:%d%s\n", server_host, server_port, server_path);
   
+  initInboundFilter();
   webSocket.begin(server_host, server_port, server_path);
   webSocket.onEvent(webSocketEvent);
   webSocket.setReconnectInterval(10000);
+  webSocket.enableHeartbeat(WS_HEARTBEAT_INTERVAL_MS, WS_HEARTBEAT_PONG_TIMEOUT_MS, WS_HEARTBEAT_MAX_MISSED);
   
-  Serial.printf("⚙️ WebSocket configured for room: %s\n", TARGET_ROOM);
-  Serial.printf("📊 Sensor data source: %s\n", g_sensor_data_valid ? "真实传感器" : "模拟数据");
+  LOG_INFO("⚙️ WebSocket configured for room: %s\n", NODE_LOCATION);
+  LOG_INFO("📊 Sensor data source: %s\n", g_sensor_data_valid ? "真实传感器" : "模拟数据");
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+// 离线上传队列（store-and-forward）
+// WebSocket断开时把读数存入RAM环形队列，RAM满时整批溢出到LittleFS文件
+// 重连后由network.h按批次、限速地补传，先补传文件中更早的数据，再补传RAM中的数据
+
+#define OFFLINE_QUEUE_RAM_SIZE 32          // RAM队列容量（条）
+#define OFFLINE_QUEUE_FILE_MAX 512         // 文件最多保存的未发送记录数（每条16字节）
+#define OFFLINE_QUEUE_FILE "/offline_queue.bin"
+#define OFFLINE_QUEUE_TMP_FILE "/offline_queue.tmp"
+
+#define QUEUED_FLAG_MOTION 0x01            // 窗口内检测到运动
+#define QUEUED_FLAG_PREV_BOOT 0x02         // 记录来自上次启动，timestamp已无意义
+#define QUEUED_FLAG_NO_CLIMATE 0x04        // 没有温湿度读数（集线器通道未接AHT21）
+#define QUEUED_FLAG_NO_AIR 0x08            // 没有CO2/VOC读数
+#define QUEUED_FLAG_NO_LIGHT 0x10          // 没有光照读数
+#define QUEUED_FLAG_NO_MOTION 0x20         // 没有运动检测
+
+// 一条离线读数，定点格式与sample_buffer.h一致
+struct __attribute__((packed)) QueuedReading {
+  uint32_t timestamp;      // 采集时的millis()
+  int16_t temperature;     // 0.01°C
+  uint16_t humidity;       // 0.01%
+  uint16_t co2;            // ppm
+  uint16_t voc;            // ppb
+  uint16_t light_level;    // 2lux（SAMPLE_LIGHT定点值）
+  uint8_t flags;
+  uint8_t room;            // 集线器模式下为HUB_ROOMS的下标，单房间模式为0
+};
+static_assert(sizeof(QueuedReading) == 16, "QueuedReading必须为16字节");
+
+// 文件格式：4字节已发送记录数（读位置） + 连续的QueuedReading记录
+QueuedReading g_offline_ram[OFFLINE_QUEUE_RAM_SIZE];
+uint8_t g_offline_ram_head = 0;     // 最旧记录的位置
+uint8_t g_offline_ram_count = 0;
+
+bool g_fs_ready = false;            // LittleFS是否挂载成功
+uint32_t g_offline_file_read = 0;   // 文件中已补传的记录数
+uint32_t g_offline_file_total = 0;  // 文件中的记录总数
+uint32_t g_offline_prev_boot_end = 0; // 启动时文件中已有的记录数
+uint32_t g_offline_dropped = 0;     // 队列满时丢弃的记录数
+
+uint32_t offlineFilePending() {
+  return g_offline_file_total - g_offline_file_read;
+}
+
+size_t offlineQueueSize() {
+  return offlineFilePending() + g_offline_ram_count;
+}
+
+void writeOfflineFileHeader() {
+  File f = LittleFS.open(OFFLINE_QUEUE_FILE, "r+");
+  if (!f) {
+    return;
+  }
+  f.seek(0);
+  f.write((const uint8_t*)&g_offline_file_read, sizeof(g_offline_file_read));
+  f.close();
+}
+
+// LittleFS由离线队列和WiFi提示信息（wifi_manager.h）共用，setup()中只挂载一次
+bool mountFileSystem() {
+  g_fs_ready = LittleFS.begin();
+  if (!g_fs_ready) {
+    LOG_WARN("⚠️ LittleFS挂载失败，离线队列仅使用RAM，WiFi不保存快速重连信息\n");
+  }
+  return g_fs_ready;
+}
+
+bool initOfflineQueue() {
+  if (!g_fs_ready) {
+    return false;
+  }
+
+  if (LittleFS.exists(OFFLINE_QUEUE_FILE)) {
+    File f = LittleFS.open(OFFLINE_QUEUE_FILE, "r");
+    if (f && f.size() >= sizeof(uint32_t)) {
+      f.read((uint8_t*)&g_offline_file_read, sizeof(g_offline_file_read));
+      g_offline_file_total = (f.size() - sizeof(uint32_t)) / sizeof(QueuedReading);
+    }
+    if (f) {
+      f.close();
+    }
+    if (g_offline_file_read >= g_offline_file_total) {
+      LittleFS.remove(OFFLINE_QUEUE_FILE);
+      g_offline_file_read = 0;
+      g_offline_file_total = 0;
+    }
+  }
+  g_offline_prev_boot_end = g_offline_file_total;
+
+  LOG_INFO("✅ 离线队列就绪，文件中待补传 %u 条\n", offlineFilePending());
+  return true;
+}
+
+// 补传中途反复断线时文件只增不减（全部补传完才删除），已补传的前缀超过OFFLINE_QUEUE_FILE_MAX条时
+// 把未补传的记录复制到新文件，文件最大约为2 * OFFLINE_QUEUE_FILE_MAX条
+bool compactOfflineFile() {
+  File src = LittleFS.open(OFFLINE_QUEUE_FILE, "r");
+  File dst = LittleFS.open(OFFLINE_QUEUE_TMP_FILE, "w");
+  if (!src || !dst) {
+    if (src) src.close();
+    if (dst) dst.close();
+    return false;
+  }
+
+  uint32_t readPos = 0;
+  dst.write((const uint8_t*)&readPos, sizeof(readPos));
+  src.seek(sizeof(uint32_t) + g_offline_file_read * sizeof(QueuedReading));
+  QueuedReading chunk[8];
+  uint32_t copied = 0;
+  uint32_t pending = offlineFilePending();
+  while (copied < pending) {
+    size_t n = pending - copied < 8 ? pending - copied : 8;
+    size_t bytes = n * sizeof(QueuedReading);
+    if (src.read((uint8_t*)chunk, bytes) != bytes || dst.write((const uint8_t*)chunk, bytes) != bytes) {
+      break;
+    }
+    copied += n;
+  }
+  src.close();
+  dst.close();
+
+  if (copied != pending || !LittleFS.remove(OFFLINE_QUEUE_FILE) ||
+      !LittleFS.rename(OFFLINE_QUEUE_TMP_FILE, OFFLINE_QUEUE_FILE)) {
+    LittleFS.remove(OFFLINE_QUEUE_TMP_FILE);
+    LOG_WARN("⚠️ 离线队列文件压缩失败\n");
+    return false;
+  }
+
+  g_offline_prev_boot_end = g_offline_prev_boot_end > g_offline_file_read ?
+                            g_offline_prev_boot_end - g_offline_file_read : 0;
+  LOG_DEBUG("💾 离线队列文件压缩：丢弃已补传的 %u 条，保留 %u 条\n", g_offline_file_read, pending);
+  g_offline_file_read = 0;
+  g_offline_file_total = pending;
+  return true;
+}
+
+// 把RAM队列整批写入文件（一次闪存写入）
+bool spillOfflineRamToFile() {
+  if (!g_fs_ready || offlineFilePending() + g_offline_ram_count > OFFLINE_QUEUE_FILE_MAX) {
+    return false;
+  }
+  if (g_offline_file_read >= OFFLINE_QUEUE_FILE_MAX && !compactOfflineFile()) {
+    return false;
+  }
+
+  bool created = !LittleFS.exists(OFFLINE_QUEUE_FILE);
+  File f = LittleFS.open(OFFLINE_QUEUE_FILE, "a");
+  if (!f) {
+    return false;
+  }
+  if (created) {
+    uint32_t readPos = 0;
+    f.write((const uint8_t*)&readPos, sizeof(readPos));
+  }
+  for (uint8_t i = 0; i < g_offline_ram_count; i++) {
+    const QueuedReading& r = g_offline_ram[(g_offline_ram_head + i) % OFFLINE_QUEUE_RAM_SIZE];
+    f.write((const uint8_t*)&r, sizeof(r));
+  }
+  f.close();
+
+  g_offline_file_total += g_offline_ram_count;
+  g_offline_ram_head = 0;
+  g_offline_ram_count = 0;
+  LOG_DEBUG("💾 离线队列溢出到文件，文件中待补传 %u 条\n", offlineFilePending());
+  return true;
+}
+
+void enqueueOfflineReading(const QueuedReading& reading) {
+  if (g_offline_ram_count == OFFLINE_QUEUE_RAM_SIZE && !spillOfflineRamToFile()) {
+    // 文件也满了：丢弃RAM中最旧的一条
+    g_offline_ram_head = (g_offline_ram_head + 1) % OFFLINE_QUEUE_RAM_SIZE;
+    g_offline_ram_count--;
+    g_offline_dropped++;
+  }
+
+  g_offline_ram[(g_offline_ram_head + g_offline_ram_count) % OFFLINE_QUEUE_RAM_SIZE] = reading;
+  g_offline_ram_count++;
+}
+
+// 取出最旧的最多maxCount条记录（不出队），fromFile表示来源，用于popOfflineReadings()
+size_t peekOfflineReadings(QueuedReading* out, size_t maxCount, bool& fromFile) {
+  size_t n = 0;
+  fromFile = offlineFilePending() > 0;
+
+  if (fromFile) {
+    File f = LittleFS.open(OFFLINE_QUEUE_FILE, "r");
+    if (!f) {
+      return 0;
+    }
+    f.seek(sizeof(uint32_t) + g_offline_file_read * sizeof(QueuedReading));
+    while (n < maxCount && g_offline_file_read + n < g_offline_file_total) {
+      if (f.read((uint8_t*)&out[n], sizeof(QueuedReading)) != sizeof(QueuedReading)) {
+        break;
+      }
+      if (g_offline_file_read + n < g_offline_prev_boot_end) {
+        out[n].flags |= QUEUED_FLAG_PREV_BOOT;
+      }
+      n++;
+    }
+    f.close();
+    return n;
+  }
+
+  while (n < maxCount && n < g_offline_ram_count) {
+    out[n] = g_offline_ram[(g_offline_ram_head + n) % OFFLINE_QUEUE_RAM_SIZE];
+    n++;
+  }
+  return n;
+}
+
+// 补传成功后出队
+void popOfflineReadings(size_t count, bool fromFile) {
+  if (fromFile) {
+    g_offline_file_read += count;
+    if (g_offline_file_read >= g_offline_file_total) {
+      LittleFS.remove(OFFLINE_QUEUE_FILE);
+      g_offline_prev_boot_end = 0;
+      g_offline_file_read = 0;
+      g_offline_file_total = 0;
+    } else {
+      writeOfflineFileHeader();
+    }
+    return;
+  }
+
+  if (count > g_offline_ram_count) {
+    count = g_offline_ram_count;
+  }
+  g_offline_ram_head = (g_offline_ram_head + count) % OFFLINE_QUEUE_RAM_SIZE;
+  g_offline_ram_count -= count;
+}
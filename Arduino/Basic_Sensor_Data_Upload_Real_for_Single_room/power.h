@@ -0,0 +1,209 @@
+// 低功耗模式（电池供电的房间节点）
+//   POWER_MODE_ALWAYS_ON   - WiFi常开（默认，原有行为）
+//   POWER_MODE_MODEM_SLEEP - 传感器持续采样，射频只在上报窗口打开；
+//                            睡眠期间的读数进入离线队列，醒来后批量补传
+//   POWER_MODE_DEEP_SLEEP  - 每次唤醒采样一次，读数暂存在RTC内存，攒够一批才联网上报；
+//                            使用缓存的BSSID/信道/IP快速重连
+
+#define POWER_MODE_ALWAYS_ON 0
+#define POWER_MODE_MODEM_SLEEP 1
+#define POWER_MODE_DEEP_SLEEP 2
+
+#define POWER_MODE POWER_MODE_ALWAYS_ON
+
+// 调制解调器睡眠模式
+#define POWER_REPORT_WINDOW_MS 300000   // 上报窗口间隔（射频关闭时长）
+#define POWER_AWAKE_TIMEOUT_MS 20000    // 每个窗口保持联网的最长时间
+#define POWER_CONNECT_TIMEOUT_MS 8000   // 醒来后连接WiFi/服务器的超时
+
+// 深度睡眠模式
+#define DEEP_SLEEP_INTERVAL_S 60        // 唤醒采样间隔
+#define DEEP_SLEEP_BATCH_SIZE 10        // 攒够多少条读数联网上报一次（不超过RTC_BATCH_CAPACITY）
+#define DEEP_SLEEP_UPLOAD_TIMEOUT_MS 10000
+
+#define RTC_STATE_MAGIC 0x52544331      // "RTC1"
+#define RTC_BATCH_CAPACITY 16
+
+// 深度睡眠期间保存在RTC内存中的状态（RTC用户内存共512字节）
+struct RtcState {
+  uint32_t magic;
+  uint32_t crc;             // 以下字段的CRC32
+  uint32_t clock_ms;        // 跨睡眠累计的虚拟时钟
+  uint8_t batch_count;
+  uint8_t last_motion;
+  uint8_t reserved[2];
+  WiFiHints hints;
+  QueuedReading batch[RTC_BATCH_CAPACITY];
+};
+static_assert(sizeof(RtcState) <= 512, "RtcState超出RTC用户内存");
+static_assert(DEEP_SLEEP_BATCH_SIZE <= RTC_BATCH_CAPACITY, "DEEP_SLEEP_BATCH_SIZE超出RTC批量容量");
+
+// 调制解调器睡眠模式的运行状态
+bool g_radio_asleep = false;
+bool g_radio_wake_requested = false;
+bool g_window_reported = false;
+unsigned long g_radio_sleep_start = 0;
+unsigned long g_radio_wake_time = 0;
+
+uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+uint32_t rtcStateCrc(const RtcState& state) {
+  const uint8_t* start = (const uint8_t*)&state.clock_ms;
+  return crc32(start, sizeof(RtcState) - offsetof(RtcState, clock_ms));
+}
+
+// ===== 调制解调器睡眠模式 =====
+
+void sleepRadio() {
+  LOG_DEBUG("😴 上报窗口结束，关闭射频\n");
+  webSocket.disconnect();
+  wsConnected = false;
+  WiFi.disconnect();
+  WiFi.forceSleepBegin();
+  g_radio_asleep = true;
+  g_radio_wake_requested = false;
+  g_radio_sleep_start = millis();
+}
+
+void wakeRadio() {
+  LOG_DEBUG("⏰ 上报窗口开始，打开射频\n");
+  WiFi.forceSleepWake();
+  g_radio_asleep = false;
+  g_window_reported = false;
+  g_radio_wake_time = millis();
+  wifiStartReconnect();  // 非阻塞，由wifiManagerLoop()完成连接
+}
+
+// 运动等实时事件可以提前唤醒射频
+void requestRadioWake() {
+  g_radio_wake_requested = true;
+}
+
+// 在loop()中调用；返回false表示射频处于睡眠，本轮跳过网络处理
+bool updatePowerManager() {
+  #if POWER_MODE == POWER_MODE_MODEM_SLEEP
+  unsigned long now = millis();
+
+  if (g_radio_asleep) {
+    if (g_radio_wake_requested || now - g_radio_sleep_start >= POWER_REPORT_WINDOW_MS) {
+      wakeRadio();
+    }
+    return !g_radio_asleep;
+  }
+
+  // 连上服务器后network.h的首次上传任务会上报当前窗口，然后等离线队列补传完毕再睡眠
+  if (wsConnected && !g_first_upload_pending) {
+    g_window_reported = true;
+  }
+
+  bool windowDone = g_window_reported && offlineQueueSize() == 0;
+  if (windowDone || now - g_radio_wake_time >= POWER_AWAKE_TIMEOUT_MS) {
+    sleepRadio();
+    return false;
+  }
+  #endif
+  return true;
+}
+
+// ===== 深度睡眠模式 =====
+
+// 唤醒后执行一次完整的采样/上报周期，然后进入深度睡眠，不会返回
+void runDeepSleepCycle() {
+  RtcState state;
+  ESP.rtcUserMemoryRead(0, (uint32_t*)&state, sizeof(state));
+
+  if (state.magic != RTC_STATE_MAGIC || state.crc != rtcStateCrc(state)) {
+    LOG_INFO("🆕 RTC状态无效（冷启动），重新初始化\n");
+    memset(&state, 0, sizeof(state));
+    state.magic = RTC_STATE_MAGIC;
+  }
+  loadWiFiHints();
+  if (state.hints.valid) {
+    g_wifi_hints = state.hints;  // RTC中的提示信息比闪存中的更新
+  }
+
+  // 采样一次（setup已完成首次读取）并暂存到RTC批量中
+  if (state.batch_count == RTC_BATCH_CAPACITY) {
+    memmove(&state.batch[0], &state.batch[1], sizeof(QueuedReading) * (RTC_BATCH_CAPACITY - 1));
+    state.batch_count--;
+  }
+  QueuedReading& reading = state.batch[state.batch_count++];
+  reading.timestamp = state.clock_ms + millis();
+  reading.temperature = toFixedSample(SAMPLE_TEMPERATURE, g_temperature);
+  reading.humidity = toFixedSample(SAMPLE_HUMIDITY, g_humidity);
+  reading.co2 = toFixedSample(SAMPLE_CO2, g_co2);
+  reading.voc = toFixedSample(SAMPLE_VOC, g_voc);
+  reading.light_level = toFixedSample(SAMPLE_LIGHT, g_light_level);
+  reading.flags = g_motion ? QUEUED_FLAG_MOTION : 0;
+  reading.room = 0;
+
+  // 批量攒满或运动状态变化时联网上报
+  bool motionEdge = g_motion != (bool)state.last_motion;
+  state.last_motion = g_motion;
+
+  if (g_sensor_data_valid && (state.batch_count >= DEEP_SLEEP_BATCH_SIZE || motionEdge)) {
+    LOG_DEBUG("📤 深度睡眠批量上报 %u 条读数\n", state.batch_count);
+    WiFi.forceSleepWake();
+
+    if (connectWiFiBlocking(POWER_CONNECT_TIMEOUT_MS)) {
+      initWebSocket();
+
+      unsigned long start = millis();
+      while (!wsConnected && millis() - start < POWER_CONNECT_TIMEOUT_MS) {
+        webSocket.loop();
+        delay(10);
+      }
+
+      if (wsConnected) {
+        sendSubscribe();  // 上传期间不接收其他房间的广播
+        
+        // 把RTC中的读数转入离线队列，沿用离线补传的批量格式；
+        // 时间戳换算到本次启动的millis()，使age_ms仍然正确
+        uint32_t nowClock = state.clock_ms + millis();
+        for (uint8_t i = 0; i < state.batch_count; i++) {
+          QueuedReading queued = state.batch[i];
+          queued.timestamp = millis() - (nowClock - state.batch[i].timestamp);
+          enqueueOfflineReading(queued);
+        }
+        state.batch_count = 0;
+
+        lastOfflineDrainTime = millis() - OFFLINE_DRAIN_INTERVAL_MS;
+        start = millis();
+        while (offlineQueueSize() > 0 && wsConnected && millis() - start < DEEP_SLEEP_UPLOAD_TIMEOUT_MS) {
+          webSocket.loop();
+          drainOfflineQueue();
+          delay(10);
+        }
+        webSocket.disconnect();
+      }
+    }
+    state.hints = g_wifi_hints;
+  }
+
+  // 保存状态并睡眠
+  state.clock_ms += millis() + DEEP_SLEEP_INTERVAL_S * 1000UL;
+  state.crc = rtcStateCrc(state);
+  ESP.rtcUserMemoryWrite(0, (uint32_t*)&state, sizeof(state));
+
+  LOG_DEBUG("😴 进入深度睡眠 %d 秒（RTC暂存 %u 条）\n", DEEP_SLEEP_INTERVAL_S, state.batch_count);
+  Serial.flush();
+  ESP.deepSleep(DEEP_SLEEP_INTERVAL_S * 1000000ULL);
+}
+
+// setup()最开始调用：深度睡眠模式下先关闭射频，只有需要上报时才打开
+void beginPowerMode() {
+  #if POWER_MODE == POWER_MODE_DEEP_SLEEP
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_OFF);
+  WiFi.forceSleepBegin();
+  #endif
+}
@@ -0,0 +1,108 @@
+// 上报策略
+// REPORT_ON_CHANGE为true时，只有读数超出死区、运动状态变化或超过最长静默时间才上报
+// 为false时保持原来的固定周期上报
+
+#define REPORT_ON_CHANGE true
+
+#define SENSOR_INTERVAL 15000           // 固定周期模式的上报间隔
+#define REPORT_MIN_INTERVAL_MS 1000     // 变化触发上报的最小间隔，防止读数抖动时连续上报
+#define REPORT_MAX_SILENCE_MS 60000     // 无变化时的心跳上报间隔
+
+// 各字段死区：与上次上报值的差超过死区才触发上报
+#define DEADBAND_TEMPERATURE 0.2        // °C
+#define DEADBAND_HUMIDITY 1.0           // %
+#define DEADBAND_CO2 20                 // ppm
+#define DEADBAND_VOC 10                 // ppb
+#define DEADBAND_LIGHT_LEVEL 50         // lux
+
+// 上次上报时的读数，也用来传递本次的当前读数
+struct ReportSnapshot {
+  float temperature;
+  float humidity;
+  int co2;
+  int voc;
+  int light_level;
+  bool motion;
+};
+
+// 参与死区比较的字段，按SampleField编号取位
+#define REPORT_FIELD(field) (1 << (field))
+#define REPORT_FIELDS_ALL ((1 << SAMPLE_FIELD_COUNT) - 1)
+
+ReportSnapshot g_last_report;
+bool g_has_reported = false;
+unsigned long g_last_report_time = 0;
+
+// 单房间模式的当前读数
+ReportSnapshot currentReadings() {
+  ReportSnapshot current;
+  current.temperature = g_temperature;
+  current.humidity = g_humidity;
+  current.co2 = g_co2;
+  current.voc = g_voc;
+  current.light_level = g_light_level;
+  current.motion = g_motion;
+  return current;
+}
+
+// 首次上报、心跳和最小间隔的判断，单房间与集线器模式共用
+// 返回触发原因或nullptr；compare为true时调用方还需要做死区比较
+const char* checkReportSchedule(bool hasReported, unsigned long lastReportTime, bool& compare) {
+  unsigned long sinceLast = millis() - lastReportTime;
+  compare = false;
+
+  if (!hasReported) {
+    return "first";
+  }
+
+  #if REPORT_ON_CHANGE
+  if (sinceLast >= REPORT_MAX_SILENCE_MS) {
+    return "heartbeat";
+  }
+  compare = sinceLast >= REPORT_MIN_INTERVAL_MS;
+  return nullptr;
+  #else
+  return sinceLast >= SENSOR_INTERVAL ? "interval" : nullptr;
+  #endif
+}
+
+// 当前读数与上次上报值的死区比较，只比较fields中的字段；返回超出死区的字段名，nullptr表示都在死区内
+const char* checkDeadband(const ReportSnapshot& current, const ReportSnapshot& last, uint8_t fields) {
+  // 运动状态的边沿立即上报
+  if ((fields & REPORT_FIELD(SAMPLE_MOTION)) && current.motion != last.motion) {
+    return "motion";
+  }
+  if ((fields & REPORT_FIELD(SAMPLE_TEMPERATURE)) && fabs(current.temperature - last.temperature) >= DEADBAND_TEMPERATURE) {
+    return "temperature";
+  }
+  if ((fields & REPORT_FIELD(SAMPLE_HUMIDITY)) && fabs(current.humidity - last.humidity) >= DEADBAND_HUMIDITY) {
+    return "humidity";
+  }
+  if ((fields & REPORT_FIELD(SAMPLE_CO2)) && abs(current.co2 - last.co2) >= DEADBAND_CO2) {
+    return "co2";
+  }
+  if ((fields & REPORT_FIELD(SAMPLE_VOC)) && abs(current.voc - last.voc) >= DEADBAND_VOC) {
+    return "voc";
+  }
+  if ((fields & REPORT_FIELD(SAMPLE_LIGHT)) && abs(current.light_level - last.light_level) >= DEADBAND_LIGHT_LEVEL) {
+    return "light_level";
+  }
+  return nullptr;
+}
+
+// 检查是否需要上报，返回触发原因，nullptr表示暂不上报
+const char* checkReportTrigger() {
+  bool compare;
+  const char* reason = checkReportSchedule(g_has_reported, g_last_report_time, compare);
+  if (!compare) {
+    return reason;
+  }
+  return checkDeadband(currentReadings(), g_last_report, REPORT_FIELDS_ALL);
+}
+
+// 上报后记录当前读数，作为下一次死区比较的基准
+void markReported() {
+  g_last_report = currentReadings();
+  g_has_reported = true;
+  g_last_report_time = millis();
+}
@@ -0,0 +1,168 @@
+// 传感器采样环形缓冲区
+// 每个字段一个静态环形缓冲区，样本为16位定点值 + 与上一样本的时间差
+// 单房间模式用g_sample_rings，集线器模式每个房间一组（hub.h）
+// 温度按int16存储，其余字段非负，按uint16存储
+// 上传时对当前窗口内的样本计算 min/max/mean/last，不使用堆内存
+
+// 每个字段保留的样本数（每个样本4字节）
+#define SAMPLE_RING_SIZE 64
+
+// 采样字段
+enum SampleField {
+  SAMPLE_TEMPERATURE,  // 温度，0.01°C
+  SAMPLE_HUMIDITY,     // 湿度，0.01%
+  SAMPLE_CO2,          // CO2，ppm
+  SAMPLE_VOC,          // VOC，ppb
+  SAMPLE_LIGHT,        // 光照，2lux（VEML7700最高约120000lux，最大131070）
+  SAMPLE_MOTION,       // 运动，0/1（均值即有人占比）
+  SAMPLE_FIELD_COUNT
+};
+
+// 各字段的上传名称与定点缩放系数
+const char* const SAMPLE_FIELD_NAMES[SAMPLE_FIELD_COUNT] = {
+  "temperature", "humidity", "co2", "voc", "light_level", "motion"
+};
+const float SAMPLE_FIELD_SCALE[SAMPLE_FIELD_COUNT] = {
+  100.0, 100.0, 1.0, 1.0, 0.5, 1.0
+};
+const bool SAMPLE_FIELD_SIGNED[SAMPLE_FIELD_COUNT] = {
+  true, false, false, false, false, false
+};
+
+struct Sample {
+  uint16_t value;   // 定点值（有符号字段按int16解释）
+  uint16_t dt_ms;   // 与上一个样本的时间差（超过65535ms饱和）
+};
+
+struct SampleRing {
+  Sample samples[SAMPLE_RING_SIZE];
+  uint8_t head;             // 下一个写入位置
+  uint8_t count;            // 当前窗口内的样本数（不超过SAMPLE_RING_SIZE）
+  bool has_sample;          // 是否采集过样本，用于计算第一个时间差
+  unsigned long last_ms;    // 最新样本的绝对时间
+};
+
+// 一个上传窗口的统计结果（已换算回物理单位）
+struct WindowStats {
+  float min;
+  float max;
+  float mean;
+  float last;
+  uint8_t count;            // 窗口内样本数，0表示窗口内没有新样本
+  unsigned long span_ms;    // 窗口内第一个到最后一个样本的时间跨度
+};
+
+SampleRing g_sample_rings[SAMPLE_FIELD_COUNT];
+
+// 浮点值转定点并限制在该字段的int16/uint16范围内
+int32_t toFixedSample(SampleField field, float value) {
+  float scaled = value * SAMPLE_FIELD_SCALE[field];
+  float lo = SAMPLE_FIELD_SIGNED[field] ? -32768.0 : 0.0;
+  float hi = SAMPLE_FIELD_SIGNED[field] ? 32767.0 : 65535.0;
+  if (scaled > hi) return (int32_t)hi;
+  if (scaled < lo) return (int32_t)lo;
+  return (int32_t)(scaled >= 0 ? scaled + 0.5 : scaled - 0.5);
+}
+
+int32_t sampleValue(SampleField field, const Sample& sample) {
+  return SAMPLE_FIELD_SIGNED[field] ? (int32_t)(int16_t)sample.value : (int32_t)sample.value;
+}
+
+float fromFixedSample(SampleField field, int32_t value) {
+  return value / SAMPLE_FIELD_SCALE[field];
+}
+
+// 记录一个样本，缓冲区满时覆盖最旧的样本
+void pushSample(SampleRing& ring, SampleField field, float value) {
+  unsigned long now = millis();
+
+  unsigned long dt = ring.has_sample ? now - ring.last_ms : 0;
+  ring.samples[ring.head].value = (uint16_t)toFixedSample(field, value);
+  ring.samples[ring.head].dt_ms = dt > 65535UL ? 65535 : (uint16_t)dt;
+  ring.head = (ring.head + 1) % SAMPLE_RING_SIZE;
+  if (ring.count < SAMPLE_RING_SIZE) {
+    ring.count++;
+  }
+  ring.has_sample = true;
+  ring.last_ms = now;
+}
+
+void pushSample(SampleField field, float value) {
+  pushSample(g_sample_rings[field], field, value);
+}
+
+// 一个上传窗口的定点统计（二进制帧直接发送，服务器用sum/count还原均值）
+struct WindowRaw {
+  int32_t min;
+  int32_t max;
+  int32_t sum;
+  int32_t last;
+  uint8_t count;
+  unsigned long span_ms;
+};
+
+// 计算当前窗口的定点统计；窗口内没有样本时返回false
+bool getWindowRaw(const SampleRing& ring, SampleField field, WindowRaw& raw) {
+  raw.count = ring.count;
+  raw.span_ms = 0;
+  if (ring.count == 0) {
+    return false;
+  }
+
+  // 从窗口内最旧的样本开始遍历
+  uint8_t index = (ring.head + SAMPLE_RING_SIZE - ring.count) % SAMPLE_RING_SIZE;
+  raw.min = sampleValue(field, ring.samples[index]);
+  raw.max = raw.min;
+  raw.sum = 0;
+
+  for (uint8_t i = 0; i < ring.count; i++) {
+    const Sample& sample = ring.samples[index];
+    int32_t value = sampleValue(field, sample);
+    if (value < raw.min) raw.min = value;
+    if (value > raw.max) raw.max = value;
+    raw.sum += value;
+    if (i > 0) {
+      raw.span_ms += sample.dt_ms;
+    }
+    index = (index + 1) % SAMPLE_RING_SIZE;
+  }
+
+  uint8_t lastIndex = (ring.head + SAMPLE_RING_SIZE - 1) % SAMPLE_RING_SIZE;
+  raw.last = sampleValue(field, ring.samples[lastIndex]);
+  return true;
+}
+
+// 计算当前窗口的统计结果（物理单位）；窗口内没有样本时返回false
+bool getWindowStats(const SampleRing& ring, SampleField field, WindowStats& stats) {
+  WindowRaw raw;
+  bool ok = getWindowRaw(ring, field, raw);
+  stats.count = raw.count;
+  stats.span_ms = raw.span_ms;
+  if (!ok) {
+    return false;
+  }
+  stats.min = fromFixedSample(field, raw.min);
+  stats.max = fromFixedSample(field, raw.max);
+  stats.mean = fromFixedSample(field, raw.sum) / raw.count;
+  stats.last = fromFixedSample(field, raw.last);
+  return true;
+}
+
+bool getWindowRaw(SampleField field, WindowRaw& raw) {
+  return getWindowRaw(g_sample_rings[field], field, raw);
+}
+
+bool getWindowStats(SampleField field, WindowStats& stats) {
+  return getWindowStats(g_sample_rings[field], field, stats);
+}
+
+// 上传成功后开始新窗口（保留样本数据，只清空窗口计数）
+void resetSampleWindow(SampleRing* rings) {
+  for (int i = 0; i < SAMPLE_FIELD_COUNT; i++) {
+    rings[i].count = 0;
+  }
+}
+
+void resetSampleWindow() {
+  resetSampleWindow(g_sample_rings);
+}
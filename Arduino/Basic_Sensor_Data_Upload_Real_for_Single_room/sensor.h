@@ -3,12 +3,17 @@
 #define ENABLE_GL5539 true     // 模拟光敏电阻传感器 (与VEML7700二选一)
 #define ENABLE_ENS160 true     // 空气质量传感器
 #define ENABLE_AHT21 true      // 温湿度传感器
+#define ENABLE_ENS160_COMPENSATION true  // 用AHT21温湿度补偿ENS160 (需同时启用两者)
 
 // 光照传感器二选一检查
 #if ENABLE_VEML7700 && ENABLE_GL5539
 #error "只能启用一个光照传感器：VEML7700或GL5539，请设置其中一个为false"
 #endif
 
+#if ENABLE_ENS160_COMPENSATION && !(ENABLE_ENS160 && ENABLE_AHT21)
+#error "ENS160温湿度补偿需要同时启用ENS160和AHT21"
+#endif
+
 // 传感器I2C地址
 #define VEML7700_ADDR 0x10
 #define ENS160_ADDR 0x53
@@ -20,6 +25,16 @@
 #define GL5539_R_PULLUP 10000   // 上拉电阻值 (10kΩ)
 #define GL5539_ADC_MAX 1024     // ESP8266 ADC最大值
 
+// GL5539过采样：一次测量累加GL5539_OVERSAMPLE个ADC样本，每次loop只采GL5539_SAMPLES_PER_POLL个，
+// 把采样分散到多次loop中；累加和抽取为1/4 ADC计数（12位）后查表换算lux
+#define GL5539_OVERSAMPLE 32          // 16-64，必须是2的幂
+#define GL5539_SAMPLES_PER_POLL 4
+#define GL5539_LUT_STEP 8             // 查找表相邻表项之间的ADC计数
+
+static_assert(GL5539_OVERSAMPLE >= 16 && GL5539_OVERSAMPLE <= 64 &&
+              (GL5539_OVERSAMPLE & (GL5539_OVERSAMPLE - 1)) == 0, "GL5539_OVERSAMPLE必须是16-64之间的2的幂");
+static_assert(GL5539_ADC_MAX % GL5539_LUT_STEP == 0, "GL5539_LUT_STEP必须整除GL5539_ADC_MAX");
+
 // ENS160寄存器地址
 #define ENS160_PART_ID 0x00
 #define ENS160_OPMODE 0x10
@@ -32,11 +47,51 @@
 #define ENS160_DATA_TVOC 0x22
 #define ENS160_DATA_ECO2 0x24
 
+// ENS160数据寄存器0x20-0x25的内存布局（小端，与ESP8266一致）
+struct __attribute__((packed)) ENS160DataFrame {
+  uint8_t status;   // 0x20 DATA_STATUS
+  uint8_t aqi;      // 0x21 DATA_AQI
+  uint16_t tvoc;    // 0x22-0x23 DATA_TVOC (ppb)
+  uint16_t eco2;    // 0x24-0x25 DATA_ECO2 (ppm)
+};
+static_assert(sizeof(ENS160DataFrame) == 6, "ENS160DataFrame必须与寄存器布局一致");
+
 // AHT21命令
 #define AHT21_INIT_CMD 0xBE
 #define AHT21_MEASURE_CMD 0xAC
 #define AHT21_SOFT_RESET_CMD 0xBA
 
+// AHT21异步测量时序
+#define AHT21_MEASURE_DELAY_MS 80   // 触发后等待测量完成的时间
+#define AHT21_BUSY_RETRY_MS 10      // 设备忙碌时的重试间隔
+#define AHT21_MAX_BUSY_RETRIES 5    // 忙碌重试次数上限
+
+// 各传感器采样周期（毫秒），由传感器调度器独立调度
+#define AHT21_SAMPLE_PERIOD_MS 10000    // 温湿度变化慢，0.1Hz
+#define ENS160_SAMPLE_PERIOD_MS 1000    // ENS160内部每秒更新一次
+#define GL5539_SAMPLE_PERIOD_MS 1000    // 1Hz
+#define VEML7700_SAMPLE_PERIOD_MS 1000  // 1Hz
+#define MOTION_SAMPLE_PERIOD_MS 15000   // 模拟运动检测
+
+// 异步传感器轮询结果
+enum SensorPollResult {
+  SENSOR_IDLE,     // 没有进行中的测量
+  SENSOR_PENDING,  // 测量进行中
+  SENSOR_OK,       // 测量完成且数据有效
+  SENSOR_FAILED    // 通信失败或数据无效
+};
+
+// AHT21测量状态机：IDLE --触发--> MEASURING --截止时间到且不忙--> IDLE
+enum AHT21State {
+  AHT21_IDLE,
+  AHT21_MEASURING
+};
+
+AHT21State g_aht21_state = AHT21_IDLE;
+unsigned long g_aht21_deadline = 0;
+uint8_t g_aht21_busy_retries = 0;
+uint8_t g_aht21_raw[6];  // 最近一次测量的原始数据
+
 // 全局传感器数据变量
 float g_temperature = 23.5;    // 温度 (°C)
 float g_humidity = 55.0;       // 湿度 (%)
@@ -50,7 +105,7 @@ bool g_sensor_data_valid = false;  // 数据有效性标志
 unsigned long g_last_sensor_update = 0;
 
 void scanI2CDevices() {
-  Serial.println("扫描I2C设备...");
+  LOG_INFO("扫描I2C设备...\n");
   byte error, address;
   int deviceCount = 0;
   
@@ -59,347 +114,634 @@ void scanI2CDevices() {
     error = Wire.endTransmission();
     
     if (error == 0) {
-      Serial.print("发现I2C设备，地址: 0x");
-      if (address < 16) Serial.print("0");
-      Serial.println(address, HEX);
+      LOG_INFO("发现I2C设备，地址: 0x%02X\n", address);
       deviceCount++;
     }
   }
   
   if (deviceCount == 0) {
-    Serial.println("未发现I2C设备");
+    LOG_WARN("未发现I2C设备\n");
     g_sensor_data_valid = false;
   } else {
-    Serial.print("发现 ");
-    Serial.print(deviceCount);
-    Serial.println(" 个I2C设备");
+    LOG_INFO("发现 %d 个I2C设备\n", deviceCount);
   }
-  Serial.println();
+  LOG_INFO("\n");
 }
 
 
 #if ENABLE_AHT21
-bool readAHT21() {
-  // 发送测量命令
+// 发送测量命令（0xAC 0x33 0x00）；集线器模式在每个多路复用通道上复用
+bool triggerAHT21() {
   Wire.beginTransmission(AHT21_ADDR);
   Wire.write(AHT21_MEASURE_CMD);
   Wire.write(0x33);
   Wire.write(0x00);
-  byte error = Wire.endTransmission();
+  return Wire.endTransmission() == 0;
+}
+
+// 取回6字节原始数据（状态字节 + 20位湿度 + 20位温度）
+bool fetchAHT21Raw(uint8_t* raw) {
+  Wire.requestFrom(AHT21_ADDR, 6);
+  if (Wire.available() < 6) {
+    return false;
+  }
+  for (int i = 0; i < 6; i++) {
+    raw[i] = Wire.read();
+  }
+  return true;
+}
+
+// 原始数据换算为温湿度，超出正常范围时返回false
+bool parseAHT21(const uint8_t* data, float& temperature, float& humidity) {
+  // 计算湿度
+  uint32_t humidity_raw = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
+  humidity = (humidity_raw * 100.0) / 1048576.0;
   
-  if (error != 0) {
-    Serial.println("❌ AHT21 发送命令失败");
+  // 计算温度
+  uint32_t temperature_raw = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
+  temperature = (temperature_raw * 200.0) / 1048576.0 - 50.0;
+  
+  return temperature > -40 && temperature < 85 && humidity >= 0 && humidity <= 100;
+}
+
+// 触发测量命令，不等待结果
+bool startAHT21() {
+  if (g_aht21_state != AHT21_IDLE) {
+    return false; // 上一次测量尚未结束
+  }
+  
+  if (!triggerAHT21()) {
+    LOG_WARN("❌ AHT21 发送命令失败\n");
     return false;
   }
   
-  delay(80); // 等待测量完成
+  g_aht21_state = AHT21_MEASURING;
+  g_aht21_deadline = millis() + AHT21_MEASURE_DELAY_MS;
+  g_aht21_busy_retries = 0;
+  return true;
+}
+
+// 在loop()中调用，到达截止时间后取回原始数据，不会阻塞
+SensorPollResult pollAHT21() {
+  if (g_aht21_state == AHT21_IDLE) {
+    return SENSOR_IDLE;
+  }
+  
+  // 未到截止时间，直接返回（用差值比较以兼容millis()溢出）
+  if ((long)(millis() - g_aht21_deadline) < 0) {
+    return SENSOR_PENDING;
+  }
   
   // 读取数据
-  Wire.requestFrom(AHT21_ADDR, 6);
-  if (Wire.available() >= 6) {
-    uint8_t data[6];
-    for (int i = 0; i < 6; i++) {
-      data[i] = Wire.read();
-    }
-    
-    // 检查状态位
-    if (data[0] & 0x80) {
-      Serial.println("⚠️ AHT21 设备忙碌，稍后重试");
-      return false;
+  if (!fetchAHT21Raw(g_aht21_raw)) {
+    LOG_WARN("❌ AHT21 读取数据失败\n");
+    g_aht21_state = AHT21_IDLE;
+    return SENSOR_FAILED;
+  }
+  
+  // 检查状态位，忙碌时推迟截止时间再读
+  if (g_aht21_raw[0] & 0x80) {
+    if (++g_aht21_busy_retries > AHT21_MAX_BUSY_RETRIES) {
+      LOG_WARN("⚠️ AHT21 设备持续忙碌，放弃本次测量\n");
+      g_aht21_state = AHT21_IDLE;
+      return SENSOR_FAILED;
     }
+    g_aht21_deadline = millis() + AHT21_BUSY_RETRY_MS;
+    return SENSOR_PENDING;
+  }
+  
+  g_aht21_state = AHT21_IDLE;
+  return SENSOR_OK;
+}
+
+// 解析pollAHT21()取回的原始数据并更新全局变量
+bool readAHT21() {
+  float temperature, humidity;
+  
+  // 数据有效性检查
+  if (parseAHT21(g_aht21_raw, temperature, humidity)) {
+    // 更新全局变量
+    g_temperature = temperature;
+    g_humidity = humidity;
+    pushSample(SAMPLE_TEMPERATURE, temperature);
+    pushSample(SAMPLE_HUMIDITY, humidity);
     
-    // 计算湿度
-    uint32_t humidity_raw = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
-    float humidity = (humidity_raw * 100.0) / 1048576.0;
-    
-    // 计算温度
-    uint32_t temperature_raw = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
-    float temperature = (temperature_raw * 200.0) / 1048576.0 - 50.0;
+    LOG_DEBUG("✅ AHT21 - 温度: %.1f°C, 湿度: %.1f%%\n", temperature, humidity);
     
-    // 数据有效性检查
-    if (temperature > -40 && temperature < 85 && humidity >= 0 && humidity <= 100) {
-      // 更新全局变量
-      g_temperature = temperature;
-      g_humidity = humidity;
-      
-      Serial.print("✅ AHT21 - 温度: ");
-      Serial.print(temperature, 1);
-      Serial.print("°C, 湿度: ");
-      Serial.print(humidity, 1);
-      Serial.println("%");
-      
-      return true;
-    } else {
-      Serial.println("❌ AHT21 数据超出正常范围");
-      return false;
-    }
+    return true;
   } else {
-    Serial.println("❌ AHT21 读取数据失败");
+    LOG_WARN("❌ AHT21 数据超出正常范围\n");
     return false;
   }
 }
+
+bool initAHT21() {
+  Wire.beginTransmission(AHT21_ADDR);
+  Wire.write(AHT21_INIT_CMD);
+  Wire.write(0x08);
+  Wire.write(0x00);
+  byte error = Wire.endTransmission();
+  delay(10);
+  if (error == 0) {
+    LOG_INFO("✅ AHT21 初始化完成\n");
+    return true;
+  }
+  LOG_ERROR("❌ AHT21 初始化失败\n");
+  return false;
+}
 #endif
 
 #if ENABLE_ENS160
-bool readENS160() {
-  // 读取数据状态
+// 一次突发读取DATA_STATUS..DATA_ECO2（0x20-0x25），寄存器地址自动递增
+bool fetchENS160(ENS160DataFrame& frame) {
   Wire.beginTransmission(ENS160_ADDR);
   Wire.write(ENS160_DATA_STATUS);
   byte error = Wire.endTransmission();
   
   if (error != 0) {
-    Serial.println("❌ ENS160 通信失败");
+    LOG_WARN("❌ ENS160 通信失败\n");
     return false;
   }
   
-  Wire.requestFrom(ENS160_ADDR, 1);
-  
-  if (Wire.available()) {
-    uint8_t status = Wire.read();
-    if (status & 0x02) { // 数据准备就绪
-      
-      // 读取AQI
-      Wire.beginTransmission(ENS160_ADDR);
-      Wire.write(ENS160_DATA_AQI);
-      Wire.endTransmission();
-      Wire.requestFrom(ENS160_ADDR, 1);
-      uint8_t aqi = Wire.available() ? Wire.read() : 0;
-      
-      // 读取TVOC
-      Wire.beginTransmission(ENS160_ADDR);
-      Wire.write(ENS160_DATA_TVOC);
-      Wire.endTransmission();
-      Wire.requestFrom(ENS160_ADDR, 2);
-      uint16_t tvoc = 0;
-      if (Wire.available() >= 2) {
-        tvoc = Wire.read() | (Wire.read() << 8);
-      }
-      
-      // 读取CO2
-      Wire.beginTransmission(ENS160_ADDR);
-      Wire.write(ENS160_DATA_ECO2);
-      Wire.endTransmission();
-      Wire.requestFrom(ENS160_ADDR, 2);
-      uint16_t co2 = 400; // 默认值
-      if (Wire.available() >= 2) {
-        co2 = Wire.read() | (Wire.read() << 8);
-      }
-      
-      // 数据有效性检查
-      if (co2 > 300 && co2 < 5000 && tvoc < 10000) {
-        // 更新全局变量
-        g_co2 = co2;
-        g_voc = tvoc;
-        
-        Serial.print("✅ ENS160 - AQI: ");
-        Serial.print(aqi);
-        Serial.print(", TVOC: ");
-        Serial.print(tvoc);
-        Serial.print(" ppb, CO2: ");
-        Serial.print(co2);
-        Serial.println(" ppm");
-        
-        return true;
-      } else {
-        Serial.println("❌ ENS160 数据超出正常范围");
-        return false;
-      }
-    } else {
-      Serial.println("⚠️ ENS160 数据未准备就绪");
-      return false;
-    }
+  uint8_t* raw = (uint8_t*)&frame;
+  Wire.requestFrom(ENS160_ADDR, (int)sizeof(frame));
+  
+  if (Wire.available() < (int)sizeof(frame)) {
+    LOG_WARN("❌ ENS160 读取状态失败\n");
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(frame); i++) {
+    raw[i] = Wire.read();
+  }
+  return true;
+}
+
+// 数据有效性检查
+bool ens160FrameValid(const ENS160DataFrame& frame) {
+  return frame.eco2 > 300 && frame.eco2 < 5000 && frame.tvoc < 10000;
+}
+
+bool readENS160() {
+  ENS160DataFrame frame;
+  if (!fetchENS160(frame)) {
+    return false;
+  }
+  
+  if (!(frame.status & 0x02)) { // 数据准备就绪
+    LOG_DEBUG("⚠️ ENS160 数据未准备就绪\n");
+    return false;
+  }
+  
+  uint8_t aqi = frame.aqi;
+  uint16_t tvoc = frame.tvoc;
+  uint16_t co2 = frame.eco2;
+  
+  if (ens160FrameValid(frame)) {
+    // 更新全局变量
+    g_co2 = co2;
+    g_voc = tvoc;
+    pushSample(SAMPLE_CO2, co2);
+    pushSample(SAMPLE_VOC, tvoc);
+    
+    LOG_DEBUG("✅ ENS160 - AQI: %d, TVOC: %d ppb, CO2: %d ppm\n", aqi, tvoc, co2);
+    
+    return true;
   } else {
-    Serial.println("❌ ENS160 读取状态失败");
+    LOG_WARN("❌ ENS160 数据超出正常范围\n");
     return false;
   }
 }
+
+bool initENS160() {
+  Wire.beginTransmission(ENS160_ADDR);
+  Wire.write(ENS160_OPMODE);
+  Wire.write(0x02); // 标准操作模式
+  byte error = Wire.endTransmission();
+  delay(100);
+  if (error == 0) {
+    LOG_INFO("✅ ENS160 初始化完成\n");
+    return true;
+  }
+  LOG_ERROR("❌ ENS160 初始化失败\n");
+  return false;
+}
+
+#if ENABLE_ENS160_COMPENSATION
+// 把AHT21测得的温湿度写入TEMP_IN/RH_IN（0x13-0x16），提高ENS160的计算精度
+bool writeENS160Compensation(float temperature, float humidity) {
+  // TEMP_IN单位为1/64 K，RH_IN单位为1/512 %，均为低字节在前
+  uint16_t temp_in = (uint16_t)((temperature + 273.15) * 64.0 + 0.5);
+  uint16_t rh_in = (uint16_t)(humidity * 512.0 + 0.5);
+  
+  Wire.beginTransmission(ENS160_ADDR);
+  Wire.write(ENS160_TEMP_IN);
+  Wire.write(temp_in & 0xFF);
+  Wire.write(temp_in >> 8);
+  Wire.write(rh_in & 0xFF);
+  Wire.write(rh_in >> 8);
+  byte error = Wire.endTransmission();
+  
+  if (error != 0) {
+    LOG_WARN("❌ ENS160 写入温湿度补偿失败\n");
+    return false;
+  }
+  return true;
+}
+#endif
 #endif
 
 #if ENABLE_GL5539
+// ===== GL5539 ADC→lux查找表 =====
+// 编译期按原经验公式生成：LDR电阻 = R_pullup * ADC / (ADC_max - ADC)，lux = 12500000 / R^1.4
+// （GL5539典型特性：10lux时约10kΩ，100lux时约1kΩ），结果限制在1-10000lux
+// 原来按电阻截断（>50kΩ为1lux、<100Ω为2000lux）在边界处有跳变，插值时会被抹平，改为按lux连续截断
+// 表项单位为0.01lux（0.1lux在1-2lux的暗端会带来超过5%的量化误差），运行时只做一次整数线性插值，不再调用浮点pow
+// 表在编译期用循环生成，需要C++14的constexpr（ESP8266 Arduino core 3.x起默认gnu++17）
+
+#if __cplusplus < 201402L
+#error "GL5539查找表需要C++14，请使用ESP8266 Arduino core 3.0或更新版本"
+#endif
+
+// 编译期数学函数（std::log/std::exp不是constexpr）
+constexpr double constexprLn(double x) {
+  // x = m * 2^k，m在[1,2)内；ln(m) = 2*atanh((m-1)/(m+1))
+  int k = 0;
+  while (x >= 2.0) { x /= 2.0; k++; }
+  while (x < 1.0) { x *= 2.0; k--; }
+  double z = (x - 1.0) / (x + 1.0);
+  double z2 = z * z;
+  double term = z;
+  double sum = 0.0;
+  for (int n = 1; n < 40; n += 2) {
+    sum += term / n;
+    term *= z2;
+  }
+  return 2.0 * sum + k * 0.69314718055994530942;
+}
+
+constexpr double constexprExp(double x) {
+  // e^x = 2^n * e^r，|r| <= ln2/2
+  int n = (int)(x / 0.69314718055994530942 + (x >= 0 ? 0.5 : -0.5));
+  double r = x - n * 0.69314718055994530942;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int i = 1; i < 20; i++) {
+    term *= r / i;
+    sum += term;
+  }
+  for (; n > 0; n--) sum *= 2.0;
+  for (; n < 0; n++) sum /= 2.0;
+  return sum;
+}
+
+#define GL5539_LUX_MIN 1.0
+#define GL5539_LUX_MAX 10000.0
+
+constexpr double gl5539LuxAt(int adc) {
+  if (adc <= 0) {
+    return GL5539_LUX_MAX;  // 电阻为0，环境很亮
+  }
+  if (adc >= GL5539_ADC_MAX) {
+    return GL5539_LUX_MIN;  // 电阻无穷大，环境很暗
+  }
+  double resistance = (double)GL5539_R_PULLUP * adc / (GL5539_ADC_MAX - adc);
+  double lux = 12500000.0 / constexprExp(1.4 * constexprLn(resistance));
+  return lux > GL5539_LUX_MAX ? GL5539_LUX_MAX : (lux < GL5539_LUX_MIN ? GL5539_LUX_MIN : lux);
+}
+
+constexpr int GL5539_LUT_SIZE = GL5539_ADC_MAX / GL5539_LUT_STEP + 1;
+
+struct GL5539LuxTable {
+  uint32_t centi_lux[GL5539_LUT_SIZE];
+  
+  constexpr GL5539LuxTable() : centi_lux() {
+    for (int i = 0; i < GL5539_LUT_SIZE; i++) {
+      centi_lux[i] = (uint32_t)(gl5539LuxAt(i * GL5539_LUT_STEP) * 100.0 + 0.5);
+    }
+  }
+};
+
+// 放在闪存中（ESP8266的常量数据默认占用RAM），运行时用pgm_read_dword读取
+constexpr GL5539LuxTable GL5539_LUX_TABLE PROGMEM;
+static_assert(GL5539_LUX_TABLE.centi_lux[0] == 1000000 && GL5539_LUX_TABLE.centi_lux[GL5539_LUT_SIZE - 1] == 100,
+              "GL5539查找表端点错误");
+
+// adc4为1/4 ADC计数（0 - 4*ADC_max），相邻表项之间线性插值
+float gl5539Lux(uint16_t adc4) {
+  const uint16_t span = GL5539_LUT_STEP * 4;
+  uint16_t index = adc4 / span;
+  if (index >= GL5539_LUT_SIZE - 1) {
+    return pgm_read_dword(&GL5539_LUX_TABLE.centi_lux[GL5539_LUT_SIZE - 1]) / 100.0f;
+  }
+  int32_t low = pgm_read_dword(&GL5539_LUX_TABLE.centi_lux[index]);
+  int32_t high = pgm_read_dword(&GL5539_LUX_TABLE.centi_lux[index + 1]);
+  int32_t centiLux = low + (high - low) * (int32_t)(adc4 % span) / span;
+  return centiLux / 100.0f;
+}
+
+// 过采样状态：start开始一次测量，poll每次累加几个样本，采满后换算
+uint32_t g_gl5539_sum = 0;
+uint8_t g_gl5539_count = 0;
+uint16_t g_gl5539_adc4 = 0;  // 最近一次测量的抽取结果（1/4 ADC计数）
+
+void accumulateGL5539() {
+  for (uint8_t i = 0; i < GL5539_SAMPLES_PER_POLL && g_gl5539_count < GL5539_OVERSAMPLE; i++) {
+    g_gl5539_sum += analogRead(GL5539_ANALOG_PIN);
+    g_gl5539_count++;
+  }
+}
+
+bool startGL5539() {
+  g_gl5539_sum = 0;
+  g_gl5539_count = 0;
+  accumulateGL5539();
+  return true;
+}
+
+SensorPollResult pollGL5539() {
+  accumulateGL5539();
+  if (g_gl5539_count < GL5539_OVERSAMPLE) {
+    return SENSOR_PENDING;
+  }
+  // N个10位样本之和右移log2(N)-2位，得到12位结果
+  g_gl5539_adc4 = g_gl5539_sum / (GL5539_OVERSAMPLE / 4);
+  return SENSOR_OK;
+}
+
 bool readGL5539() {
-  // 读取ADC值
-  int adcValue = analogRead(GL5539_ANALOG_PIN);
+  // 过采样后的ADC值（1/4计数）
+  uint16_t adc4 = g_gl5539_adc4;
+  float adcValue = adc4 / 4.0f;
   
-  // 计算光敏电阻的电阻值
   // 电路：VCC -- R_pullup -- ADC_pin -- LDR -- GND
-  // ADC电压 = VCC * ADC_value / ADC_max
-  // LDR电阻 = R_pullup * ADC_value / (ADC_max - ADC_value)
-  
-  if (adcValue >= GL5539_ADC_MAX - 1) {
-    // 防止除零错误，ADC值接近最大值时LDR电阻非常大（很暗）
-    Serial.println("❌ GL5539 读取失败：环境过暗或传感器故障");
+  if (adc4 >= (GL5539_ADC_MAX - 1) * 4) {
+    // ADC值接近最大值时LDR电阻非常大（很暗）
+    LOG_WARN("❌ GL5539 读取失败：环境过暗或传感器故障\n");
     return false;
   }
   
-  // 计算光敏电阻值
-  float ldrResistance = (float)GL5539_R_PULLUP * adcValue / (GL5539_ADC_MAX - adcValue);
-  
-  // 将电阻值转换为光照强度 (lux)
-  // GL5539典型特性：10lux时约10kΩ，100lux时约1kΩ
-  // 使用经验公式：lux = A / (resistance^B)，其中A和B是校准常数
-  float lux;
-  
-  if (ldrResistance > 50000) {
-    // 电阻很大，环境很暗
-    lux = 1.0;
-  } else if (ldrResistance < 100) {
-    // 电阻很小，环境很亮
-    lux = 2000.0;
-  } else {
-    // 使用校准公式计算
-    // 基于GL5539典型特性曲线的近似公式
-    lux = 12500000.0 / pow(ldrResistance, 1.4);
-  }
+  float lux = gl5539Lux(adc4);
   
   // 数据有效性检查
-  if (lux >= 0 && lux <= 10000 && adcValue >= 10) {
+  if (adc4 >= 10 * 4) {
     // 更新全局变量
     g_light_level = (int)lux;
+    pushSample(SAMPLE_LIGHT, lux);
     
-    Serial.print("✅ GL5539 - ADC: ");
-    Serial.print(adcValue);
-    Serial.print(", 电阻: ");
-    Serial.print(ldrResistance, 0);
-    Serial.print(" Ω, 光照强度: ");
-    Serial.print(lux, 1);
-    Serial.println(" lux");
+    LOG_DEBUG("✅ GL5539 - ADC: %.2f (%d次过采样), 电阻: %.0f Ω, 光照强度: %.1f lux\n", adcValue, GL5539_OVERSAMPLE,
+              (float)GL5539_R_PULLUP * adcValue / (GL5539_ADC_MAX - adcValue), lux);
     
     return true;
   } else {
-    Serial.printf("❌ GL5539 数据异常 - ADC: %d, 电阻: %.0fΩ, Lux: %.1f\n", 
-                  adcValue, ldrResistance, lux);
+    LOG_WARN("❌ GL5539 数据异常 - ADC: %.2f, Lux: %.1f\n", adcValue, lux);
     return false;
   }
 }
 #endif
 
+#if ENABLE_GL5539
+// 模拟引脚，无需特殊初始化
+bool initGL5539() {
+  pinMode(GL5539_ANALOG_PIN, INPUT);
+  LOG_INFO("✅ GL5539 光敏电阻初始化完成\n");
+  LOG_INFO("   - 使用引脚: A%d\n", GL5539_ANALOG_PIN);
+  LOG_INFO("   - 上拉电阻: %d Ω\n", GL5539_R_PULLUP);
+  LOG_INFO("   - 过采样: %d 次/测量, 查找表 %d 项\n", GL5539_OVERSAMPLE, GL5539_LUT_SIZE);
+  return true;
+}
+#endif
+
 #if ENABLE_VEML7700
-bool readVEML7700() {
-  // 读取环境光数据
+// 读取ALS寄存器并换算为lux
+bool fetchVEML7700(float& lux) {
   Wire.beginTransmission(VEML7700_ADDR);
   Wire.write(0x04); // ALS寄存器
   byte error = Wire.endTransmission();
   
   if (error != 0) {
-    Serial.println("❌ VEML7700 通信失败");
+    LOG_WARN("❌ VEML7700 通信失败\n");
     return false;
   }
   
   Wire.requestFrom(VEML7700_ADDR, 2);
-  if (Wire.available() >= 2) {
-    uint16_t raw_data = Wire.read() | (Wire.read() << 8);
-    float lux = raw_data * 0.0576; // 转换为lux
-    
-    // 数据有效性检查
-    if (lux >= 0 && lux < 120000) {
-      // 更新全局变量
-      g_light_level = (int)lux;
-      
-      Serial.print("✅ VEML7700 - 光照强度: ");
-      Serial.print(lux, 2);
-      Serial.println(" lux");
-      
-      return true;
-    } else {
-      Serial.println("❌ VEML7700 数据超出正常范围");
-      return false;
-    }
-  } else {
-    Serial.println("❌ VEML7700 读取数据失败");
+  if (Wire.available() < 2) {
+    LOG_WARN("❌ VEML7700 读取数据失败\n");
     return false;
   }
+  uint16_t raw_data = Wire.read() | (Wire.read() << 8);
+  lux = raw_data * 0.0576; // 转换为lux
+  
+  // 数据有效性检查
+  if (lux >= 0 && lux < 120000) {
+    return true;
+  }
+  LOG_WARN("❌ VEML7700 数据超出正常范围\n");
+  return false;
+}
+
+bool readVEML7700() {
+  float lux;
+  if (!fetchVEML7700(lux)) {
+    return false;
+  }
+  
+  // 更新全局变量
+  g_light_level = (int)lux;
+  pushSample(SAMPLE_LIGHT, lux);
+  
+  LOG_DEBUG("✅ VEML7700 - 光照强度: %.2f lux\n", lux);
+  
+  return true;
 }
 #endif
 
-void initSensors() {
-  #if ENABLE_AHT21
-  // 初始化AHT21
-  Wire.beginTransmission(AHT21_ADDR);
-  Wire.write(AHT21_INIT_CMD);
-  Wire.write(0x08);
-  Wire.write(0x00);
-  byte error = Wire.endTransmission();
-  if (error == 0) {
-    Serial.println("✅ AHT21 初始化完成");
-  } else {
-    Serial.println("❌ AHT21 初始化失败");
+#if ENABLE_VEML7700
+bool initVEML7700() {
+  LOG_INFO("✅ VEML7700 I2C光照传感器已启用\n");
+  return true;
+}
+#endif
+
+// 模拟运动检测（可以替换为真实的PIR传感器）
+bool readMotion() {
+  g_motion = (random(0, 100) < 5); // 5% 概率检测到运动
+  pushSample(SAMPLE_MOTION, g_motion ? 1 : 0);
+  return true;
+}
+
+#if ENABLE_AHT21 && ENABLE_ENS160_COMPENSATION
+// AHT21读取成功后顺带更新ENS160的温湿度补偿
+bool readAHT21WithCompensation() {
+  if (!readAHT21()) {
+    return false;
   }
-  delay(10);
+  writeENS160Compensation(g_temperature, g_humidity);
+  return true;
+}
+#endif
+
+// ===== 传感器驱动表 =====
+// 每个传感器一条描述：
+//   init  - 启动时调用一次
+//   start - 触发一次测量（同步传感器为nullptr）
+//   poll  - 查询测量是否完成（同步传感器为nullptr）
+//   read  - 读取并校验数据，写入全局变量
+// 调度器按各自的period_ms独立采样
+struct SensorDriver {
+  const char* name;
+  bool (*init)();
+  bool (*start)();
+  SensorPollResult (*poll)();
+  bool (*read)();
+  unsigned long period_ms;
+};
+
+constexpr SensorDriver SENSOR_DRIVERS[] = {
+  #if ENABLE_AHT21
+  #if ENABLE_ENS160_COMPENSATION
+  {"AHT21", initAHT21, startAHT21, pollAHT21, readAHT21WithCompensation, AHT21_SAMPLE_PERIOD_MS},
+  #else
+  {"AHT21", initAHT21, startAHT21, pollAHT21, readAHT21, AHT21_SAMPLE_PERIOD_MS},
+  #endif
   #endif
-  
   #if ENABLE_ENS160
-  // 初始化ENS160
-  Wire.beginTransmission(ENS160_ADDR);
-  Wire.write(ENS160_OPMODE);
-  Wire.write(0x02); // 标准操作模式
-  byte error2 = Wire.endTransmission();
-  if (error2 == 0) {
-    Serial.println("✅ ENS160 初始化完成");
-  } else {
-    Serial.println("❌ ENS160 初始化失败");
-  }
-  delay(100);
+  {"ENS160", initENS160, nullptr, nullptr, readENS160, ENS160_SAMPLE_PERIOD_MS},
   #endif
-  
   #if ENABLE_GL5539
-  // 初始化GL5539光敏电阻 (模拟引脚，无需特殊初始化)
-  pinMode(GL5539_ANALOG_PIN, INPUT);
-  Serial.println("✅ GL5539 光敏电阻初始化完成");
-  Serial.printf("   - 使用引脚: A%d\n", GL5539_ANALOG_PIN);
-  Serial.printf("   - 上拉电阻: %d Ω\n", GL5539_R_PULLUP);
+  {"GL5539", initGL5539, startGL5539, pollGL5539, readGL5539, GL5539_SAMPLE_PERIOD_MS},
   #endif
-  
   #if ENABLE_VEML7700
-  Serial.println("✅ VEML7700 I2C光照传感器已启用");
+  {"VEML7700", initVEML7700, nullptr, nullptr, readVEML7700, VEML7700_SAMPLE_PERIOD_MS},
   #endif
+  {"MOTION", nullptr, nullptr, nullptr, readMotion, MOTION_SAMPLE_PERIOD_MS},
+};
+
+constexpr size_t SENSOR_DRIVER_COUNT = sizeof(SENSOR_DRIVERS) / sizeof(SENSOR_DRIVERS[0]);
+
+// 每个驱动的运行时调度状态
+struct SensorSlot {
+  unsigned long last_start;  // 上次开始采样的时间
+  bool started;              // 是否采样过（首次立即采样）
+  bool busy;                 // 异步测量进行中
+  int8_t telemetry_channel;  // 遥测通道，记录start/poll/read的I2C耗时与失败
+};
+
+SensorSlot g_sensor_slots[SENSOR_DRIVER_COUNT];
+
+void initSensors() {
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    if (SENSOR_DRIVERS[i].init) {
+      SENSOR_DRIVERS[i].init();
+    }
+    g_sensor_slots[i] = {0, false, false, telemetryAddChannel(SENSOR_DRIVERS[i].name)};
+  }
 }
 
-bool readAllSensors() {
-  bool anyDataRead = false;
+// 记录一次成功的读数
+void markSensorUpdated() {
+  g_sensor_data_valid = true;
+  g_last_sensor_update = millis();
+}
+
+// 开始第i个传感器的一次采样；同步传感器立即完成，返回是否读到新数据
+bool startSensorSample(size_t i) {
+  const SensorDriver& driver = SENSOR_DRIVERS[i];
+  SensorSlot& slot = g_sensor_slots[i];
   
-  Serial.println("📊 读取所有传感器数据...");
+  slot.last_start = millis();
+  slot.started = true;
   
-  #if ENABLE_AHT21
-  if (readAHT21()) {
-    anyDataRead = true;
+  uint32_t start = micros();
+  if (driver.start) {
+    slot.busy = driver.start();
+    telemetryRecord(slot.telemetry_channel, micros() - start, slot.busy);
+    return false;
   }
-  #endif
+  bool ok = driver.read && driver.read();
+  telemetryRecord(slot.telemetry_channel, micros() - start, ok);
+  return ok;
+}
+
+// 推进第i个传感器的异步测量，返回是否读到新数据
+bool pollSensorSample(size_t i) {
+  const SensorDriver& driver = SENSOR_DRIVERS[i];
+  SensorSlot& slot = g_sensor_slots[i];
   
-  #if ENABLE_ENS160
-  if (readENS160()) {
-    anyDataRead = true;
+  uint32_t start = micros();
+  SensorPollResult result = driver.poll ? driver.poll() : SENSOR_OK;
+  if (result == SENSOR_PENDING) {
+    telemetryRecordPending(slot.telemetry_channel);
+    return false;
   }
-  #endif
   
-  #if ENABLE_VEML7700
-  if (readVEML7700()) {
-    anyDataRead = true;
+  slot.busy = false;
+  bool ok = result == SENSOR_OK && (!driver.read || driver.read());
+  telemetryRecord(slot.telemetry_channel, micros() - start, ok);
+  return ok;
+}
+
+// 传感器调度器，在loop()中每次调用；按各传感器自己的周期采样，从不阻塞
+// 有新数据完成时返回true
+bool runSensorScheduler() {
+  bool updated = false;
+  unsigned long now = millis();
+  
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    SensorSlot& slot = g_sensor_slots[i];
+    
+    if (slot.busy) {
+      if (pollSensorSample(i)) {
+        updated = true;
+      }
+    } else if (!slot.started || now - slot.last_start >= SENSOR_DRIVERS[i].period_ms) {
+      if (startSensorSample(i)) {
+        updated = true;
+      }
+    }
   }
-  #endif
   
-  #if ENABLE_GL5539
-  if (readGL5539()) {
-    anyDataRead = true;
+  if (updated) {
+    markSensorUpdated();
   }
-  #endif
   
-  // 模拟运动检测（可以替换为真实的PIR传感器）
-  g_motion = (random(0, 100) < 5); // 5% 概率检测到运动
+  return updated;
+}
+
+// 立即触发所有传感器采样（启动时使用），异步传感器的结果由runSensorScheduler()取回
+bool readAllSensors() {
+  bool anyDataRead = false;
+  
+  LOG_INFO("📊 读取所有传感器数据...\n");
+  
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    if (!g_sensor_slots[i].busy && startSensorSample(i)) {
+      anyDataRead = true;
+    }
+  }
   
   if (anyDataRead) {
-    g_sensor_data_valid = true;
-    g_last_sensor_update = millis();
+    markSensorUpdated();
     
-    Serial.println("✅ 传感器数据更新完成");
-    Serial.printf("🌡️ 当前数据汇总 - 温度: %.1f°C, 湿度: %.1f%%, CO2: %dppm, VOC: %dppb, 光照: %dlux, 运动: %s\n", 
+    LOG_INFO("✅ 传感器数据更新完成\n");
+    LOG_INFO("🌡️ 当前数据汇总 - 温度: %.1f°C, 湿度: %.1f%%, CO2: %dppm, VOC: %dppb, 光照: %dlux, 运动: %s\n", 
                   g_temperature, g_humidity, g_co2, g_voc, g_light_level, g_motion ? "是" : "否");
   } else {
-    Serial.println("⚠️ 没有成功读取到任何传感器数据");
+    LOG_WARN("⚠️ 没有成功读取到任何传感器数据\n");
   }
   
   return anyDataRead;
 }
 
+// 是否还有进行中的异步测量
+bool sensorsBusy() {
+  for (size_t i = 0; i < SENSOR_DRIVER_COUNT; i++) {
+    if (g_sensor_slots[i].busy) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // 获取传感器数据是否有效
 bool isSensorDataValid() {
   return g_sensor_data_valid && (millis() - g_last_sensor_update < 60000); // 1分钟内的数据认为有效
@@ -407,13 +749,13 @@ bool isSensorDataValid() {
 
 // 打印当前所有传感器数据
 void printAllSensorData() {
-  Serial.println("📊 当前传感器数据状态:");
-  Serial.printf("   🌡️ 温度: %.1f°C\n", g_temperature);
-  Serial.printf("   💧 湿度: %.1f%%\n", g_humidity);
-  Serial.printf("   🌬️ CO2: %d ppm\n", g_co2);
-  Serial.printf("   ☁️ VOC: %d ppb\n", g_voc);
-  Serial.printf("   ☀️ 光照: %d lux\n", g_light_level);
-  Serial.printf("   🚶 运动: %s\n", g_motion ? "检测到" : "无");
-  Serial.printf("   ✅ 数据有效: %s\n", isSensorDataValid() ? "是" : "否");
-  Serial.printf("   🕐 上次更新: %lu ms前\n", millis() - g_last_sensor_update);
+  LOG_INFO("📊 当前传感器数据状态:\n");
+  LOG_INFO("   🌡️ 温度: %.1f°C\n", g_temperature);
+  LOG_INFO("   💧 湿度: %.1f%%\n", g_humidity);
+  LOG_INFO("   🌬️ CO2: %d ppm\n", g_co2);
+  LOG_INFO("   ☁️ VOC: %d ppb\n", g_voc);
+  LOG_INFO("   ☀️ 光照: %d lux\n", g_light_level);
+  LOG_INFO("   🚶 运动: %s\n", g_motion ? "检测到" : "无");
+  LOG_INFO("   ✅ 数据有效: %s\n", isSensorDataValid() ? "是" : "否");
+  LOG_INFO("   🕐 上次更新: %lu ms前\n", millis() - g_last_sensor_update);
 }
\ No newline at end of file
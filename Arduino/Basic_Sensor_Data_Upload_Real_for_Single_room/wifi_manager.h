@@ -0,0 +1,193 @@
+// WiFi配置
+// const char* ssid = "CE-Hub-Student";
+// const char* password = "casa-ce-gagarin-public-service";
+// const char* ssid = "CE-Dankao";
+// const char* password = "CELAB2025";
+const char* ssid = "CE-Wlan-Helper";
+const char* password = "ThanksDankao";
+
+// 非阻塞WiFi连接管理
+// 记住上次关联的BSSID/信道和DHCP地址（保存在LittleFS），重连时跳过信道扫描和DHCP；
+// 关联期间loop()照常运行，并记录每次重连耗时
+
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000   // 使用缓存信息连接的超时，超时后改用完整扫描
+#define WIFI_FULL_CONNECT_TIMEOUT_MS 20000  // 完整扫描+DHCP的超时
+#define WIFI_RETRY_INTERVAL_MS 5000         // 连接失败后的重试间隔
+#define WIFI_HINTS_FILE "/wifi_hints.bin"
+
+// 快速重连信息：上次关联的AP和DHCP分配的地址
+struct WiFiHints {
+  uint8_t valid;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+enum WiFiConnState {
+  WIFI_STATE_IDLE,          // 未连接，等待重试
+  WIFI_STATE_FAST_CONNECT,  // 使用缓存的BSSID/信道/IP连接中
+  WIFI_STATE_FULL_CONNECT,  // 完整扫描+DHCP连接中
+  WIFI_STATE_CONNECTED
+};
+
+WiFiHints g_wifi_hints = {0};
+WiFiConnState g_wifi_state = WIFI_STATE_IDLE;
+unsigned long g_wifi_state_since = 0;     // 进入当前状态的时间
+unsigned long g_wifi_disconnect_time = 0; // 本次断线（或开始连接）的时间
+
+// 状态
+bool wifiConnected = false;
+
+// 重连统计
+uint32_t g_wifi_reconnect_count = 0;
+unsigned long g_wifi_last_reconnect_ms = 0;  // 最近一次从断线到连上的耗时
+unsigned long g_wifi_max_reconnect_ms = 0;
+bool g_wifi_last_fast = false;               // 最近一次是否走了快速重连
+
+void loadWiFiHints() {
+  if (!g_fs_ready) {
+    return;
+  }
+  File f = LittleFS.open(WIFI_HINTS_FILE, "r");
+  if (!f) {
+    return;
+  }
+  if (f.read((uint8_t*)&g_wifi_hints, sizeof(g_wifi_hints)) != sizeof(g_wifi_hints)) {
+    g_wifi_hints.valid = 0;
+  }
+  f.close();
+}
+
+// 记录当前连接的AP和地址；信息没有变化时不写闪存
+void saveWiFiHints() {
+  WiFiHints hints = {0};
+  memcpy(hints.bssid, WiFi.BSSID(), sizeof(hints.bssid));
+  hints.channel = WiFi.channel();
+  hints.ip = WiFi.localIP();
+  hints.gateway = WiFi.gatewayIP();
+  hints.subnet = WiFi.subnetMask();
+  hints.dns = WiFi.dnsIP();
+  hints.valid = 1;
+
+  if (memcmp(&hints, &g_wifi_hints, sizeof(hints)) == 0) {
+    return;
+  }
+  g_wifi_hints = hints;
+  if (!g_fs_ready) {
+    return;
+  }
+
+  File f = LittleFS.open(WIFI_HINTS_FILE, "w");
+  if (f) {
+    f.write((const uint8_t*)&g_wifi_hints, sizeof(g_wifi_hints));
+    f.close();
+  }
+}
+
+void setWiFiState(WiFiConnState state) {
+  g_wifi_state = state;
+  g_wifi_state_since = millis();
+}
+
+// 开始一次连接（不等待结果）
+void wifiBeginConnect() {
+  WiFi.persistent(false);  // SDK不必每次连接都写闪存，提示信息由我们自己保存
+  WiFi.mode(WIFI_STA);
+
+  if (g_wifi_hints.valid) {
+    LOG_INFO("📶 Fast connecting to: %s (ch %d)\n", ssid, g_wifi_hints.channel);
+    WiFi.config(IPAddress(g_wifi_hints.ip), IPAddress(g_wifi_hints.gateway),
+                IPAddress(g_wifi_hints.subnet), IPAddress(g_wifi_hints.dns));
+    WiFi.begin(ssid, password, g_wifi_hints.channel, g_wifi_hints.bssid);
+    setWiFiState(WIFI_STATE_FAST_CONNECT);
+  } else {
+    LOG_INFO("📶 Connecting to: %s\n", ssid);
+    WiFi.config(0U, 0U, 0U);  // 使用DHCP
+    WiFi.begin(ssid, password);
+    setWiFiState(WIFI_STATE_FULL_CONNECT);
+  }
+}
+
+// 从断线状态开始一次重连，耗时从此刻开始计算
+void wifiStartReconnect() {
+  wifiConnected = false;
+  g_wifi_disconnect_time = millis();
+  wifiBeginConnect();
+}
+
+// setup()中调用：读取上次保存的提示信息并开始连接，不等待结果
+void initWiFiManager() {
+  loadWiFiHints();
+  wifiStartReconnect();
+}
+
+// 在loop()中每次调用，推进连接状态机；返回当前是否已连接
+bool wifiManagerLoop() {
+  unsigned long now = millis();
+  bool linkUp = WiFi.status() == WL_CONNECTED;
+
+  switch (g_wifi_state) {
+    case WIFI_STATE_CONNECTED:
+      if (!linkUp) {
+        LOG_WARN("❌ WiFi lost, reconnecting...\n");
+        wifiStartReconnect();
+      }
+      break;
+
+    case WIFI_STATE_FAST_CONNECT:
+    case WIFI_STATE_FULL_CONNECT:
+      if (linkUp) {
+        wifiConnected = true;
+        g_wifi_last_fast = (g_wifi_state == WIFI_STATE_FAST_CONNECT);
+        g_wifi_last_reconnect_ms = now - g_wifi_disconnect_time;
+        if (g_wifi_last_reconnect_ms > g_wifi_max_reconnect_ms) {
+          g_wifi_max_reconnect_ms = g_wifi_last_reconnect_ms;
+        }
+        g_wifi_reconnect_count++;
+        telemetryWiFiReconnect();
+        setWiFiState(WIFI_STATE_CONNECTED);
+        saveWiFiHints();
+
+        LOG_INFO("✅ WiFi Connected in %lu ms (%s)\n",
+                      g_wifi_last_reconnect_ms, g_wifi_last_fast ? "fast" : "full scan");
+        LOG_INFO("📍 ESP8266 IP: %s\n", WiFi.localIP().toString().c_str());
+        LOG_INFO("📡 Signal: %d dBm\n", WiFi.RSSI());
+      } else if (g_wifi_state == WIFI_STATE_FAST_CONNECT &&
+                 now - g_wifi_state_since >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+        // AP或信道已变化，缓存信息作废，改用完整扫描
+        LOG_WARN("⚠️ 快速重连失败，改用完整扫描\n");
+        g_wifi_hints.valid = 0;
+        WiFi.disconnect();
+        wifiBeginConnect();
+      } else if (g_wifi_state == WIFI_STATE_FULL_CONNECT &&
+                 now - g_wifi_state_since >= WIFI_FULL_CONNECT_TIMEOUT_MS) {
+        LOG_ERROR("❌ WiFi failed!\n");
+        WiFi.disconnect();
+        setWiFiState(WIFI_STATE_IDLE);
+      }
+      break;
+
+    case WIFI_STATE_IDLE:
+      if (now - g_wifi_state_since >= WIFI_RETRY_INTERVAL_MS) {
+        wifiBeginConnect();
+      }
+      break;
+  }
+
+  return g_wifi_state == WIFI_STATE_CONNECTED;
+}
+
+// 阻塞等待连接（只用于setup阶段或深度睡眠唤醒这类没有其他任务的场合）
+bool connectWiFiBlocking(unsigned long timeoutMs) {
+  if (g_wifi_state == WIFI_STATE_IDLE || g_wifi_state == WIFI_STATE_CONNECTED) {
+    wifiStartReconnect();
+  }
+  unsigned long start = millis();
+  while (!wifiManagerLoop() && millis() - start < timeoutMs) {
+    delay(10);
+  }
+  return wifiConnected;
+}
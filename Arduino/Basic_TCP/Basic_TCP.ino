@@ -22,6 +22,11 @@ unsigned long lastConnectionAttempt = 0;
 unsigned long lastPingTime = 0;
 int connectionAttempts = 0;
 
+// 连接后的初始消息延后到loop()中发送，不在事件回调里等待
+#define INITIAL_MESSAGE_DELAY_MS 50
+bool initialMessagePending = false;
+unsigned long initialMessageDeadline = 0;
+
 void setup() {
   Serial.begin(115200);
   delay(2000);
@@ -49,6 +54,12 @@ void loop() {
   // 处理WebSocket
   webSocket.loop();
   
+  // 连接建立后到期发送初始消息
+  if (initialMessagePending && (long)(millis() - initialMessageDeadline) >= 0) {
+    initialMessagePending = false;
+    sendInitialMessage();
+  }
+  
   // WebSocket重连逻辑
   if (!wsConnected && (millis() - lastConnectionAttempt > 10000)) {
     if (connectionAttempts < 5) {
@@ -65,7 +76,7 @@ void loop() {
     lastPingTime = millis();
   }
   
-  delay(1000);
+  delay(10);
 }
 
 void connectToWiFi() {
@@ -204,6 +215,7 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     case WStype_DISCONNECTED:
       wsConnected = false;
       messageReceived = false;
+      initialMessagePending = false;
       Serial.printf("[%s] 🔴 WebSocket Disconnected\n", timestamp.c_str());
       break;
       
@@ -213,9 +225,9 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
       connectionAttempts = 0;
       Serial.printf("[%s] 🟢 WebSocket Connected to: %s\n", timestamp.c_str(), payload);
       
-      // 连接成功后等待一下再发送消息
-      delay(2000);
-      sendInitialMessage();
+      // 初始消息由loop()在INITIAL_MESSAGE_DELAY_MS后发送
+      initialMessagePending = true;
+      initialMessageDeadline = millis() + INITIAL_MESSAGE_DELAY_MS;
       break;
       
     case WStype_TEXT:
@@ -4,6 +4,11 @@
 #include <Wire.h>
 #include <Adafruit_NeoPixel.h>
 
+// 日志级别：LOG_LEVEL_DEBUG输出每条命令、设备更新和ack；发布版本改为LOG_LEVEL_WARN
+#define LOG_LEVEL LOG_LEVEL_INFO
+#include <logging.h>
+#include <telemetry.h>
+
 // ===== 家具配置宏 =====
 #define ENABLE_DESK_LAMP true      // 台灯
 #define ENABLE_CEILING_LIGHT true  // WS2812顶灯
@@ -40,6 +45,12 @@ WebSocketsClient webSocket;
 // 状态变量
 bool wifiConnected = false;
 bool wsConnected = false;
+bool subscribePending = false;  // 连接后在loop()中发送订阅
+char deviceId[18] = "";         // MAC地址，用于ack帧
+
+// 遥测通道：strip.show()关中断输出的耗时、控制命令分发耗时
+int8_t g_show_channel = -1;
+int8_t g_dispatch_channel = -1;
 
 // ===== 设备状态 =====
 struct DeviceState {
@@ -61,440 +72,842 @@ Adafruit_NeoPixel strip(WS2812_COUNT, WS2812_PIN, NEO_GRB + NEO_KHZ800);
 bool fan_status = false;  // 风扇只需要开关状态
 #endif
 
-// ===== WiFi连接函数 =====
-void connectWiFi() {
-  Serial.printf("📶 Connecting to: %s\n", ssid);
-  
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(1000);
-    Serial.print(".");
-    attempts++;
+// ===== WiFi连接管理（非阻塞） =====
+// 上次关联的BSSID/信道和DHCP地址保存在RTC内存（复位后仍保留），重连时跳过扫描和DHCP；
+// 连接过程由loop()推进，关联期间LED过渡和其他任务照常运行
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000   // 使用缓存信息连接的超时，超时后改用完整扫描
+#define WIFI_FULL_CONNECT_TIMEOUT_MS 20000  // 完整扫描+DHCP的超时
+#define WIFI_RETRY_INTERVAL_MS 5000         // 连接失败后的重试间隔
+#define WIFI_HINTS_MAGIC 0x57494631         // "WIF1"
+
+struct WiFiHints {
+  uint32_t magic;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+enum WiFiConnState {
+  WIFI_STATE_IDLE,          // 未连接，等待重试
+  WIFI_STATE_FAST_CONNECT,  // 使用缓存的BSSID/信道/IP连接中
+  WIFI_STATE_FULL_CONNECT,  // 完整扫描+DHCP连接中
+  WIFI_STATE_CONNECTED
+};
+
+WiFiHints g_wifi_hints = {0};
+WiFiConnState g_wifi_state = WIFI_STATE_IDLE;
+unsigned long g_wifi_state_since = 0;
+unsigned long g_wifi_disconnect_time = 0;
+uint32_t g_wifi_reconnect_count = 0;
+unsigned long g_wifi_last_reconnect_ms = 0;  // 最近一次从断线到连上的耗时
+
+void saveWiFiHints() {
+  WiFiHints hints = {0};
+  hints.magic = WIFI_HINTS_MAGIC;
+  hints.channel = WiFi.channel();
+  memcpy(hints.bssid, WiFi.BSSID(), sizeof(hints.bssid));
+  hints.ip = WiFi.localIP();
+  hints.gateway = WiFi.gatewayIP();
+  hints.subnet = WiFi.subnetMask();
+  hints.dns = WiFi.dnsIP();
+
+  if (memcmp(&hints, &g_wifi_hints, sizeof(hints)) != 0) {
+    g_wifi_hints = hints;
+    ESP.rtcUserMemoryWrite(0, (uint32_t*)&g_wifi_hints, sizeof(g_wifi_hints));
   }
-  
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnected = true;
-    Serial.println("\n✅ WiFi Connected!");
-    Serial.printf("📍 ESP8266 IP: %s\n", WiFi.localIP().toString().c_str());
-    Serial.printf("📡 Signal: %d dBm\n", WiFi.RSSI());
+}
+
+void setWiFiState(WiFiConnState state) {
+  g_wifi_state = state;
+  g_wifi_state_since = millis();
+}
+
+void wifiBeginConnect() {
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+
+  if (g_wifi_hints.magic == WIFI_HINTS_MAGIC) {
+    LOG_INFO("📶 Fast connecting to: %s (ch %d)\n", ssid, g_wifi_hints.channel);
+    WiFi.config(IPAddress(g_wifi_hints.ip), IPAddress(g_wifi_hints.gateway),
+                IPAddress(g_wifi_hints.subnet), IPAddress(g_wifi_hints.dns));
+    WiFi.begin(ssid, password, g_wifi_hints.channel, g_wifi_hints.bssid);
+    setWiFiState(WIFI_STATE_FAST_CONNECT);
   } else {
-    wifiConnected = false;
-    Serial.println("\n❌ WiFi failed!");
+    LOG_INFO("📶 Connecting to: %s\n", ssid);
+    WiFi.config(0U, 0U, 0U);  // 使用DHCP
+    WiFi.begin(ssid, password);
+    setWiFiState(WIFI_STATE_FULL_CONNECT);
   }
 }
 
+void initWiFiManager() {
+  ESP.rtcUserMemoryRead(0, (uint32_t*)&g_wifi_hints, sizeof(g_wifi_hints));
+  g_wifi_disconnect_time = millis();
+  wifiBeginConnect();
+}
+
+// 每次loop()调用，返回当前是否已连接
+bool wifiManagerLoop() {
+  unsigned long now = millis();
+  bool linkUp = WiFi.status() == WL_CONNECTED;
+
+  switch (g_wifi_state) {
+    case WIFI_STATE_CONNECTED:
+      if (!linkUp) {
+        LOG_WARN("❌ WiFi lost, reconnecting...\n");
+        wifiConnected = false;
+        g_wifi_disconnect_time = now;
+        wifiBeginConnect();
+      }
+      break;
+
+    case WIFI_STATE_FAST_CONNECT:
+    case WIFI_STATE_FULL_CONNECT:
+      if (linkUp) {
+        bool fast = (g_wifi_state == WIFI_STATE_FAST_CONNECT);
+        wifiConnected = true;
+        g_wifi_last_reconnect_ms = now - g_wifi_disconnect_time;
+        g_wifi_reconnect_count++;
+        telemetryWiFiReconnect();
+        setWiFiState(WIFI_STATE_CONNECTED);
+        saveWiFiHints();
+
+        LOG_INFO("✅ WiFi Connected in %lu ms (%s, #%u)\n",
+                      g_wifi_last_reconnect_ms, fast ? "fast" : "full scan", g_wifi_reconnect_count);
+        LOG_INFO("📍 ESP8266 IP: %s\n", WiFi.localIP().toString().c_str());
+        LOG_INFO("📡 Signal: %d dBm\n", WiFi.RSSI());
+      } else if (g_wifi_state == WIFI_STATE_FAST_CONNECT &&
+                 now - g_wifi_state_since >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+        // AP或信道已变化，缓存信息作废，改用完整扫描
+        LOG_WARN("⚠️ Fast reconnect failed, falling back to full scan\n");
+        g_wifi_hints.magic = 0;
+        WiFi.disconnect();
+        wifiBeginConnect();
+      } else if (g_wifi_state == WIFI_STATE_FULL_CONNECT &&
+                 now - g_wifi_state_since >= WIFI_FULL_CONNECT_TIMEOUT_MS) {
+        LOG_ERROR("❌ WiFi failed!\n");
+        WiFi.disconnect();
+        setWiFiState(WIFI_STATE_IDLE);
+      }
+      break;
+
+    case WIFI_STATE_IDLE:
+      if (now - g_wifi_state_since >= WIFI_RETRY_INTERVAL_MS) {
+        wifiBeginConnect();
+      }
+      break;
+  }
+
+  return g_wifi_state == WIFI_STATE_CONNECTED;
+}
+
 // ===== WS2812控制函数 =====
+// 顶灯的渐变引擎：命令只修改目标颜色，loop()中按LIGHT_FRAME_INTERVAL_MS限帧推进渐变，
+// 同一帧内的多条命令合并为一次strip.show()，减少关中断的位操作输出对WiFi的影响
 #if ENABLE_CEILING_LIGHT
+#define LIGHT_TRANSITION_MS 400        // 亮度/色温变化的渐变时长
+#define LIGHT_FRAME_INTERVAL_MS 20     // 最高50fps
+#define COLOR_TEMP_MIN 2700
+#define COLOR_TEMP_MAX 6500
+#define COLOR_TEMP_STEP 100
+
+struct LightColor {
+  uint8_t r, g, b;
+};
+
+// 色温 -> RGB（感知空间），2700K到6500K每100K一项
+const LightColor COLOR_TEMP_LUT[] PROGMEM = {
+  {255, 167,  87},  // 2700K
+  {255, 170,  95},  // 2800K
+  {255, 174, 103},  // 2900K
+  {255, 177, 110},  // 3000K
+  {255, 180, 117},  // 3100K
+  {255, 184, 123},  // 3200K
+  {255, 187, 129},  // 3300K
+  {255, 190, 135},  // 3400K
+  {255, 193, 141},  // 3500K
+  {255, 195, 146},  // 3600K
+  {255, 198, 151},  // 3700K
+  {255, 201, 157},  // 3800K
+  {255, 203, 161},  // 3900K
+  {255, 206, 166},  // 4000K
+  {255, 208, 171},  // 4100K
+  {255, 211, 175},  // 4200K
+  {255, 213, 179},  // 4300K
+  {255, 215, 183},  // 4400K
+  {255, 218, 187},  // 4500K
+  {255, 220, 191},  // 4600K
+  {255, 222, 195},  // 4700K
+  {255, 224, 199},  // 4800K
+  {255, 226, 202},  // 4900K
+  {255, 228, 206},  // 5000K
+  {255, 230, 209},  // 5100K
+  {255, 232, 213},  // 5200K
+  {255, 234, 216},  // 5300K
+  {255, 236, 219},  // 5400K
+  {255, 237, 222},  // 5500K
+  {255, 239, 225},  // 5600K
+  {255, 241, 228},  // 5700K
+  {255, 243, 231},  // 5800K
+  {255, 244, 234},  // 5900K
+  {255, 246, 237},  // 6000K
+  {255, 248, 240},  // 6100K
+  {255, 249, 242},  // 6200K
+  {255, 251, 245},  // 6300K
+  {255, 253, 248},  // 6400K
+  {255, 254, 250},  // 6500K
+};
+static_assert(sizeof(COLOR_TEMP_LUT) / sizeof(LightColor) == (COLOR_TEMP_MAX - COLOR_TEMP_MIN) / COLOR_TEMP_STEP + 1,
+              "COLOR_TEMP_LUT与色温范围不一致");
+
+// 感知亮度 -> PWM占空比（gamma 2.2）
+const uint8_t GAMMA_LUT[256] PROGMEM = {
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+    1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+    3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+    6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+   12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+   20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+   30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+   42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+   56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+   73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+   91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+  113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+  137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+  163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+  192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+  223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+LightColor light_from = {0, 0, 0};     // 渐变起点
+LightColor light_target = {0, 0, 0};   // 渐变终点
+LightColor light_rendered = {0, 0, 0}; // 最近一次输出到灯带的颜色
+unsigned long light_transition_start = 0;
+unsigned long light_last_frame = 0;
+bool light_transition_active = false;
+
+LightColor lightTargetColor() {
+  LightColor color = {0, 0, 0};
+  if (!ceiling_light.status) {
+    return color;
+  }
+  
+  int kelvin = constrain(ceiling_light.color_temp, COLOR_TEMP_MIN, COLOR_TEMP_MAX);
+  memcpy_P(&color, &COLOR_TEMP_LUT[(kelvin - COLOR_TEMP_MIN + COLOR_TEMP_STEP / 2) / COLOR_TEMP_STEP], sizeof(color));
+  
+  int brightness = constrain(ceiling_light.brightness, 0, 100);
+  color.r = color.r * brightness / 100;
+  color.g = color.g * brightness / 100;
+  color.b = color.b * brightness / 100;
+  return color;
+}
+
+uint8_t lerpChannel(uint8_t from, uint8_t to, uint32_t progress) {
+  // progress为0..256的定点比例
+  return from + (((int)to - (int)from) * (int)progress) / 256;
+}
+
+// 从当前显示的颜色开始渐变到新的目标；渐变中途收到命令时从中间状态继续，不会跳变
 void updateCeilingLight() {
-  Serial.println("🎨 === WS2812 Ceiling Light Update ===");
+  light_from = light_rendered;
+  light_target = lightTargetColor();
+  light_transition_start = millis();
+  light_transition_active = true;
+  
+  LOG_DEBUG("🎨 Ceiling light -> %s, %d%%, %dK (RGB %d,%d,%d, fade %d ms)\n",
+                ceiling_light.status ? "ON" : "OFF",
+                ceiling_light.brightness, ceiling_light.color_temp,
+                light_target.r, light_target.g, light_target.b, LIGHT_TRANSITION_MS);
+}
+
+// 在loop()中调用
+void runLightTransition() {
+  if (!light_transition_active) {
+    return;
+  }
   
-  if (ceiling_light.status) {
-    // 根据色温和亮度计算RGB值
-    int brightness = map(ceiling_light.brightness, 0, 100, 0, 255);
-    
-    // 简化的色温转换（2700K暖白 - 6500K冷白）
-    int warmth = map(ceiling_light.color_temp, 2700, 6500, 255, 0);
-    int r = brightness;
-    int g = (brightness * (255 - warmth / 2)) / 255;
-    int b = (brightness * warmth) / 255;
-    
-    Serial.printf("   💡 Status: ON\n");
-    Serial.printf("   🔆 Brightness: %d%% (PWM: %d)\n", ceiling_light.brightness, brightness);
-    Serial.printf("   🌡️ Color Temp: %dK (Warmth: %d)\n", ceiling_light.color_temp, warmth);
-    Serial.printf("   🎨 RGB Values: R=%d, G=%d, B=%d\n", r, g, b);
-    Serial.printf("   📍 Updating %d LEDs\n", WS2812_COUNT);
-    
-    // 设置所有LED
-    for(int i = 0; i < WS2812_COUNT; i++) {
-      strip.setPixelColor(i, strip.Color(r, g, b));
-    }
-  } else {
-    Serial.printf("   💡 Status: OFF\n");
-    Serial.printf("   ⚫ Turning off all %d LEDs\n", WS2812_COUNT);
-    
-    // 关闭所有LED
-    for(int i = 0; i < WS2812_COUNT; i++) {
-      strip.setPixelColor(i, strip.Color(0, 0, 0));
-    }
+  unsigned long now = millis();
+  if (now - light_last_frame < LIGHT_FRAME_INTERVAL_MS) {
+    return;
   }
+  light_last_frame = now;
+  
+  unsigned long elapsed = now - light_transition_start;
+  uint32_t progress = elapsed >= LIGHT_TRANSITION_MS ? 256 : elapsed * 256 / LIGHT_TRANSITION_MS;
   
+  LightColor color;
+  color.r = lerpChannel(light_from.r, light_target.r, progress);
+  color.g = lerpChannel(light_from.g, light_target.g, progress);
+  color.b = lerpChannel(light_from.b, light_target.b, progress);
+  
+  if (progress >= 256) {
+    light_transition_active = false;
+  }
+  
+  // 颜色没有变化时不重新输出
+  if (color.r == light_rendered.r && color.g == light_rendered.g && color.b == light_rendered.b) {
+    return;
+  }
+  light_rendered = color;
+  
+  uint32_t pixel = strip.Color(pgm_read_byte(&GAMMA_LUT[color.r]),
+                               pgm_read_byte(&GAMMA_LUT[color.g]),
+                               pgm_read_byte(&GAMMA_LUT[color.b]));
+  for (int i = 0; i < WS2812_COUNT; i++) {
+    strip.setPixelColor(i, pixel);
+  }
+  uint32_t showStart = micros();
   strip.show();
-  Serial.println("   ✅ WS2812 update complete");
-  Serial.println("=====================================");
+  telemetryRecord(g_show_channel, micros() - showStart, true);
 }
 #endif
 
 // ===== 台灯控制函数 =====
 #if ENABLE_DESK_LAMP
 void updateDeskLamp() {
-  Serial.println("💡 === Desk Lamp Update ===");
+  LOG_DEBUG("💡 === Desk Lamp Update ===\n");
   
   if (desk_lamp.status) {
     // PWM控制亮度
     int pwmValue = map(desk_lamp.brightness, 0, 100, 0, 1023);
     analogWrite(DESK_LAMP_PIN, pwmValue);
     
-    Serial.printf("   💡 Status: ON\n");
-    Serial.printf("   🔆 Brightness: %d%%\n", desk_lamp.brightness);
-    Serial.printf("   📊 PWM Value: %d/1023\n", pwmValue);
-    Serial.printf("   📍 Output Pin: GPIO%d\n", DESK_LAMP_PIN);
+    LOG_DEBUG("   💡 Status: ON\n");
+    LOG_DEBUG("   🔆 Brightness: %d%%\n", desk_lamp.brightness);
+    LOG_DEBUG("   📊 PWM Value: %d/1023\n", pwmValue);
+    LOG_DEBUG("   📍 Output Pin: GPIO%d\n", DESK_LAMP_PIN);
   } else {
     digitalWrite(DESK_LAMP_PIN, LOW);
     
-    Serial.printf("   💡 Status: OFF\n");
-    Serial.printf("   📍 Output Pin: GPIO%d set to LOW\n", DESK_LAMP_PIN);
+    LOG_DEBUG("   💡 Status: OFF\n");
+    LOG_DEBUG("   📍 Output Pin: GPIO%d set to LOW\n", DESK_LAMP_PIN);
   }
   
-  Serial.println("   ✅ Desk lamp update complete");
-  Serial.println("===========================");
+  LOG_DEBUG("   ✅ Desk lamp update complete\n");
+  LOG_DEBUG("===========================\n");
 }
 #endif
 
 // ===== 风扇控制函数 =====
 #if ENABLE_FAN
 void updateFan() {
-  Serial.println("🌀 === Fan Update ===");
+  LOG_DEBUG("🌀 === Fan Update ===\n");
   
   digitalWrite(FAN_PIN, fan_status ? HIGH : LOW);
   
-  Serial.printf("   🌀 Status: %s\n", fan_status ? "ON" : "OFF");
-  Serial.printf("   📍 Output Pin: GPIO%d set to %s\n", 
+  LOG_DEBUG("   🌀 Status: %s\n", fan_status ? "ON" : "OFF");
+  LOG_DEBUG("   📍 Output Pin: GPIO%d set to %s\n", 
                 FAN_PIN, fan_status ? "HIGH" : "LOW");
-  Serial.println("   ✅ Fan update complete");
-  Serial.println("=====================");
+  LOG_DEBUG("   ✅ Fan update complete\n");
+  LOG_DEBUG("=====================\n");
 }
 #endif
 
+// ===== 控制命令分发表 =====
+// 设备名和动作名在PROGMEM中，收到命令时用strcmp_P换成ID，再查(设备, 动作)路由表，
+// 处理函数直接读取JsonVariantConst参数，整个过程不产生String也不分配堆内存
+
+enum DeviceId : uint8_t {
+  DEVICE_CEILING_LIGHT,
+  DEVICE_DESK_LAMP,
+  DEVICE_FAN,
+  DEVICE_COUNT,
+  DEVICE_UNKNOWN = 0xFF
+};
+
+enum ActionId : uint8_t {
+  ACTION_ON,
+  ACTION_OFF,
+  ACTION_TOGGLE,
+  ACTION_SET_BRIGHTNESS,
+  ACTION_SET_COLOR_TEMP,
+  ACTION_COUNT,
+  ACTION_UNKNOWN = 0xFF
+};
+
+const char DEVICE_NAME_CEILING_LIGHT[] PROGMEM = "ceiling_light";
+const char DEVICE_NAME_DESK_LAMP[] PROGMEM = "desk_lamp";
+const char DEVICE_NAME_FAN[] PROGMEM = "fan";
+
+const char ACTION_NAME_ON[] PROGMEM = "on";
+const char ACTION_NAME_OFF[] PROGMEM = "off";
+const char ACTION_NAME_TOGGLE[] PROGMEM = "toggle";
+const char ACTION_NAME_SET_BRIGHTNESS[] PROGMEM = "set_brightness";
+const char ACTION_NAME_SET_COLOR_TEMP[] PROGMEM = "set_color_temp";
+
+// 下标即ID
+const char* const DEVICE_NAMES[DEVICE_COUNT] = {
+  DEVICE_NAME_CEILING_LIGHT,
+  DEVICE_NAME_DESK_LAMP,
+  DEVICE_NAME_FAN
+};
+
+const char* const ACTION_NAMES[ACTION_COUNT] = {
+  ACTION_NAME_ON,
+  ACTION_NAME_OFF,
+  ACTION_NAME_TOGGLE,
+  ACTION_NAME_SET_BRIGHTNESS,
+  ACTION_NAME_SET_COLOR_TEMP
+};
+
+// 把名字换成表中的下标，找不到返回0xFF
+uint8_t internName(const char* name, const char* const* table, uint8_t count) {
+  if (!name) {
+    return 0xFF;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp_P(name, table[i]) == 0) {
+      return i;
+    }
+  }
+  return 0xFF;
+}
+
+typedef void (*CommandHandler)(JsonVariantConst params);
+
+struct CommandRoute {
+  DeviceId device;
+  ActionId action;
+  CommandHandler handler;
+};
+
+#if ENABLE_CEILING_LIGHT
+void ceilingLightOn(JsonVariantConst) { ceiling_light.status = true; }
+void ceilingLightOff(JsonVariantConst) { ceiling_light.status = false; }
+void ceilingLightToggle(JsonVariantConst) { ceiling_light.status = !ceiling_light.status; }
+void ceilingLightSetBrightness(JsonVariantConst params) {
+  JsonVariantConst brightness = params["brightness"];
+  if (!brightness.isNull()) {
+    ceiling_light.brightness = brightness.as<int>();
+    ceiling_light.status = (ceiling_light.brightness > 0);
+  }
+}
+void ceilingLightSetColorTemp(JsonVariantConst params) {
+  JsonVariantConst colorTemp = params["color_temp"];
+  if (!colorTemp.isNull()) {
+    ceiling_light.color_temp = colorTemp.as<int>();
+  }
+}
+#endif
+
+#if ENABLE_DESK_LAMP
+void deskLampOn(JsonVariantConst) { desk_lamp.status = true; }
+void deskLampOff(JsonVariantConst) { desk_lamp.status = false; }
+void deskLampToggle(JsonVariantConst) { desk_lamp.status = !desk_lamp.status; }
+void deskLampSetBrightness(JsonVariantConst params) {
+  JsonVariantConst brightness = params["brightness"];
+  if (!brightness.isNull()) {
+    desk_lamp.brightness = brightness.as<int>();
+    desk_lamp.status = (desk_lamp.brightness > 0);
+  }
+}
+#endif
+
+#if ENABLE_FAN
+void fanOn(JsonVariantConst) { fan_status = true; }
+void fanOff(JsonVariantConst) { fan_status = false; }
+void fanToggle(JsonVariantConst) { fan_status = !fan_status; }
+#endif
+
+const CommandRoute COMMAND_ROUTES[] = {
+  #if ENABLE_CEILING_LIGHT
+  {DEVICE_CEILING_LIGHT, ACTION_ON, ceilingLightOn},
+  {DEVICE_CEILING_LIGHT, ACTION_OFF, ceilingLightOff},
+  {DEVICE_CEILING_LIGHT, ACTION_TOGGLE, ceilingLightToggle},
+  {DEVICE_CEILING_LIGHT, ACTION_SET_BRIGHTNESS, ceilingLightSetBrightness},
+  {DEVICE_CEILING_LIGHT, ACTION_SET_COLOR_TEMP, ceilingLightSetColorTemp},
+  #endif
+  #if ENABLE_DESK_LAMP
+  {DEVICE_DESK_LAMP, ACTION_ON, deskLampOn},
+  {DEVICE_DESK_LAMP, ACTION_OFF, deskLampOff},
+  {DEVICE_DESK_LAMP, ACTION_TOGGLE, deskLampToggle},
+  {DEVICE_DESK_LAMP, ACTION_SET_BRIGHTNESS, deskLampSetBrightness},
+  #endif
+  #if ENABLE_FAN
+  {DEVICE_FAN, ACTION_ON, fanOn},
+  {DEVICE_FAN, ACTION_OFF, fanOff},
+  {DEVICE_FAN, ACTION_TOGGLE, fanToggle},
+  #endif
+  {DEVICE_UNKNOWN, ACTION_UNKNOWN, nullptr}  // 结束标记，所有设备都禁用时数组也不为空
+};
+
+// 命令处理后把设备状态输出到硬件
+void applyDevice(DeviceId device) {
+  switch (device) {
+    #if ENABLE_CEILING_LIGHT
+    case DEVICE_CEILING_LIGHT: updateCeilingLight(); break;
+    #endif
+    #if ENABLE_DESK_LAMP
+    case DEVICE_DESK_LAMP: updateDeskLamp(); break;
+    #endif
+    #if ENABLE_FAN
+    case DEVICE_FAN: updateFan(); break;
+    #endif
+    default: break;
+  }
+}
+
 // ===== 处理IoT控制消息 =====
-void handleControlMessage(JsonObject& command) {
-  String device = command["device"].as<String>();
-  String action = command["action"].as<String>();
-  String location = command["location"].as<String>();
+// 返回执行结果，写入ack帧
+const char* handleControlMessage(JsonObjectConst command) {
+  const char* deviceName = command["device"];
+  const char* actionName = command["action"];
+  const char* location = command["location"];
   
   // 只处理目标房间的命令
-  if (location != TARGET_ROOM) {
-    Serial.printf("🚫 Ignoring command for room: %s (target: %s)\n", 
-                  location.c_str(), TARGET_ROOM);
-    return;
+  if (!location || strcmp(location, TARGET_ROOM) != 0) {
+    LOG_DEBUG("🚫 Ignoring command for room: %s (target: %s)\n", 
+                  location ? location : "(none)", TARGET_ROOM);
+    return "ignored";
   }
   
-  JsonObject params = command["parameters"];
-  
-  Serial.println("\n🎮 === Processing Control Command ===");
-  Serial.printf("   📍 Room: %s\n", location.c_str());
-  Serial.printf("   🔧 Device: %s\n", device.c_str());
-  Serial.printf("   ⚡ Action: %s\n", action.c_str());
-  
-  // 打印所有参数
-  if (params) {
-    Serial.println("   📊 Parameters:");
-    for (JsonPair kv : params) {
-      Serial.printf("      - %s: ", kv.key().c_str());
-      if (kv.value().is<int>()) {
-        Serial.printf("%d\n", kv.value().as<int>());
-      } else if (kv.value().is<float>()) {
-        Serial.printf("%.1f\n", kv.value().as<float>());
-      } else {
-        Serial.printf("%s\n", kv.value().as<String>().c_str());
-      }
-    }
-  }
-  Serial.println("=====================================");
+  unsigned long start = micros();
+  uint8_t device = internName(deviceName, DEVICE_NAMES, DEVICE_COUNT);
+  uint8_t action = internName(actionName, ACTION_NAMES, ACTION_COUNT);
   
-  // 处理顶灯命令
-  #if ENABLE_CEILING_LIGHT
-  if (device == "ceiling_light") {
-    if (action == "on") {
-      ceiling_light.status = true;
-    } else if (action == "off") {
-      ceiling_light.status = false;
-    } else if (action == "toggle") {
-      ceiling_light.status = !ceiling_light.status;
-    } else if (action == "set_brightness" && params.containsKey("brightness")) {
-      ceiling_light.brightness = params["brightness"];
-      ceiling_light.status = (ceiling_light.brightness > 0);
-    } else if (action == "set_color_temp" && params.containsKey("color_temp")) {
-      ceiling_light.color_temp = params["color_temp"];
+  const CommandRoute* route = nullptr;
+  for (const CommandRoute& r : COMMAND_ROUTES) {
+    if (r.handler && r.device == device && r.action == action) {
+      route = &r;
+      break;
     }
-    updateCeilingLight();
-    Serial.printf("💡 Ceiling light - Status: %s, Brightness: %d%%, Color temp: %dK\n", 
-                  ceiling_light.status ? "ON" : "OFF", 
-                  ceiling_light.brightness, 
-                  ceiling_light.color_temp);
   }
-  #endif
   
-  // 处理台灯命令
-  #if ENABLE_DESK_LAMP
-  if (device == "desk_lamp") {
-    if (action == "on") {
-      desk_lamp.status = true;
-    } else if (action == "off") {
-      desk_lamp.status = false;
-    } else if (action == "toggle") {
-      desk_lamp.status = !desk_lamp.status;
-    } else if (action == "set_brightness" && params.containsKey("brightness")) {
-      desk_lamp.brightness = params["brightness"];
-      desk_lamp.status = (desk_lamp.brightness > 0);
-    }
-    updateDeskLamp();
-    Serial.printf("🛋️ Desk lamp - Status: %s, Brightness: %d%%\n", 
-                  desk_lamp.status ? "ON" : "OFF", 
-                  desk_lamp.brightness);
+  if (!route) {
+    LOG_WARN("❓ Unsupported command: %s/%s\n",
+                  deviceName ? deviceName : "(none)", actionName ? actionName : "(none)");
+    return "unsupported";
   }
-  #endif
   
-  // 处理风扇命令
-  #if ENABLE_FAN
-  if (device == "fan") {
-    if (action == "on") {
-      fan_status = true;
-    } else if (action == "off") {
-      fan_status = false;
-    } else if (action == "toggle") {
-      fan_status = !fan_status;
-    }
-    updateFan();
-    Serial.printf("🌀 Fan - Status: %s\n", 
-                  fan_status ? "ON" : "OFF");
+  route->handler(command["parameters"]);
+  unsigned long elapsed = micros() - start;
+  telemetryRecord(g_dispatch_channel, elapsed, true);
+  
+  LOG_DEBUG("🎮 %s/%s in %s (dispatch %lu us)\n", deviceName, actionName, location, elapsed);
+  applyDevice(route->device);
+  return "applied";
+}
+
+// 按服务器下发的设备状态同步本房间的设备，device_update和服务器合并下发的control命令共用
+const char* applyDeviceState(const char* device, JsonObjectConst state, const char* status) {
+  bool on = strcmp(status, "on") == 0;
+  
+  // 根据设备类型处理状态更新
+  const char* result = "applied";
+  switch (internName(device, DEVICE_NAMES, DEVICE_COUNT)) {
+    #if ENABLE_CEILING_LIGHT
+    case DEVICE_CEILING_LIGHT:
+      ceiling_light.status = on;
+      ceiling_light.brightness = state["brightness"] | ceiling_light.brightness;
+      ceiling_light.color_temp = state["color_temp"] | ceiling_light.color_temp;
+      LOG_DEBUG("   🎨 Updating ceiling light from device_update\n");
+      updateCeilingLight();
+      break;
+    #endif
+    
+    #if ENABLE_DESK_LAMP
+    case DEVICE_DESK_LAMP:
+      desk_lamp.status = on;
+      desk_lamp.brightness = state["brightness"] | desk_lamp.brightness;
+      LOG_DEBUG("   💡 Updating desk lamp from device_update\n");
+      updateDeskLamp();
+      break;
+    #endif
+    
+    #if ENABLE_FAN
+    case DEVICE_FAN:
+      fan_status = on;
+      LOG_DEBUG("   🌀 Updating fan from device_update\n");
+      updateFan();
+      break;
+    #endif
+    
+    default:
+      result = "unsupported";
+      break;
   }
-  #endif
+  return result;
+}
+
+// 服务器合并下发的control命令带有执行后的state，直接按state同步，避免与服务器的状态计算不一致
+const char* applyCommandState(JsonObjectConst command) {
+  const char* location = command["location"] | "";
+  if (strcmp(location, TARGET_ROOM) != 0) {
+    LOG_DEBUG("🚫 Ignoring command for room: %s (target: %s)\n", location, TARGET_ROOM);
+    return "ignored";
+  }
+  JsonObjectConst state = command["state"];
+  return applyDeviceState(command["device"] | "", state, state["status"] | "");
+}
+
+// ===== 命令确认（ack） =====
+// 每个收到的control帧（服务器把一次请求中发往本房间的命令合并成一帧）或带seq的device_update回一条ack帧，
+// 包含每条命令的seq、结果和执行时刻，服务器据此统计命令的往返延迟
+#define ACK_BUFFER_SIZE 512
+
+uint8_t ackFrame[WS_FRAME_BUFFER_SIZE(ACK_BUFFER_SIZE)];  // 前面留出帧头，发送时不产生堆分配
+char* const ackBuffer = WS_FRAME_PAYLOAD(ackFrame);
+size_t ackLength = 0;
+int ackCount = 0;
+
+void ackBegin() {
+  ackLength = snprintf(ackBuffer, ACK_BUFFER_SIZE,
+                       "{\"type\":\"ack\",\"device_id\":\"%s\",\"location\":\"%s\",\"acks\":[",
+                       deviceId, TARGET_ROOM);
+  ackCount = 0;
+}
+
+void ackAdd(JsonVariantConst seq, const char* status) {
+  if (seq.isNull()) {
+    return;  // 没有seq的命令不需要确认
+  }
+  int n = snprintf(ackBuffer + ackLength, ACK_BUFFER_SIZE - ackLength,
+                   "%s{\"seq\":%ld,\"status\":\"%s\",\"applied_ms\":%lu}",
+                   ackCount ? "," : "", seq.as<long>(), status, millis());
+  if (n < 0 || (size_t)n >= ACK_BUFFER_SIZE - ackLength - 2) {
+    return;  // 缓冲区不够时丢弃这一条，留出结尾"]}"的空间
+  }
+  ackLength += n;
+  ackCount++;
+}
+
+void ackSend() {
+  if (ackCount == 0 || !wsConnected) {
+    return;
+  }
+  ackLength += snprintf(ackBuffer + ackLength, ACK_BUFFER_SIZE - ackLength, "]}");
+  bool sent = telemetryWsSendFrame(webSocket, ackFrame, ackLength);
+  LOG_DEBUG("📨 Ack %d command(s): %s\n", ackCount, sent ? "sent" : "failed");
 }
 
 // ===== WebSocket消息处理 =====
-void handleMessage(const char* message) {
-  DynamicJsonDocument doc(1024);
-  DeserializationError error = deserializeJson(doc, message);
+// 入站消息过滤：只保留type/location、本房间的命令和设备状态，
+// init/status_response中其他房间的完整设备状态在解析时直接跳过
+#define INBOUND_DOC_SIZE 1024
+
+StaticJsonDocument<512> inboundFilter;
+
+void initInboundFilter() {
+  if (!inboundFilter.isNull()) {
+    return;
+  }
+  inboundFilter["type"] = true;
+  inboundFilter["location"] = true;
+  inboundFilter["seq"] = true;
+  inboundFilter["message"] = true;
+  
+  // control
+  JsonObject command = inboundFilter["commands"].createNestedObject();
+  command["seq"] = true;
+  command["device"] = true;
+  command["action"] = true;
+  command["location"] = true;
+  command["parameters"] = true;
+  command["state"] = true;
+  
+  // init：只取本房间的设备状态
+  JsonObject devices = inboundFilter.createNestedObject("devices");
+  devices["ceiling_light"][TARGET_ROOM] = true;
+  devices["desk_lamp"][TARGET_ROOM] = true;
+  devices["fan"][TARGET_ROOM] = true;
+  
+  // device_update
+  inboundFilter["device"] = true;
+  inboundFilter["state"] = true;
+  inboundFilter["status"] = true;
+}
+
+// payload按原地（zero-copy）解析，字符串直接指向payload缓冲区
+void handleMessage(char* payload, size_t length) {
+  StaticJsonDocument<INBOUND_DOC_SIZE> doc;
+  DeserializationError error = deserializeJson(doc, payload, length,
+                                               DeserializationOption::Filter(inboundFilter));
   
   if (error) {
-    Serial.printf("❌ JSON parse error: %s\n", error.c_str());
+    LOG_WARN("❌ JSON parse error: %s\n", error.c_str());
     return;
   }
   
-  String type = doc["type"].as<String>();
+  const char* type = doc["type"] | "";
   
   // 过滤sensor_update消息，不显示日志
-  if (type == "sensor_update") {
+  if (strcmp(type, "sensor_update") == 0) {
     return;  // 直接返回，不处理也不显示
   }
   
   // 过滤error消息的原始内容
-  if (type == "error") {
-    Serial.println("\n❌ === Error Message ===");
-    Serial.printf("Error: %s\n", doc["message"].as<String>().c_str());
-    Serial.println("======================");
+  if (strcmp(type, "error") == 0) {
+    LOG_WARN("❌ Error message from server: %s\n", doc["message"] | "");
     return;
   }
   
   // 其他消息只显示类型，不显示原始内容
-  Serial.printf("\n📋 Processing message type: %s\n", type.c_str());
+  LOG_DEBUG("\n📋 Processing message type: %s\n", type);
   
-  if (type == "control") {
+  if (strcmp(type, "control") == 0) {
     // 处理控制命令
-    if (doc["commands"].is<JsonArray>()) {
-      JsonArray commands = doc["commands"];
-      Serial.printf("🎮 Found %d commands to process\n", commands.size());
+    JsonArrayConst commands = doc["commands"];
+    if (!commands.isNull()) {
+      LOG_DEBUG("🎮 Found %d commands to process\n", commands.size());
       
-      for (JsonObject command : commands) {
-        Serial.println("\n--- Processing Command ---");
-        Serial.printf("Device: %s\n", command["device"].as<String>().c_str());
-        Serial.printf("Action: %s\n", command["action"].as<String>().c_str());
-        Serial.printf("Location: %s\n", command["location"].as<String>().c_str());
-        
-        handleControlMessage(command);
+      ackBegin();
+      for (JsonObjectConst command : commands) {
+        const char* status = command["state"].isNull() ? handleControlMessage(command) : applyCommandState(command);
+        ackAdd(command["seq"], status);
       }
+      ackSend();
     }
-  } else if (type == "control_results") {
+  } else if (strcmp(type, "control_results") == 0) {
     // 处理控制结果反馈
-    Serial.println("✅ Control command acknowledged");
-  } else if (type == "init") {
-    Serial.println("🏠 === IoT Service Initialized ===");
-    
-    // 解析并应用初始设备状态
-    if (doc["devices"].is<JsonObject>()) {
-      JsonObject devices = doc["devices"];
-      
-      // 检查并更新ceiling_light状态
-      #if ENABLE_CEILING_LIGHT
-      if (devices.containsKey("ceiling_light")) {
-        JsonObject lights = devices["ceiling_light"];
-        if (lights.containsKey(TARGET_ROOM)) {
-          JsonObject roomLight = lights[TARGET_ROOM];
-          ceiling_light.status = (roomLight["status"].as<String>() == "on");
-          ceiling_light.brightness = roomLight["brightness"] | 50;
-          ceiling_light.color_temp = roomLight["color_temp"] | 4000;
-          
-          Serial.printf("   💡 Ceiling light initial state: %s, %d%%, %dK\n", 
-                        ceiling_light.status ? "ON" : "OFF",
-                        ceiling_light.brightness,
-                        ceiling_light.color_temp);
-          updateCeilingLight();
-        }
-      }
-      #endif
-      
-      // 检查并更新desk_lamp状态
-      #if ENABLE_DESK_LAMP
-      if (devices.containsKey("desk_lamp")) {
-        JsonObject lamps = devices["desk_lamp"];
-        if (lamps.containsKey(TARGET_ROOM)) {
-          JsonObject roomLamp = lamps[TARGET_ROOM];
-          desk_lamp.status = (roomLamp["status"].as<String>() == "on");
-          desk_lamp.brightness = roomLamp["brightness"] | 50;
-          
-          Serial.printf("   🛋️ Desk lamp initial state: %s, %d%%\n", 
-                        desk_lamp.status ? "ON" : "OFF",
-                        desk_lamp.brightness);
-          updateDeskLamp();
-        }
-      }
-      #endif
-      
-      // 检查并更新fan状态
-      #if ENABLE_FAN
-      if (devices.containsKey("fan")) {
-        JsonObject fans = devices["fan"];
-        if (fans.containsKey(TARGET_ROOM)) {
-          JsonObject roomFan = fans[TARGET_ROOM];
-          fan_status = (roomFan["status"].as<String>() == "on");
-          
-          Serial.printf("   🌀 Fan initial state: %s\n", 
-                        fan_status ? "ON" : "OFF");
-          updateFan();
-        }
-      }
-      #endif
-    }
-    
-    Serial.println("=================================");
-  } else if (type == "device_update") {
-    // 处理设备状态更新
-    Serial.println("📡 === Device Update Message ===");
+    LOG_DEBUG("✅ Control command acknowledged\n");
+  } else if (strcmp(type, "subscribed") == 0) {
+    LOG_INFO("📮 Subscription confirmed for room: %s\n", TARGET_ROOM);
+  } else if (strcmp(type, "init") == 0) {
+    LOG_INFO("🏠 === IoT Service Initialized ===\n");
     
-    // 显示完整的JSON消息用于调试
-    Serial.println("📄 Debug - Full device_update JSON:");
-    String jsonStr;
-    serializeJson(doc, jsonStr);
-    Serial.println(jsonStr);
-    Serial.println("---");
+    // 解析并应用初始设备状态（过滤后只剩本房间）
+    JsonObjectConst devices = doc["devices"];
     
-    String device = doc["device"].as<String>();
-    String location = doc["location"].as<String>();
-    String status = "";
-    
-    // 检查state对象
-    if (doc.containsKey("state")) {
-      JsonObject state = doc["state"];
-      status = state["status"].as<String>();
-      Serial.println("   📦 Found state object:");
-      Serial.printf("      - Status from state: %s\n", status.c_str());
-    } else if (doc.containsKey("status")) {
-      // 向后兼容：如果有直接的status字段
-      status = doc["status"].as<String>();
-      Serial.printf("   📊 Status from root: %s\n", status.c_str());
-    }
-    
-    Serial.printf("   🔧 Device: %s\n", device.c_str());
-    Serial.printf("   📍 Location: %s\n", location.c_str());
-    Serial.printf("   📊 Final Status: %s\n", status.c_str());
-    
-    // 只处理目标房间的更新
-    if (location != TARGET_ROOM) {
-      Serial.printf("   🚫 Ignoring update for room: %s\n", location.c_str());
-      return;
-    }
-    
-    // 根据设备类型处理状态更新
     #if ENABLE_CEILING_LIGHT
-    if (device == "ceiling_light") {
-      ceiling_light.status = (status == "on");
-      
-      // 检查state对象中的其他参数
-      if (doc.containsKey("state")) {
-        JsonObject state = doc["state"];
-        if (state.containsKey("brightness")) {
-          ceiling_light.brightness = state["brightness"];
-        }
-        if (state.containsKey("color_temp")) {
-          ceiling_light.color_temp = state["color_temp"];
-        }
-      }
+    JsonObjectConst roomLight = devices["ceiling_light"][TARGET_ROOM];
+    if (!roomLight.isNull()) {
+      ceiling_light.status = strcmp(roomLight["status"] | "", "on") == 0;
+      ceiling_light.brightness = roomLight["brightness"] | 50;
+      ceiling_light.color_temp = roomLight["color_temp"] | 4000;
       
-      Serial.println("   🎨 Updating ceiling light from device_update");
+      LOG_INFO("   💡 Ceiling light initial state: %s, %d%%, %dK\n", 
+                    ceiling_light.status ? "ON" : "OFF",
+                    ceiling_light.brightness,
+                    ceiling_light.color_temp);
       updateCeilingLight();
     }
     #endif
     
     #if ENABLE_DESK_LAMP
-    if (device == "desk_lamp") {
-      desk_lamp.status = (status == "on");
+    JsonObjectConst roomLamp = devices["desk_lamp"][TARGET_ROOM];
+    if (!roomLamp.isNull()) {
+      desk_lamp.status = strcmp(roomLamp["status"] | "", "on") == 0;
+      desk_lamp.brightness = roomLamp["brightness"] | 50;
       
-      // 检查state对象中的其他参数
-      if (doc.containsKey("state")) {
-        JsonObject state = doc["state"];
-        if (state.containsKey("brightness")) {
-          desk_lamp.brightness = state["brightness"];
-        }
-      }
-      
-      Serial.println("   💡 Updating desk lamp from device_update");
+      LOG_INFO("   🛋️ Desk lamp initial state: %s, %d%%\n", 
+                    desk_lamp.status ? "ON" : "OFF",
+                    desk_lamp.brightness);
       updateDeskLamp();
     }
     #endif
     
     #if ENABLE_FAN
-    if (device == "fan") {
-      Serial.printf("   🔍 Debug - Comparing device '%s' with 'fan'\n", device.c_str());
-      Serial.printf("   🔍 Debug - Current fan_status before update: %s\n", fan_status ? "ON" : "OFF");
-      Serial.printf("   🔍 Debug - Status value: '%s'\n", status.c_str());
-      
-      fan_status = (status == "on");
+    JsonObjectConst roomFan = devices["fan"][TARGET_ROOM];
+    if (!roomFan.isNull()) {
+      fan_status = strcmp(roomFan["status"] | "", "on") == 0;
       
-      Serial.printf("   🔍 Debug - New fan_status after update: %s\n", fan_status ? "ON" : "OFF");
-      Serial.println("   🌀 Updating fan from device_update");
+      LOG_INFO("   🌀 Fan initial state: %s\n", 
+                    fan_status ? "ON" : "OFF");
       updateFan();
     }
     #endif
     
-    Serial.println("===============================");
-  } else if (type != "pong" && type != "ping") {
+    LOG_INFO("=================================\n");
+  } else if (strcmp(type, "device_update") == 0) {
+    // 处理设备状态更新
+    LOG_DEBUG("📡 === Device Update Message ===\n");
+    
+    const char* location = doc["location"] | "";
+    const char* device = doc["device"] | "";
+    JsonObjectConst state = doc["state"];
+    
+    // 优先使用state对象，向后兼容直接的status字段
+    const char* status = state.isNull() ? (doc["status"] | "") : (state["status"] | "");
+    
+    LOG_DEBUG("   🔧 Device: %s\n", device);
+    LOG_DEBUG("   📍 Location: %s\n", location);
+    LOG_DEBUG("   📊 Status: %s\n", status);
+    
+    // 只处理目标房间的更新
+    if (strcmp(location, TARGET_ROOM) != 0) {
+      LOG_DEBUG("   🚫 Ignoring update for room: %s\n", location);
+      return;
+    }
+    
+    const char* ackStatus = applyDeviceState(device, state, status);
+    
+    ackBegin();
+    ackAdd(doc["seq"], ackStatus);
+    ackSend();
+    
+    LOG_DEBUG("===============================\n");
+  } else if (strcmp(type, "pong") != 0 && strcmp(type, "ping") != 0) {
     // 忽略ping/pong，只报告真正未知的消息
-    Serial.printf("❓ Unknown message type: %s\n", type.c_str());
+    LOG_WARN("❓ Unknown message type: %s\n", type);
   }
 }
 
+// ===== 订阅 =====
+// 只接收本房间的device_update，服务器不再推送其他房间的广播和sensor_update
+void sendSubscribe() {
+  uint8_t frame[WS_FRAME_BUFFER_SIZE(128)];
+  int length = snprintf(WS_FRAME_PAYLOAD(frame), 128,
+                        "{\"type\":\"subscribe\",\"rooms\":[\"%s\"],\"types\":[\"device_update\"],\"acks\":true}",
+                        TARGET_ROOM);
+  bool sent = telemetryWsSendFrame(webSocket, frame, length);
+  LOG_INFO("📮 Subscribe to %s broadcasts: %s\n", TARGET_ROOM, sent ? "sent" : "failed");
+}
+
+// ===== 遥测 =====
+// 每TELEMETRY_INTERVAL_MS上报一次loop耗时分布、LED输出与命令分发耗时、堆与重连，服务器不回复
+#define TELEMETRY_BUFFER_SIZE 512
+
+uint8_t telemetryFrame[WS_FRAME_BUFFER_SIZE(TELEMETRY_BUFFER_SIZE)];
+
+void sendTelemetry() {
+  size_t length = telemetryFormat(WS_FRAME_PAYLOAD(telemetryFrame), TELEMETRY_BUFFER_SIZE, deviceId, TARGET_ROOM);
+  bool sent = length && telemetryWsSendFrame(webSocket, telemetryFrame, length);
+  LOG_DEBUG("📈 Telemetry (loop max %u us, %u bytes): %s\n",
+                g_telemetry.loop_max_us, length, sent ? "sent" : "failed");
+  telemetryResetWindow();
+}
+
 // ===== WebSocket事件处理 =====
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
   switch(type) {
     case WStype_DISCONNECTED:
+      // 重连失败也会触发DISCONNECTED，只统计从已连接到断开的次数
+      if (wsConnected) {
+        telemetryWsDisconnect();
+      }
       wsConnected = false;
-      Serial.println("🔴 Disconnected from IoT Service");
+      subscribePending = false;
+      LOG_INFO("🔴 Disconnected from IoT Service\n");
       break;
       
     case WStype_CONNECTED:
       wsConnected = true;
-      Serial.printf("🟢 Connected to IoT Service: %s\n", payload);
+      subscribePending = true;
+      LOG_INFO("🟢 Connected to IoT Service: %s\n", payload);
       // 连接成功后，服务器会自动发送init消息
       break;
       
     case WStype_TEXT:
-      handleMessage((char*)payload);
+      handleMessage((char*)payload, length);
       break;
       
     case WStype_ERROR:
-      Serial.printf("❌ WebSocket Error: %s\n", payload);
+      LOG_WARN("❌ WebSocket Error: %s\n", payload);
       break;
   }
 }
 
 // ===== 初始化WebSocket =====
 void initWebSocket() {
-  Serial.printf("🔌 Connecting to WebSocket: ws://%s:%d%s\n", 
+  LOG_INFO("🔌 Connecting to WebSocket: ws://%s:%d%s\n", 
                 server_host, server_port, server_path);
   
+  initInboundFilter();
   webSocket.begin(server_host, server_port, server_path);
   webSocket.onEvent(webSocketEvent);
   webSocket.setReconnectInterval(5000);
@@ -511,74 +924,88 @@ void setup() {
   }
   
   // 输出一些空行来分隔乱码
-  Serial.println("\n\n\n");
+  LOG_INFO("\n\n\n\n");
   
-  Serial.println("============================================================");
-  Serial.printf("🏠 ESP8266 IoT Furniture Controller - Room: %s\n", TARGET_ROOM);
-  Serial.println("============================================================");
+  LOG_INFO("============================================================\n");
+  LOG_INFO("🏠 ESP8266 IoT Furniture Controller - Room: %s\n", TARGET_ROOM);
+  LOG_INFO("============================================================\n");
   
   // 显示启用的设备
-  Serial.println("\n📋 Enabled devices:");
+  LOG_INFO("\n📋 Enabled devices:\n");
   #if ENABLE_DESK_LAMP
-  Serial.println("   ✅ Desk Lamp");
+  LOG_INFO("   ✅ Desk Lamp\n");
   #endif
   #if ENABLE_CEILING_LIGHT
-  Serial.println("   ✅ Ceiling Light (WS2812)");
+  LOG_INFO("   ✅ Ceiling Light (WS2812)\n");
   #endif
   #if ENABLE_FAN
-  Serial.println("   ✅ Fan");
+  LOG_INFO("   ✅ Fan\n");
   #endif
   
+  // 初始化遥测
+  initTelemetry();
+  g_show_channel = telemetryAddChannel("ws2812_show");
+  g_dispatch_channel = telemetryAddChannel("dispatch");
+  
   // 初始化硬件引脚
-  Serial.println("\n🔧 Initializing hardware...");
+  LOG_INFO("\n🔧 Initializing hardware...\n");
   
   #if ENABLE_DESK_LAMP
   pinMode(DESK_LAMP_PIN, OUTPUT);
   digitalWrite(DESK_LAMP_PIN, LOW);
-  Serial.println("   ✅ Desk lamp pin configured");
+  LOG_INFO("   ✅ Desk lamp pin configured\n");
   #endif
   
   #if ENABLE_CEILING_LIGHT
   strip.begin();
   strip.show(); // 初始化所有LED为关闭状态
-  Serial.printf("   ✅ WS2812 initialized with %d LEDs\n", WS2812_COUNT);
+  LOG_INFO("   ✅ WS2812 initialized with %d LEDs\n", WS2812_COUNT);
   #endif
   
   #if ENABLE_FAN
   pinMode(FAN_PIN, OUTPUT);
   digitalWrite(FAN_PIN, LOW);
-  Serial.println("   ✅ Fan pin configured");
+  LOG_INFO("   ✅ Fan pin configured\n");
   #endif
   
-  // 连接WiFi
-  Serial.println("\n📶 Connecting to network...");
-  connectWiFi();
+  // 开始连接WiFi（不等待），连上后WebSocket在loop()中自动建立连接
+  LOG_INFO("\n📶 Connecting to network...\n");
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(deviceId, sizeof(deviceId), "%02X:%02X:%02X:%02X:%02X:%02X",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
   
-  if (wifiConnected) {
-    delay(2000);
-    initWebSocket();
-  } else {
-    Serial.println("❌ Cannot proceed without WiFi connection");
-  }
+  initWiFiManager();
+  initWebSocket();
   
-  Serial.println("\n✅ Setup complete!");
-  Serial.println("============================================================\n");
+  LOG_INFO("\n✅ Setup complete!\n");
+  LOG_INFO("============================================================\n\n");
 }
 
 // ===== 主循环 =====
 void loop() {
-  // 检查WiFi连接
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("❌ WiFi lost, reconnecting...");
-    connectWiFi();
-    if (wifiConnected) {
-      initWebSocket();
+  telemetryLoopBegin();
+
+  // 推进WiFi连接状态机，连上后才处理WebSocket
+  if (wifiManagerLoop()) {
+    webSocket.loop();
+    
+    if (subscribePending && wsConnected) {
+      subscribePending = false;
+      sendSubscribe();
+    }
+
+    if (wsConnected && telemetryDue()) {
+      sendTelemetry();
     }
-    return;
   }
   
-  // 处理WebSocket
-  webSocket.loop();
+  // 推进顶灯渐变（限帧）
+  #if ENABLE_CEILING_LIGHT
+  runLightTransition();
+  #endif
+  
+  telemetryLoopEnd();
   
   // 添加看门狗喂狗
   yield();
@@ -6,6 +6,9 @@
 #include <JPEGDecoder.h>   // 可选：JPEG解码
 #include <FS.h>
 #include <SPIFFS.h>
+#include <driver/uart.h>   // UART驱动事件队列
+#include <atomic>
+#include <display_protocol.h>
 
 // 显示屏配置 - 要在User_Setup.h中正确配置TFT_eSPI
 TFT_eSPI tft = TFT_eSPI();
@@ -24,6 +27,15 @@ TFT_eSprite sprite = TFT_eSprite(&tft); // 用于双缓冲
 #define RX_PIN 16          // UART RX引脚
 #define TX_PIN 17          // UART TX引脚
 #define UART_BAUD 115200   // 波特率
+#define UART_PORT UART_NUM_2
+#define UART_DRIVER_RX_BUFFER 512    // 驱动内部由中断填充的缓冲区
+#define UART_EVENT_QUEUE_LENGTH 16
+#define RX_RING_SIZE 1024            // 命令任务的接收环形缓冲区，必须是2的幂
+
+// 任务配置：UART事件任务只搬运字节，优先级最高；命令任务解析帧并驱动显示屏
+#define UART_TASK_PRIORITY 12
+#define COMMAND_TASK_PRIORITY 5
+#define TASK_STACK_SIZE 4096
 
 // 显示屏分辨率
 #define SCREEN_WIDTH 320   // 显示屏宽度
@@ -53,36 +65,136 @@ PNG png;
 // 当前图片索引
 int currentImage = 0;
 
-// UART命令缓冲区
-String commandBuffer = "";
+// UART接收：驱动中断 -> 事件队列 -> uartEventTask -> rxRing -> commandTask
+// 单生产者/单消费者，不需要锁，也没有堆分配
+static_assert((RX_RING_SIZE & (RX_RING_SIZE - 1)) == 0, "RX_RING_SIZE必须是2的幂");
+uint8_t rxRing[RX_RING_SIZE];
+std::atomic<uint32_t> rxHead(0);
+std::atomic<uint32_t> rxTail(0);
+
+QueueHandle_t uartEventQueue = NULL;
+TaskHandle_t commandTaskHandle = NULL;
+SemaphoreHandle_t displayMutex = NULL;   // 命令任务和loop()(触摸)都会操作屏幕和SPI
+FrameParser frameParser;
+uint8_t txSeq = 0;
+
+// 链路统计
+volatile uint32_t rxRingDrops = 0;
+volatile uint32_t uartOverflows = 0;
+volatile uint32_t commandLatencyMaxUs = 0;
 
 // 用于PNG解码的缓冲区
 #define PNG_BUFFER_SIZE 32768  // 根据需要调整大小
 uint8_t pngBuffer[PNG_BUFFER_SIZE];
 
+// 行渲染：每个解码出的源行按预计算的整数索引表缩放成一整行，用一次DMA推送到屏幕
+// 两个行缓冲交替使用，DMA发送上一行时CPU解码下一行
+#define USE_DMA_PUSH 1
+#define PNG_MAX_SOURCE_WIDTH 480   // 源图最大宽度
+
+uint16_t srcLine[PNG_MAX_SOURCE_WIDTH];
+uint16_t scaledLines[2][SCALED_WIDTH];
+uint8_t scaledLineIndex = 0;
+
+// 缩放索引表：目标像素 -> 源像素，只在源图尺寸变化时重建
+uint16_t scaleX[SCALED_WIDTH];
+uint16_t scaleY[SCALED_HEIGHT];
+int16_t scaleSrcWidth = -1;
+int16_t scaleSrcHeight = -1;
+uint16_t nextDestRow = 0;     // 下一行要输出的目标行
+
+// 表情精灵缓存：启动时把每张PNG解码成320x320 RGB565原始数据，之后切换表情只需直接推送，不再解码
+// 有PSRAM时缓存在PSRAM（每张200KB），否则写到SD卡的/cache/*.565，按块读出推送
+#define SPRITE_CACHE_DIR "/cache"
+#define SPRITE_MAGIC 0x35363552     // "R565"
+#define SPRITE_BLIT_LINES 16        // SD缓存每次读取的行数
+
+struct SpriteHeader {
+  uint32_t magic;
+  uint16_t width;
+  uint16_t height;
+  uint32_t sourceSize;              // 源PNG大小，PNG更新后缓存自动重建
+};
+
+uint16_t *spriteCache[MAX_IMAGES] = {NULL};
+uint16_t blitBuffer[SPRITE_BLIT_LINES * SCALED_WIDTH];
+
+// 解码输出目标
+enum DecodeTarget {
+  DECODE_TO_SCREEN,
+  DECODE_TO_MEMORY,
+  DECODE_TO_FILE
+};
+
+DecodeTarget decodeTarget = DECODE_TO_SCREEN;
+uint16_t *decodeMemory = NULL;
+File decodeFile;
+bool decodeUseDMA = false;        // 只有PNG在RAM中时才占住总线并用DMA，流式解码时SD卡与屏幕共用SPI总线
+File pngStreamFile;
+
+// 16.16定点DDA最近邻映射（目标像素中心对应的源像素）
+void buildScaleTable(uint16_t *table, int dstLen, int srcLen) {
+  uint32_t step = ((uint32_t)srcLen << 16) / dstLen;
+  uint32_t pos = step >> 1;
+  for (int i = 0; i < dstLen; i++) {
+    table[i] = pos >> 16;
+    pos += step;
+  }
+}
+
+void prepareScaleTables(int srcWidth, int srcHeight) {
+  if (srcWidth == scaleSrcWidth && srcHeight == scaleSrcHeight) {
+    return;
+  }
+  buildScaleTable(scaleX, SCALED_WIDTH, srcWidth);
+  buildScaleTable(scaleY, SCALED_HEIGHT, srcHeight);
+  scaleSrcWidth = srcWidth;
+  scaleSrcHeight = srcHeight;
+}
+
+void pushScaledLine(int y, uint16_t *line) {
+  switch (decodeTarget) {
+    case DECODE_TO_MEMORY:
+      memcpy(decodeMemory + y * SCALED_WIDTH, line, SCALED_WIDTH * sizeof(uint16_t));
+      break;
+
+    case DECODE_TO_FILE:
+      decodeFile.write((uint8_t *)line, SCALED_WIDTH * sizeof(uint16_t));
+      break;
+
+    default:
+#if USE_DMA_PUSH
+      if (decodeUseDMA) {
+        tft.pushImageDMA((SCREEN_WIDTH - SCALED_WIDTH) / 2, y + (SCREEN_HEIGHT - SCALED_HEIGHT) / 2,
+                         SCALED_WIDTH, 1, line);
+        break;
+      }
+#endif
+      tft.pushImage((SCREEN_WIDTH - SCALED_WIDTH) / 2, y + (SCREEN_HEIGHT - SCALED_HEIGHT) / 2,
+                    SCALED_WIDTH, 1, line);
+      break;
+  }
+}
+
 // PNG绘制回调函数
 void PNGDraw(PNGDRAW *pDraw) {
-  uint16_t lineBuffer[SCREEN_WIDTH];
-  
-  // 计算缩放因子
-  float scaleX = (float)SCALED_WIDTH / ORIGINAL_WIDTH;
-  float scaleY = (float)SCALED_HEIGHT / ORIGINAL_HEIGHT;
+  // 缩小时跳过不需要的源行，不做颜色转换
+  if (nextDestRow >= SCALED_HEIGHT || scaleY[nextDestRow] != pDraw->y) {
+    return;
+  }
 
-  // 检查是否在显示屏范围内
-  if (pDraw->y * scaleY < SCREEN_HEIGHT) {
-    png.getLineAsRGB565(pDraw, lineBuffer, PNG_RGB565_LITTLE_ENDIAN, 0xffffffff);
-    
-    // 绘制缩放后的行
-    for (int x = 0; x < SCALED_WIDTH; x++) {
-      // 计算原始图像中对应的像素位置
-      int srcX = (int)(x / scaleX);
-      if (srcX < pDraw->iWidth) {
-        tft.drawPixel(x + (SCREEN_WIDTH - SCALED_WIDTH) / 2, 
-                      pDraw->y * scaleY + (SCREEN_HEIGHT - SCALED_HEIGHT) / 2, 
-                      lineBuffer[srcX]);
-      }
-    }
+  png.getLineAsRGB565(pDraw, srcLine, PNG_RGB565_BIG_ENDIAN, 0xffffffff);
+
+  uint16_t *line = scaledLines[scaledLineIndex];
+  for (int x = 0; x < SCALED_WIDTH; x++) {
+    line[x] = srcLine[scaleX[x]];
+  }
+
+  // 放大时一个源行对应多个目标行
+  while (nextDestRow < SCALED_HEIGHT && scaleY[nextDestRow] == pDraw->y) {
+    pushScaledLine(nextDestRow++, line);
   }
+  scaledLineIndex ^= 1;
 }
 
 // SD卡文件读取函数
@@ -97,7 +209,7 @@ void * PNGOpenFile(const char *filename, int32_t *size) {
   *size = pngFile.size();
   
   if (*size > PNG_BUFFER_SIZE) {
-    Serial.println("PNG文件太大，无法放入缓冲区");
+    // 调用者改为从SD卡流式解码
     pngFile.close();
     return NULL;
   }
@@ -108,86 +220,393 @@ void * PNGOpenFile(const char *filename, int32_t *size) {
   return pngBuffer;
 }
 
-// 显示PNG图片
-bool displayPNG(const char *filename) {
-  Serial.print("显示PNG图片: ");
-  Serial.println(filename);
-  
+// 大于PNG_BUFFER_SIZE的文件直接从SD卡流式解码
+void * PNGStreamOpen(const char *filename, int32_t *size) {
+  pngStreamFile = SD.open(filename, "r");
+  if (!pngStreamFile) {
+    return NULL;
+  }
+  *size = pngStreamFile.size();
+  return &pngStreamFile;
+}
+
+void PNGStreamClose(void *handle) {
+  ((File *)handle)->close();
+}
+
+int32_t PNGStreamRead(PNGFILE *page, uint8_t *buffer, int32_t length) {
+  return ((File *)page->fHandle)->read(buffer, length);
+}
+
+int32_t PNGStreamSeek(PNGFILE *page, int32_t position) {
+  return ((File *)page->fHandle)->seek(position) ? position : -1;
+}
+
+// 解码PNG并按decodeTarget输出，sourceSize返回PNG文件大小
+bool decodePNG(const char *filename, int32_t *sourceSize) {
   int32_t fileSize = 0;
   void *pngData = PNGOpenFile(filename, &fileSize);
+  *sourceSize = fileSize;
   
-  if (!pngData) {
+  int rc;
+  if (pngData) {
+    rc = png.openRAM((uint8_t *)pngData, fileSize, PNGDraw);
+  } else if (fileSize > PNG_BUFFER_SIZE) {
+    rc = png.open(filename, PNGStreamOpen, PNGStreamClose, PNGStreamRead, PNGStreamSeek, PNGDraw);
+  } else {
     return false;
   }
   
-  // 清除屏幕中央区域
-  tft.fillRect((SCREEN_WIDTH - SCALED_WIDTH) / 2, 
-               (SCREEN_HEIGHT - SCALED_HEIGHT) / 2, 
-               SCALED_WIDTH, SCALED_HEIGHT, TFT_BLACK);
-  
-  int rc = png.openRAM((uint8_t *)pngData, fileSize, PNGDraw);
   if (rc != PNG_SUCCESS) {
     Serial.print("打开PNG数据失败: ");
     Serial.println(rc);
     return false;
   }
   
-  Serial.printf("PNG图片大小: %d x %d, 缩放至: %d x %d\n", 
-                png.getWidth(), png.getHeight(), SCALED_WIDTH, SCALED_HEIGHT);
+  if (png.getWidth() > PNG_MAX_SOURCE_WIDTH) {
+    Serial.printf("PNG图片太宽: %d (最大 %d)\n", png.getWidth(), PNG_MAX_SOURCE_WIDTH);
+    png.close();
+    return false;
+  }
   
+  prepareScaleTables(png.getWidth(), png.getHeight());
+  nextDestRow = 0;
+  
+  // SD卡与屏幕共用SPI总线：流式解码时不能一直拉低屏幕CS，每行pushImage自己开关事务，行间让出总线给SD读取
+  bool holdBus = decodeTarget == DECODE_TO_SCREEN && pngData != NULL;
+  decodeUseDMA = holdBus;
+  if (holdBus) {
+    tft.startWrite();
+  }
   rc = png.decode(NULL, 0);
+#if USE_DMA_PUSH
+  if (decodeUseDMA) {
+    tft.dmaWait();
+  }
+#endif
+  if (holdBus) {
+    tft.endWrite();
+  }
   png.close();
   
-  return (rc == PNG_SUCCESS);
-}
-
-// 处理表情命令
-void processExpressionCommand(String command) {
-  command.trim();  // 删除空格
-  
-  int expressionIndex = -1;
-  
-  if (command == "neutral")
-    expressionIndex = 0;
-  else if (command == "smile")
-    expressionIndex = 1;
-  else if (command == "thinking")
-    expressionIndex = 2;
-  else if (command == "sad")
-    expressionIndex = 3;
-  else if (command == "surprised")
-    expressionIndex = 4;
-  else if (command == "happy")
-    expressionIndex = 5;
-  else if (command == "confused")
-    expressionIndex = 6;
-  else
-    Serial.println("未知表情命令: " + command);
-  
-  if (expressionIndex >= 0 && expressionIndex < MAX_IMAGES) {
-    currentImage = expressionIndex;
-    if (displayPNG(imagePaths[currentImage].c_str())) {
-      Serial.println("表情显示成功");
+  return rc == PNG_SUCCESS && nextDestRow == SCALED_HEIGHT;
+}
+
+// 显示PNG图片（不经过缓存）
+bool displayPNG(const char *filename) {
+  Serial.print("显示PNG图片: ");
+  Serial.println(filename);
+  
+  // 每一行都会被完整覆盖，不需要先清屏
+  unsigned long startTime = millis();
+  int32_t sourceSize = 0;
+  decodeTarget = DECODE_TO_SCREEN;
+  bool ok = decodePNG(filename, &sourceSize);
+  
+  Serial.printf("PNG图片 %d 字节, 缩放至: %d x %d, 耗时 %lu ms\n", 
+                sourceSize, SCALED_WIDTH, SCALED_HEIGHT, millis() - startTime);
+  
+  return ok;
+}
+
+String spriteCachePath(int index) {
+  const String &path = imagePaths[index];
+  return String(SPRITE_CACHE_DIR) + path.substring(0, path.length() - 4) + ".565";
+}
+
+bool readSpriteHeader(File &file, SpriteHeader &header) {
+  return file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+         header.magic == SPRITE_MAGIC &&
+         header.width == SCALED_WIDTH && header.height == SCALED_HEIGHT &&
+         file.size() == sizeof(header) + SCALED_WIDTH * SCALED_HEIGHT * sizeof(uint16_t);
+}
+
+// 确保SD卡上的精灵文件存在且与当前PNG一致，否则重新生成
+bool ensureSpriteFile(int index) {
+  File source = SD.open(imagePaths[index].c_str(), "r");
+  if (!source) {
+    return false;
+  }
+  uint32_t sourceSize = source.size();
+  source.close();
+  
+  String cachePath = spriteCachePath(index);
+  File cached = SD.open(cachePath.c_str(), "r");
+  if (cached) {
+    SpriteHeader header;
+    bool valid = readSpriteHeader(cached, header) && header.sourceSize == sourceSize;
+    cached.close();
+    if (valid) {
+      return true;
+    }
+  }
+  
+  decodeFile = SD.open(cachePath.c_str(), "w");
+  if (!decodeFile) {
+    return false;
+  }
+  SpriteHeader header = {SPRITE_MAGIC, SCALED_WIDTH, SCALED_HEIGHT, sourceSize};
+  decodeFile.write((uint8_t *)&header, sizeof(header));
+  
+  int32_t decodedSize = 0;
+  decodeTarget = DECODE_TO_FILE;
+  bool ok = decodePNG(imagePaths[index].c_str(), &decodedSize);
+  decodeTarget = DECODE_TO_SCREEN;
+  decodeFile.close();
+  
+  if (!ok) {
+    SD.remove(cachePath.c_str());
+  }
+  return ok;
+}
+
+// 启动时转换所有表情图片
+void buildSpriteCache() {
+  unsigned long startTime = millis();
+  bool usePsram = psramFound();
+  int cached = 0;
+  
+  for (int i = 0; i < MAX_IMAGES; i++) {
+    if (usePsram) {
+      uint16_t *pixels = (uint16_t *)ps_malloc(SCALED_WIDTH * SCALED_HEIGHT * sizeof(uint16_t));
+      if (pixels) {
+        int32_t sourceSize = 0;
+        decodeTarget = DECODE_TO_MEMORY;
+        decodeMemory = pixels;
+        bool ok = decodePNG(imagePaths[i].c_str(), &sourceSize);
+        decodeTarget = DECODE_TO_SCREEN;
+        if (ok) {
+          spriteCache[i] = pixels;
+          cached++;
+          continue;
+        }
+        free(pixels);
+      }
+    }
+    
+    // 没有PSRAM或PSRAM不足时使用SD卡缓存
+    if (!SD.exists(SPRITE_CACHE_DIR)) {
+      SD.mkdir(SPRITE_CACHE_DIR);
+    }
+    if (ensureSpriteFile(i)) {
+      cached++;
     } else {
-      Serial.println("表情显示失败");
+      Serial.print("表情缓存失败: ");
+      Serial.println(imagePaths[i]);
     }
   }
+  
+  Serial.printf("表情缓存完成: %d/%d (%s), 耗时 %lu ms\n",
+                cached, MAX_IMAGES, usePsram ? "PSRAM" : "SD", millis() - startTime);
 }
 
-// 处理UART命令
-void processCommand(String command) {
-  if (command.startsWith("EXPR:")) {
-    // 提取表情部分
-    String expression = command.substring(5);
-    processExpressionCommand(expression);
+bool blitSpriteFile(int index) {
+  File file = SD.open(spriteCachePath(index).c_str(), "r");
+  if (!file) {
+    return false;
+  }
+  
+  SpriteHeader header;
+  if (!readSpriteHeader(file, header)) {
+    file.close();
+    return false;
+  }
+  
+  for (int y = 0; y < SCALED_HEIGHT; y += SPRITE_BLIT_LINES) {
+    int lines = min(SPRITE_BLIT_LINES, SCALED_HEIGHT - y);
+    size_t bytes = lines * SCALED_WIDTH * sizeof(uint16_t);
+    if (file.read((uint8_t *)blitBuffer, bytes) != bytes) {
+      file.close();
+      return false;
+    }
+    tft.pushImage((SCREEN_WIDTH - SCALED_WIDTH) / 2, y + (SCREEN_HEIGHT - SCALED_HEIGHT) / 2,
+                  SCALED_WIDTH, lines, blitBuffer);
+  }
+  file.close();
+  return true;
+}
+
+// 显示表情：优先使用缓存，缓存不可用时回退到直接解码PNG
+bool displayExpression(int index) {
+  unsigned long startTime = millis();
+  bool ok;
+  const char *source;
+  
+  if (spriteCache[index]) {
+    tft.pushImage((SCREEN_WIDTH - SCALED_WIDTH) / 2, (SCREEN_HEIGHT - SCALED_HEIGHT) / 2,
+                  SCALED_WIDTH, SCALED_HEIGHT, spriteCache[index]);
+    ok = true;
+    source = "PSRAM";
+  } else if (blitSpriteFile(index)) {
+    ok = true;
+    source = "SD缓存";
   } else {
-    Serial.print("未知命令: ");
-    Serial.println(command);
+    return displayPNG(imagePaths[index].c_str());
   }
+  
+  Serial.printf("显示表情 %s (%s), 耗时 %lu ms\n", imagePaths[index].c_str(), source, millis() - startTime);
+  return ok;
 }
 
-// 处理触摸事件
-void handleTouch() {
+// 发送一帧到语音卫星（uart_write_bytes本身是线程安全的）
+void sendFrame(uint8_t type, const uint8_t *payload, uint8_t length) {
+  uint8_t buffer[FRAME_OVERHEAD + FRAME_MAX_PAYLOAD];
+  size_t size = frameEncode(type, txSeq++, payload, length, buffer);
+  uart_write_bytes(UART_PORT, (const char *)buffer, size);
+}
+
+void sendAck(uint8_t seq, uint8_t status) {
+  uint8_t payload[2] = {seq, status};
+  sendFrame(FRAME_ACK, payload, sizeof(payload));
+}
+
+// 切换表情并刷新状态栏
+void showExpression(int index) {
+  xSemaphoreTake(displayMutex, portMAX_DELAY);
+  currentImage = index;
+  if (displayExpression(currentImage)) {
+    Serial.println("表情显示成功");
+  } else {
+    Serial.println("表情显示失败");
+  }
+  drawStatusBar();
+  xSemaphoreGive(displayMutex);
+}
+
+// 处理一帧命令：校验通过后立即回ACK，再执行耗时的重绘
+void handleFrame(const Frame &frame, uint32_t receivedUs) {
+  switch (frame.type) {
+    case FRAME_EXPR: {
+      if (frame.length < 1 || frame.payload[0] >= MAX_IMAGES) {
+        sendAck(frame.seq, FRAME_STATUS_BAD_ARG);
+        return;
+      }
+      sendAck(frame.seq, FRAME_STATUS_OK);
+      uint32_t latency = micros() - receivedUs;
+      if (latency > commandLatencyMaxUs) {
+        commandLatencyMaxUs = latency;
+      }
+      showExpression(frame.payload[0]);
+      break;
+    }
+
+    case FRAME_PING:
+      sendAck(frame.seq, FRAME_STATUS_OK);
+      break;
+
+    default:
+      sendAck(frame.seq, FRAME_STATUS_UNKNOWN);
+      Serial.printf("未知命令帧: 0x%02X\n", frame.type);
+      break;
+  }
+}
+
+void rxRingWrite(const uint8_t *data, size_t length) {
+  uint32_t head = rxHead.load(std::memory_order_relaxed);
+  uint32_t tail = rxTail.load(std::memory_order_acquire);
+  for (size_t i = 0; i < length; i++) {
+    if (head - tail >= RX_RING_SIZE) {
+      rxRingDrops += length - i;
+      break;
+    }
+    rxRing[head++ & (RX_RING_SIZE - 1)] = data[i];
+  }
+  rxHead.store(head, std::memory_order_release);
+}
+
+// UART事件任务：只把驱动缓冲区的数据搬进rxRing，不做任何耗时处理
+void uartEventTask(void *arg) {
+  uint8_t chunk[128];
+  uart_event_t event;
+  
+  for (;;) {
+    if (xQueueReceive(uartEventQueue, &event, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    
+    switch (event.type) {
+      case UART_DATA: {
+        size_t remaining = event.size;
+        while (remaining > 0) {
+          int n = uart_read_bytes(UART_PORT, chunk, min(remaining, sizeof(chunk)), 0);
+          if (n <= 0) {
+            break;
+          }
+          rxRingWrite(chunk, n);
+          remaining -= n;
+        }
+        xTaskNotifyGive(commandTaskHandle);
+        break;
+      }
+      
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        uartOverflows++;
+        uart_flush_input(UART_PORT);
+        xQueueReset(uartEventQueue);
+        break;
+      
+      default:
+        break;
+    }
+  }
+}
+
+// 命令任务：解析rxRing中的帧并执行
+void commandTask(void *arg) {
+  frameParserReset(frameParser);
+  
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t receivedUs = micros();
+    
+    uint32_t head = rxHead.load(std::memory_order_acquire);
+    uint32_t tail = rxTail.load(std::memory_order_relaxed);
+    while (tail != head) {
+      uint8_t byte = rxRing[tail++ & (RX_RING_SIZE - 1)];
+      rxTail.store(tail, std::memory_order_release);
+      if (frameParseByte(frameParser, byte)) {
+        handleFrame(frameParser.frame, receivedUs);
+        head = rxHead.load(std::memory_order_acquire);
+      }
+    }
+  }
+}
+
+bool initCommandLink() {
+  uart_config_t config = {
+    .baud_rate = UART_BAUD,
+    .data_bits = UART_DATA_8_BITS,
+    .parity = UART_PARITY_DISABLE,
+    .stop_bits = UART_STOP_BITS_1,
+    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+    .rx_flow_ctrl_thresh = 0,
+  };
+  
+  displayMutex = xSemaphoreCreateMutex();
+  
+  if (uart_driver_install(UART_PORT, UART_DRIVER_RX_BUFFER, 0, UART_EVENT_QUEUE_LENGTH, &uartEventQueue, 0) != ESP_OK ||
+      uart_param_config(UART_PORT, &config) != ESP_OK ||
+      uart_set_pin(UART_PORT, TX_PIN, RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) {
+    Serial.println("UART初始化失败!");
+    return false;
+  }
+  
+  xTaskCreatePinnedToCore(commandTask, "display_cmd", TASK_STACK_SIZE, NULL,
+                          COMMAND_TASK_PRIORITY, &commandTaskHandle, 1);
+  xTaskCreatePinnedToCore(uartEventTask, "uart_event", TASK_STACK_SIZE, NULL,
+                          UART_TASK_PRIORITY, NULL, 1);
+  return true;
+}
+
+void printLinkStats() {
+  Serial.printf("UART链路: 帧 %u, CRC错误 %u, 长度错误 %u, 环形缓冲丢弃 %u, 溢出 %u, 最大命令延迟 %u us\n",
+                frameParser.frames, frameParser.crcErrors, frameParser.lengthErrors,
+                rxRingDrops, uartOverflows, commandLatencyMaxUs);
+}
+
+// 处理触摸事件，调用者持有displayMutex
+bool handleTouch() {
   uint16_t touchX, touchY;
   uint8_t touchZ;
   
@@ -204,17 +623,15 @@ void handleTouch() {
     
     // 简单的触摸响应 - 切换到下一个图片
     currentImage = (currentImage + 1) % MAX_IMAGES;
-    displayPNG(imagePaths[currentImage].c_str());
+    displayExpression(currentImage);
     
     // 通知主ESP32触摸事件
-    Serial2.print("TOUCH:");
-    Serial2.print(touchX);
-    Serial2.print(",");
-    Serial2.println(touchY);
-    
-    // 防抖动延迟
-    delay(300);
+    uint8_t payload[4] = {(uint8_t)(touchX & 0xFF), (uint8_t)(touchX >> 8),
+                          (uint8_t)(touchY & 0xFF), (uint8_t)(touchY >> 8)};
+    sendFrame(FRAME_TOUCH, payload, sizeof(payload));
+    return true;
   }
+  return false;
 }
 
 // 绘制状态栏
@@ -294,7 +711,6 @@ void printDirectory(File dir, int numTabs) {
 void setup() {
   // 初始化串口通信
   Serial.begin(115200);
-  Serial2.begin(UART_BAUD, SERIAL_8N1, RX_PIN, TX_PIN);
   
   Serial.println("\nESP32表情显示系统启动");
   
@@ -302,6 +718,9 @@ void setup() {
   tft.init();
   tft.setRotation(0); // 竖屏模式
   tft.fillScreen(TFT_BLACK);
+#if USE_DMA_PUSH
+  tft.initDMA();      // PNG逐行DMA推送
+#endif
   
   // 初始化触摸
   uint16_t calData[5] = {275, 3620, 264, 3532, 1};
@@ -323,6 +742,11 @@ void setup() {
     tft.setCursor(20, 270);
     tft.println("SD卡加载失败!");
     delay(3000);
+  } else {
+    // 预解码表情图片
+    tft.setCursor(20, 270);
+    tft.println("正在缓存表情...");
+    buildSpriteCache();
   }
   
   // 绘制界面
@@ -331,53 +755,51 @@ void setup() {
   drawControlBar();
   
   // 显示默认表情
-  displayPNG(imagePaths[currentImage].c_str());
+  displayExpression(currentImage);
+  
+  // 最后启动UART命令任务，之后所有屏幕操作都需要持有displayMutex
+  initCommandLink();
   
   Serial.println("初始化完成，等待命令...");
 }
 
 void loop() {
-  // 处理触摸事件
-  handleTouch();
-  
-  // 接收UART命令
-  while (Serial2.available()) {
-    char c = Serial2.read();
-    if (c == '\n') {
-      // 处理完整命令
-      if (commandBuffer.length() > 0) {
-        Serial.print("收到命令: ");
-        Serial.println(commandBuffer);
-        processCommand(commandBuffer);
-        commandBuffer = "";
-      }
-    } else if (c != '\r') {
-      // 累积命令字符
-      commandBuffer += c;
-    }
+  // UART命令由commandTask处理，这里只负责触摸
+  xSemaphoreTake(displayMutex, portMAX_DELAY);
+  bool touched = handleTouch();
+  xSemaphoreGive(displayMutex);
+  if (touched) {
+    delay(300);  // 防抖动延迟，不持有锁
   }
   
   // 检查底部控制栏的触摸
   uint16_t touchX, touchY;
   uint8_t touchZ;
-  bool touched = tft.getTouch(&touchX, &touchY, &touchZ);
+  xSemaphoreTake(displayMutex, portMAX_DELAY);
+  touched = tft.getTouch(&touchX, &touchY, &touchZ);
+  xSemaphoreGive(displayMutex);
   
   if (touched && touchZ > TOUCH_THRESHOLD) {
     // 检查是否触摸了底部控制栏
     if (touchY > SCREEN_HEIGHT - 40) {
       if (touchX < SCREEN_WIDTH / 2) {
         // 上一个表情
-        currentImage = (currentImage + MAX_IMAGES - 1) % MAX_IMAGES;
+        showExpression((currentImage + MAX_IMAGES - 1) % MAX_IMAGES);
       } else {
         // 下一个表情
-        currentImage = (currentImage + 1) % MAX_IMAGES;
+        showExpression((currentImage + 1) % MAX_IMAGES);
       }
       
-      displayPNG(imagePaths[currentImage].c_str());
-      drawStatusBar(); // 更新状态栏
-      
       // 防抖动延迟
       delay(300);
     }
   }
-}
\ No newline at end of file
+  
+  static unsigned long lastStats = 0;
+  if (millis() - lastStats > 10000) {
+    lastStats = millis();
+    printLinkStats();
+  }
+  
+  delay(20);
+}
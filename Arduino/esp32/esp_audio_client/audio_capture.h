@@ -0,0 +1,149 @@
+// 音频采集：ES8311编解码器 + I2S DMA
+// 采集任务固定在APP核(core 1)，每次i2s_read一帧(20ms)直接写进环形缓冲区的帧槽，并计算VAD特征
+
+// 引脚定义（与ESP32-mini/Basic-PCB-Test-WS2812-Enable一致）
+#define CODEC_ENABLE_PIN  6   // PREP_VCC_CTL = GPIO6
+#define I2C_SCL_PIN       1
+#define I2C_SDA_PIN       2
+#define ES8311_I2C_ADDR   0x18
+
+#define I2S_BCK_PIN       41
+#define I2S_WS_PIN        42
+#define I2S_DATA_OUT_PIN  16
+#define I2S_DATA_IN_PIN   15
+
+// DMA缓冲：每个描述符正好一帧，8帧共160ms，网络短暂卡顿时由DMA和环形缓冲区吸收
+#define I2S_DMA_BUF_COUNT 8
+#define I2S_DMA_BUF_LEN AUDIO_FRAME_SAMPLES
+
+#define CAPTURE_TASK_CORE 1
+#define CAPTURE_TASK_PRIORITY 10
+#define CAPTURE_TASK_STACK 4096
+
+TaskHandle_t g_capture_task = nullptr;
+TaskHandle_t g_capture_consumer = nullptr;  // 每采集一帧通知的任务（网络任务）
+
+// 采集统计
+volatile uint32_t g_frames_captured = 0;
+volatile uint32_t g_frames_overrun = 0;   // 环形缓冲区满而丢弃的帧
+volatile uint32_t g_i2s_read_errors = 0;
+
+bool writeES8311Register(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(ES8311_I2C_ADDR);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+bool initES8311() {
+  struct {
+    uint8_t reg;
+    uint8_t value;
+    const char* desc;
+  } config[] = {
+    {0x45, 0x00, "软复位"},
+    {0x01, 0x30, "时钟管理"},
+    {0x02, 0x10, "模拟配置"},
+    {0x03, 0x10, "MIC偏置"},
+    {0x16, 0x3C, "ADC配置"},
+    {0x17, 0x18, "DAC配置"},
+    {0x09, 0x01, "I2S格式"},
+    {0x0A, 0x01, "I2S配置"},
+    {0x0D, 0x14, "系统配置"},
+    {0x00, 0x80, "芯片启用"},
+  };
+
+  for (size_t i = 0; i < sizeof(config) / sizeof(config[0]); i++) {
+    if (!writeES8311Register(config[i].reg, config[i].value)) {
+      Serial.printf("❌ ES8311 %s失败\n", config[i].desc);
+      return false;
+    }
+    delay(10);
+  }
+  return true;
+}
+
+bool initI2SCapture() {
+  i2s_config_t i2s_config = {
+    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
+    .sample_rate = AUDIO_SAMPLE_RATE,
+    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+    .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+    .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+    .dma_buf_count = I2S_DMA_BUF_COUNT,
+    .dma_buf_len = I2S_DMA_BUF_LEN,
+    .use_apll = false,
+    .tx_desc_auto_clear = true
+  };
+
+  i2s_pin_config_t pin_config = {
+    .bck_io_num = I2S_BCK_PIN,
+    .ws_io_num = I2S_WS_PIN,
+    .data_out_num = I2S_DATA_OUT_PIN,
+    .data_in_num = I2S_DATA_IN_PIN
+  };
+
+  if (i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL) != ESP_OK) {
+    return false;
+  }
+  return i2s_set_pin(I2S_NUM_0, &pin_config) == ESP_OK;
+}
+
+bool initAudioCapture() {
+  pinMode(CODEC_ENABLE_PIN, OUTPUT);
+  digitalWrite(CODEC_ENABLE_PIN, HIGH);  // 打开CODEC_3V3
+  delay(200);
+
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+
+  if (!initES8311()) {
+    return false;
+  }
+  Serial.println("✅ ES8311配置成功");
+
+  if (!initI2SCapture()) {
+    Serial.println("❌ I2S初始化失败");
+    return false;
+  }
+  Serial.printf("✅ I2S初始化成功 (%d Hz, %d x %d samples DMA)\n",
+                AUDIO_SAMPLE_RATE, I2S_DMA_BUF_COUNT, I2S_DMA_BUF_LEN);
+  return true;
+}
+
+// 采集任务：阻塞在i2s_read上，DMA填满一帧才返回，不占用CPU轮询
+void captureTask(void* arg) {
+  static int16_t scratch[AUDIO_FRAME_SAMPLES];  // 环形缓冲区满时把数据读到这里丢弃，保持DMA不溢出
+
+  for (;;) {
+    AudioFrame* frame = ringWriteSlot();
+    int16_t* target = frame ? frame->samples : scratch;
+
+    size_t bytesRead = 0;
+    esp_err_t err = i2s_read(I2S_NUM_0, target, AUDIO_FRAME_SAMPLES * sizeof(int16_t), &bytesRead, portMAX_DELAY);
+    if (err != ESP_OK || bytesRead != AUDIO_FRAME_SAMPLES * sizeof(int16_t)) {
+      g_i2s_read_errors++;
+      continue;
+    }
+
+    if (!frame) {
+      g_frames_overrun++;
+      continue;
+    }
+
+    frame->timestamp_ms = millis();
+    vadAnalyzeFrame(frame);
+    ringCommit();
+    g_frames_captured++;
+
+    if (g_capture_consumer) {
+      xTaskNotifyGive(g_capture_consumer);
+    }
+  }
+}
+
+void startCaptureTask() {
+  ringReset();
+  xTaskCreatePinnedToCore(captureTask, "audio_capture", CAPTURE_TASK_STACK, nullptr,
+                          CAPTURE_TASK_PRIORITY, &g_capture_task, CAPTURE_TASK_CORE);
+}
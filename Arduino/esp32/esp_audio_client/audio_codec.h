@@ -0,0 +1,114 @@
+// 上行音频编码
+// PCM16 = 256 kbit/s，IMA-ADPCM = 4bit/样本，约65 kbit/s，多个卫星同时说话也不会占满2.4GHz链路
+// ADPCM每帧编码成一个独立的块，块头带有编码器状态，服务器可以逐块解码，丢块不影响后续：
+//   [int16 predictor LE][uint8 step_index][uint8 0] + 160字节（320个4bit码，低半字节在前）
+// Opus压缩率更高，但需要额外的libopus组件和约30KB栈，目前先用ADPCM
+
+#define AUDIO_CODEC_PCM16 0
+#define AUDIO_CODEC_ADPCM 1
+
+#define ADPCM_BLOCK_HEADER 4
+#define ADPCM_BLOCK_BYTES (ADPCM_BLOCK_HEADER + AUDIO_FRAME_SAMPLES / 2)  // 164
+
+#if AUDIO_CODEC == AUDIO_CODEC_ADPCM
+#define AUDIO_CODEC_NAME "ima_adpcm"
+#define AUDIO_ENCODED_FRAME_BYTES ADPCM_BLOCK_BYTES
+#else
+#define AUDIO_CODEC_NAME "pcm16"
+#define AUDIO_ENCODED_FRAME_BYTES (AUDIO_FRAME_SAMPLES * sizeof(int16_t))
+#endif
+
+static const int16_t ADPCM_STEP_TABLE[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+  12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t ADPCM_INDEX_TABLE[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+struct AdpcmState {
+  int16_t predictor;
+  uint8_t index;
+};
+
+AdpcmState g_adpcm_state = {0, 0};
+
+// 编码耗时统计
+volatile uint32_t g_encode_frames = 0;
+volatile uint32_t g_encode_us_total = 0;
+volatile uint32_t g_encode_us_max = 0;
+
+void codecReset() {
+  g_adpcm_state.predictor = 0;
+  g_adpcm_state.index = 0;
+}
+
+uint8_t adpcmEncodeSample(AdpcmState& state, int16_t sample) {
+  int step = ADPCM_STEP_TABLE[state.index];
+  int diff = sample - state.predictor;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+
+  // 逐位逼近，同时按解码器的方式重建差值，保证两端预测值一致
+  int delta = step >> 3;
+  if (diff >= step) { code |= 4; diff -= step; delta += step; }
+  step >>= 1;
+  if (diff >= step) { code |= 2; diff -= step; delta += step; }
+  step >>= 1;
+  if (diff >= step) { code |= 1; delta += step; }
+
+  int predictor = state.predictor + ((code & 8) ? -delta : delta);
+  if (predictor > 32767) predictor = 32767;
+  if (predictor < -32768) predictor = -32768;
+  state.predictor = predictor;
+
+  int index = state.index + ADPCM_INDEX_TABLE[code & 7];
+  if (index < 0) index = 0;
+  if (index > 88) index = 88;
+  state.index = index;
+
+  return code;
+}
+
+void adpcmEncodeFrame(AdpcmState& state, const int16_t* samples, uint8_t* out) {
+  out[0] = state.predictor & 0xFF;
+  out[1] = (state.predictor >> 8) & 0xFF;
+  out[2] = state.index;
+  out[3] = 0;
+  out += ADPCM_BLOCK_HEADER;
+
+  for (int i = 0; i < AUDIO_FRAME_SAMPLES; i += 2) {
+    uint8_t low = adpcmEncodeSample(state, samples[i]);
+    uint8_t high = adpcmEncodeSample(state, samples[i + 1]);
+    *out++ = low | (high << 4);
+  }
+}
+
+// 把一帧编码到out，返回写入的字节数
+size_t encodeFrame(const AudioFrame* frame, uint8_t* out) {
+  uint32_t start = micros();
+
+#if AUDIO_CODEC == AUDIO_CODEC_ADPCM
+  adpcmEncodeFrame(g_adpcm_state, frame->samples, out);
+#else
+  memcpy(out, frame->samples, sizeof(frame->samples));
+#endif
+
+  uint32_t elapsed = micros() - start;
+  g_encode_frames++;
+  g_encode_us_total += elapsed;
+  if (elapsed > g_encode_us_max) {
+    g_encode_us_max = elapsed;
+  }
+  return AUDIO_ENCODED_FRAME_BYTES;
+}
+
+uint32_t encodeAverageUs() {
+  return g_encode_frames ? g_encode_us_total / g_encode_frames : 0;
+}
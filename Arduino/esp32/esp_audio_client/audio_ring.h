@@ -0,0 +1,97 @@
+// 单生产者/单消费者(SPSC)无锁音频帧环形缓冲区
+// 采集任务（生产者）直接把i2s_read的数据写进帧槽，网络任务（消费者）从另一个核读取，
+// 两边只各自修改自己的索引，不需要互斥锁
+
+#include <atomic>
+
+#define AUDIO_SAMPLE_RATE 16000
+#define AUDIO_FRAME_MS 20
+#define AUDIO_FRAME_SAMPLES (AUDIO_SAMPLE_RATE * AUDIO_FRAME_MS / 1000)  // 320
+#define AUDIO_RING_FRAMES 32   // 640ms，必须是2的幂
+
+static_assert((AUDIO_RING_FRAMES & (AUDIO_RING_FRAMES - 1)) == 0, "AUDIO_RING_FRAMES必须是2的幂");
+
+struct AudioFrame {
+  uint32_t timestamp_ms;                 // 帧采集完成时的millis()
+  uint16_t level;                        // VAD特征：去直流后的平均幅度
+  uint16_t tilt_q8;                      // VAD特征：差分幅度/幅度 (Q8)，越大高频越多
+  uint8_t zcr;                           // VAD特征：过零次数
+  bool speech;                           // VAD单帧判决
+  int16_t samples[AUDIO_FRAME_SAMPLES];
+};
+
+struct AudioRing {
+  AudioFrame frames[AUDIO_RING_FRAMES];
+  std::atomic<uint32_t> head;  // 只由生产者写：已写入的帧数
+  std::atomic<uint32_t> tail;  // 只由消费者写：已读出的帧数
+};
+
+AudioRing g_audio_ring;
+
+void ringReset() {
+  g_audio_ring.head.store(0);
+  g_audio_ring.tail.store(0);
+}
+
+// ===== 生产者 =====
+
+// 返回可写入的帧槽，缓冲区满时返回nullptr
+AudioFrame* ringWriteSlot() {
+  uint32_t head = g_audio_ring.head.load(std::memory_order_relaxed);
+  uint32_t tail = g_audio_ring.tail.load(std::memory_order_acquire);
+  if (head - tail >= AUDIO_RING_FRAMES) {
+    return nullptr;
+  }
+  return &g_audio_ring.frames[head & (AUDIO_RING_FRAMES - 1)];
+}
+
+void ringCommit() {
+  uint32_t head = g_audio_ring.head.load(std::memory_order_relaxed);
+  g_audio_ring.head.store(head + 1, std::memory_order_release);
+}
+
+// ===== 消费者 =====
+
+// 绝对帧序号：head/tail只增不减，按2^32回绕
+uint32_t ringHead() {
+  return g_audio_ring.head.load(std::memory_order_acquire);
+}
+
+uint32_t ringTail() {
+  return g_audio_ring.tail.load(std::memory_order_relaxed);
+}
+
+// 按绝对序号查看帧，调用者保证 tail <= index < head
+const AudioFrame* ringPeek(uint32_t index) {
+  return &g_audio_ring.frames[index & (AUDIO_RING_FRAMES - 1)];
+}
+
+uint32_t ringAvailable() {
+  uint32_t head = g_audio_ring.head.load(std::memory_order_acquire);
+  uint32_t tail = g_audio_ring.tail.load(std::memory_order_relaxed);
+  return head - tail;
+}
+
+// 返回最旧的未读帧，没有数据时返回nullptr
+const AudioFrame* ringReadSlot() {
+  if (ringAvailable() == 0) {
+    return nullptr;
+  }
+  uint32_t tail = g_audio_ring.tail.load(std::memory_order_relaxed);
+  return &g_audio_ring.frames[tail & (AUDIO_RING_FRAMES - 1)];
+}
+
+void ringRelease(uint32_t count = 1) {
+  uint32_t tail = g_audio_ring.tail.load(std::memory_order_relaxed);
+  g_audio_ring.tail.store(tail + count, std::memory_order_release);
+}
+
+// 丢弃旧帧，只保留最新的keep帧，返回丢弃的帧数
+uint32_t ringDiscardOlderThan(uint32_t keep) {
+  uint32_t available = ringAvailable();
+  if (available <= keep) {
+    return 0;
+  }
+  ringRelease(available - keep);
+  return available - keep;
+}
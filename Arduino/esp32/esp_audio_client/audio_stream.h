@@ -0,0 +1,187 @@
+// 音频上行：网络任务固定在PRO核(core 0，与WiFi协议栈同核)，
+// 由VAD(或按键)决定上传时机，静音期间只在环形缓冲区里保留预录窗口；
+// 从环形缓冲区取帧，按AUDIO_FRAMES_PER_CHUNK打包成WebSocket二进制消息流式发送到STT服务的/ws
+// 协议：
+//   {"type":"start", device_id, location, sample_rate, frame_ms, codec, frame_bytes, trigger}  开始一段语音
+//   二进制消息：整数个编码帧（见audio_codec.h）
+//   {"type":"stop", frames, reason}                                             结束，服务器返回transcript
+
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 5
+#define NETWORK_TASK_STACK 8192
+
+#define AUDIO_FRAMES_PER_CHUNK 2      // 每个二进制消息40ms
+#define STREAM_MAX_MS 30000           // 单段语音的最长时长
+
+WebSocketsClient webSocket;
+
+std::atomic<bool> g_ws_connected(false);
+bool g_ptt_held = false;                      // 只由网络任务读写，来自g_net_queue
+bool g_streaming = false;                     // 只由网络任务读写
+
+uint8_t g_chunk_buffer[AUDIO_FRAMES_PER_CHUNK * AUDIO_ENCODED_FRAME_BYTES];
+
+// 上行统计
+volatile uint32_t g_frames_sent = 0;
+volatile uint32_t g_chunks_sent = 0;
+volatile uint32_t g_send_failures = 0;
+volatile uint32_t g_streams = 0;
+volatile uint32_t g_last_transcript_ms = 0;  // 发送stop到收到transcript的时间
+volatile uint32_t g_frames_suppressed = 0;   // 静音期间丢弃、没有上传的帧
+volatile uint32_t g_last_eos_ms = 0;         // 最后一帧语音到发送stop的时间
+unsigned long g_stream_start_time = 0;
+unsigned long g_stream_stop_time = 0;
+uint32_t g_stream_frames = 0;
+
+bool sendStreamControl(const char* format, ...) {
+  char message[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (length < 0 || length >= (int)sizeof(message)) {
+    return false;
+  }
+  return webSocket.sendTXT(message, length);
+}
+
+void startStream(const char* trigger) {
+  g_streaming = true;
+  g_stream_frames = 0;
+  g_stream_start_time = millis();
+  g_streams++;
+  codecReset();
+  sendStreamControl("{\"type\":\"start\",\"device_id\":\"%s\",\"location\":\"%s\",\"sample_rate\":%d,"
+                    "\"frame_ms\":%d,\"codec\":\"%s\",\"frame_bytes\":%d,\"trigger\":\"%s\"}",
+                    g_device_id, TARGET_ROOM, AUDIO_SAMPLE_RATE, AUDIO_FRAME_MS,
+                    AUDIO_CODEC_NAME, AUDIO_ENCODED_FRAME_BYTES, trigger);
+  Serial.printf("🎙️ 开始流式上传 (%s, 预录%u帧)\n", trigger, ringAvailable());
+  postUiEvent(UI_EVENT_STREAM_STARTED);
+}
+
+void stopStream(const char* reason) {
+  g_streaming = false;
+  g_stream_stop_time = millis();
+  sendStreamControl("{\"type\":\"stop\",\"frames\":%u,\"reason\":\"%s\"}", g_stream_frames, reason);
+  Serial.printf("🛑 结束流式上传 (%s)：%u帧 (%lu ms)\n", reason, g_stream_frames, g_stream_stop_time - g_stream_start_time);
+  postUiEvent(UI_EVENT_STREAM_STOPPED);
+}
+
+// 把VAD已扫描过的帧编码后打包发送；flush为true时不足一个chunk的剩余帧也发出
+void pumpAudio(bool flush) {
+  for (;;) {
+    uint32_t available = g_vad_scan - ringTail();
+    if (available == 0 || (!flush && available < AUDIO_FRAMES_PER_CHUNK)) {
+      return;
+    }
+
+    uint32_t count = available < AUDIO_FRAMES_PER_CHUNK ? available : AUDIO_FRAMES_PER_CHUNK;
+    uint8_t* out = g_chunk_buffer;
+    for (uint32_t i = 0; i < count; i++) {
+      out += encodeFrame(ringReadSlot(), out);
+      ringRelease();
+    }
+
+    if (webSocket.sendBIN(g_chunk_buffer, out - g_chunk_buffer)) {
+      g_frames_sent += count;
+      g_stream_frames += count;
+      g_chunks_sent++;
+    } else {
+      g_send_failures++;
+    }
+  }
+}
+
+void handleServerMessage(uint8_t* payload, size_t length) {
+  StaticJsonDocument<512> doc;
+  if (deserializeJson(doc, (char*)payload, length)) {
+    return;
+  }
+
+  const char* type = doc["type"] | "";
+  if (strcmp(type, "transcript") == 0) {
+    g_last_transcript_ms = millis() - g_stream_stop_time;
+    Serial.printf("📝 识别结果 (stop后 %lu ms): %s\n", (unsigned long)g_last_transcript_ms, doc["text"] | "");
+    postUiEvent(UI_EVENT_TRANSCRIPT);
+  } else if (strcmp(type, "error") == 0) {
+    Serial.printf("❌ STT错误: %s\n", doc["message"] | "");
+    postUiEvent(UI_EVENT_STT_ERROR);
+  }
+}
+
+void webSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
+  switch (type) {
+    case WStype_DISCONNECTED:
+      if (g_ws_connected) {
+        postUiEvent(UI_EVENT_WS_DISCONNECTED);
+      }
+      g_ws_connected = false;
+      g_streaming = false;
+      Serial.println("🔴 Disconnected from STT Service");
+      break;
+
+    case WStype_CONNECTED:
+      g_ws_connected = true;
+      Serial.printf("🟢 Connected to STT Service: %s\n", payload);
+      postUiEvent(UI_EVENT_WS_CONNECTED);
+      break;
+
+    case WStype_TEXT:
+      handleServerMessage(payload, length);
+      break;
+
+    default:
+      break;
+  }
+}
+
+// 网络任务：处理WebSocket，并在每帧采集完成时被唤醒发送音频
+void networkTask(void* arg) {
+  g_capture_consumer = xTaskGetCurrentTaskHandle();
+
+  webSocket.begin(stt_host, stt_port, stt_path);
+  webSocket.onEvent(webSocketEvent);
+  webSocket.setReconnectInterval(5000);
+  webSocket.enableHeartbeat(15000, 3000, 2);
+
+  for (;;) {
+    webSocket.loop();
+
+    // 按键强制上传；VAD检测到语音时自动上传
+    NetCommand command;
+    while (xQueueReceive(g_net_queue, &command, 0) == pdTRUE) {
+      g_ptt_held = command.type == NET_CMD_PTT_DOWN;
+    }
+    bool requested = g_ptt_held;
+    bool speech = vadScan();
+#if !ENABLE_VAD
+    speech = false;
+#endif
+    bool wanted = requested || speech;
+
+    if (wanted && !g_streaming && g_ws_connected) {
+      startStream(requested ? "ptt" : "vad");
+    } else if (g_streaming && (!wanted || millis() - g_stream_start_time >= STREAM_MAX_MS)) {
+      const char* reason = !wanted ? (ENABLE_VAD ? "vad" : "ptt") : "max";
+      pumpAudio(true);
+      stopStream(reason);
+      g_last_eos_ms = g_stream_stop_time - g_vad_speech_end_ms;
+      g_ptt_held = false;  // 超时后需要重新按键
+    }
+
+    if (g_streaming) {
+      pumpAudio(false);
+    } else {
+      // 静音时只保留预录窗口
+      g_frames_suppressed += ringDiscardOlderThan(VAD_PREROLL_FRAMES + VAD_ONSET_FRAMES);
+    }
+
+    // 等待下一帧采集完成，最多10ms，保证WebSocket按时处理
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+  }
+}
+
+void startNetworkTask() {
+  xTaskCreatePinnedToCore(networkTask, "audio_network", NETWORK_TASK_STACK, nullptr,
+                          NETWORK_TASK_PRIORITY, nullptr, NETWORK_TASK_CORE);
+}
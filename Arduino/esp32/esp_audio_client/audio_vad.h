@@ -0,0 +1,124 @@
+// 语音活动检测(VAD)：决定哪些音频需要上传
+// 分两部分：
+//   vadAnalyzeFrame()  在采集任务中对每帧计算定点特征并做单帧判决（噪声底只由采集任务更新）
+//   vadScan()          在网络任务中按顺序扫描新帧，做起始/拖尾判定，给出语音段的开始和结束
+// 单帧判决：幅度明显高于自适应噪声底，且过零率和频谱倾斜落在语音范围内
+//   - 过零率上限排除嘶声等宽带高频噪声
+//   - 倾斜 = Σ|x[n]-x[n-1]| / Σ|x[n]|，白噪声约为1.41(Q8≈362)，浊音明显更低，用来排除敲击声
+
+#define VAD_ENERGY_RATIO_Q4 48        // 幅度 > 噪声底 × 3.0
+#define VAD_MIN_LEVEL 120             // 绝对幅度下限，安静房间里不被噪声底带着走
+#define VAD_ZCR_MIN 4                 // 每帧(20ms)过零次数范围：200Hz ~ 3.75kHz
+#define VAD_ZCR_MAX 150
+#define VAD_TILT_MAX_Q8 300           // 频谱倾斜上限
+
+#define VAD_NOISE_INIT 200            // 初始噪声底
+#define VAD_NOISE_DOWN_SHIFT 3        // 噪声底下降快（1/8）
+#define VAD_NOISE_UP_SHIFT 7          // 噪声底上升慢（1/128）
+#define VAD_NOISE_SPEECH_UP_SHIFT 10  // 语音帧上升更慢（1/1024），连续说话不会被当作底噪，持续的稳态噪声几秒后仍会并入底噪
+
+#define VAD_ONSET_FRAMES 3            // 连续3帧(60ms)语音才开始上传，过滤短促噪声
+#define VAD_HANGOVER_FRAMES 15        // 最后一帧语音后300ms判定结束
+#define VAD_PREROLL_FRAMES 15         // 开始上传时带上之前300ms，避免吞掉首音
+
+static_assert(VAD_PREROLL_FRAMES + VAD_ONSET_FRAMES < AUDIO_RING_FRAMES, "预录帧数超过环形缓冲区");
+
+// ===== 采集任务侧 =====
+
+uint32_t g_vad_noise_q4 = VAD_NOISE_INIT << 4;  // 噪声底 (Q4)
+
+void vadAnalyzeFrame(AudioFrame* frame) {
+  const int16_t* x = frame->samples;
+
+  int32_t sum = 0;
+  for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+    sum += x[i];
+  }
+  int32_t dc = sum / AUDIO_FRAME_SAMPLES;
+
+  uint32_t absSum = 0;
+  uint32_t diffSum = 0;
+  uint8_t crossings = 0;
+  int32_t prev = x[0] - dc;
+  for (int i = 0; i < AUDIO_FRAME_SAMPLES; i++) {
+    int32_t v = x[i] - dc;
+    absSum += v < 0 ? -v : v;
+    int32_t d = v - prev;
+    diffSum += d < 0 ? -d : d;
+    if ((v ^ prev) < 0 && crossings < 255) {
+      crossings++;
+    }
+    prev = v;
+  }
+
+  uint32_t level = absSum / AUDIO_FRAME_SAMPLES;
+  frame->level = level > 0xFFFF ? 0xFFFF : level;
+  frame->zcr = crossings;
+  uint32_t tilt = absSum ? (uint32_t)(((uint64_t)diffSum << 8) / absSum) : 0;
+  frame->tilt_q8 = tilt > 0xFFFF ? 0xFFFF : tilt;
+
+  uint32_t levelQ4 = level << 4;
+  bool loud = level >= VAD_MIN_LEVEL && levelQ4 * 16 > g_vad_noise_q4 * VAD_ENERGY_RATIO_Q4;
+  frame->speech = loud && crossings >= VAD_ZCR_MIN && crossings <= VAD_ZCR_MAX &&
+                  frame->tilt_q8 <= VAD_TILT_MAX_Q8;
+
+  // 噪声底跟踪：向下快、向上慢
+  if (levelQ4 < g_vad_noise_q4) {
+    g_vad_noise_q4 -= (g_vad_noise_q4 - levelQ4) >> VAD_NOISE_DOWN_SHIFT;
+  } else {
+    uint8_t shift = frame->speech ? VAD_NOISE_SPEECH_UP_SHIFT : VAD_NOISE_UP_SHIFT;
+    g_vad_noise_q4 += ((levelQ4 - g_vad_noise_q4) >> shift) + 1;
+  }
+}
+
+// ===== 网络任务侧 =====
+
+bool g_vad_active = false;
+uint32_t g_vad_scan = 0;           // 下一帧待扫描的绝对序号
+uint8_t g_vad_onset = 0;
+uint16_t g_vad_silence = 0;
+uint32_t g_vad_speech_end_ms = 0;  // 最后一帧语音的时间戳，用于统计结束检测的延迟
+
+// VAD统计
+volatile uint32_t g_vad_segments = 0;
+volatile uint32_t g_vad_speech_frames = 0;
+
+// 扫描新提交的帧，返回当前是否处于语音段
+// 检测到结束时立即返回，g_vad_scan停在结束帧之后，之后的帧不属于本段
+bool vadScan() {
+  uint32_t head = ringHead();
+  uint32_t tail = ringTail();
+  if ((int32_t)(g_vad_scan - tail) < 0) {
+    g_vad_scan = tail;  // 未扫描的帧已被丢弃
+  }
+
+  while (g_vad_scan != head) {
+    const AudioFrame* frame = ringPeek(g_vad_scan++);
+
+    if (!g_vad_active) {
+      g_vad_onset = frame->speech ? g_vad_onset + 1 : 0;
+      if (g_vad_onset >= VAD_ONSET_FRAMES) {
+        g_vad_active = true;
+        g_vad_silence = 0;
+        g_vad_segments++;
+        g_vad_speech_end_ms = frame->timestamp_ms;
+      }
+      continue;
+    }
+
+    if (frame->speech) {
+      g_vad_silence = 0;
+      g_vad_speech_frames++;
+      g_vad_speech_end_ms = frame->timestamp_ms;
+    } else if (++g_vad_silence >= VAD_HANGOVER_FRAMES) {
+      g_vad_active = false;
+      g_vad_onset = 0;
+      break;
+    }
+  }
+  return g_vad_active;
+}
+
+uint32_t vadNoiseFloor() {
+  return g_vad_noise_q4 >> 4;
+}
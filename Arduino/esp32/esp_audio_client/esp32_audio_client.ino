@@ -0,0 +1,90 @@
+/*
+ * ESP32-S3 语音卫星固件
+ * 按功能拆分为固定核心的FreeRTOS任务，任务之间只通过队列/环形缓冲区通信：
+ *   audio_capture  core 1, 优先级10  I2S DMA采集 + VAD特征
+ *   satellite_ui   core 1, 优先级2   按键、状态灯、显示屏UART链路
+ *   audio_network  core 0, 优先级5   WebSocket、VAD分段、ADPCM编码上传
+ * 采集任务优先级最高，显示屏重绘和网络重连都不会造成音频丢帧
+ */
+
+#include <WiFi.h>
+#include <Wire.h>
+#include <driver/i2s.h>
+#include <WebSocketsClient.h>
+#include <ArduinoJson.h>
+
+// WiFi配置
+const char* ssid = "CE-Wlan-Helper";
+const char* password = "ThanksDankao";
+
+// STT服务配置
+const char* stt_host = "192.168.8.194";
+const int stt_port = 8000;
+const char* stt_path = "/ws";
+
+// 房间配置
+const char* TARGET_ROOM = "living_room";
+
+// 功能开关
+#define ENABLE_VAD 1                   // 0 = 只用按键说话
+#define AUDIO_CODEC AUDIO_CODEC_ADPCM  // AUDIO_CODEC_PCM16 / AUDIO_CODEC_ADPCM
+#define ENABLE_DISPLAY_LINK 1          // 通过UART控制表情显示屏(esp32_display_touch_sd)
+
+// 引脚
+#define KEY_PIN 0
+#define WS2812_PIN 11
+#define DISPLAY_TX_PIN 17              // 接显示屏控制器RX(GPIO16)，根据接线修改
+#define DISPLAY_RX_PIN 18              // 接显示屏控制器TX(GPIO17)
+#define DISPLAY_UART_BAUD 115200
+
+#define STATS_INTERVAL_MS 5000
+
+char g_device_id[18] = "";
+
+#include "task_queues.h"
+#include <display_protocol.h>
+#include "audio_ring.h"
+#include "audio_vad.h"
+#include "audio_capture.h"
+#include "audio_codec.h"
+#include "audio_stream.h"
+#include "satellite_ui.h"
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("\n============================================================");
+  Serial.println("🎤 ESP32-S3 Voice Satellite");
+  Serial.println("============================================================");
+
+  initTaskQueues();
+  initSatelliteUi();
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(g_device_id, sizeof(g_device_id), "%02X:%02X:%02X:%02X:%02X:%02X",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  if (!initAudioCapture()) {
+    Serial.println("❌ 音频硬件初始化失败");
+    return;
+  }
+
+  // WiFi在后台连接，WebSocket库在连上后自动建立连接
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(ssid, password);
+  Serial.printf("📶 Connecting to: %s\n", ssid);
+
+  startCaptureTask();
+  startNetworkTask();
+  startUiTask();
+
+  Serial.println(ENABLE_VAD ? "✅ Setup complete，直接说话即可" : "✅ Setup complete，按住按键说话");
+}
+
+void loop() {
+  // 所有工作都在任务中完成，删除Arduino的loop任务
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,216 @@
+// UI任务：按键、状态灯、与显示屏控制器的UART链路、统计输出
+// 固定在APP核(core 1)、优先级低于采集任务，显示屏重绘或UART突发不会让I2S读取延误
+// 阻塞在g_ui_queue上等待网络事件，超时即处理周期性工作，不使用delay()
+
+#define UI_TASK_CORE 1
+#define UI_TASK_PRIORITY 2
+#define UI_TASK_STACK 4096
+#define UI_TICK_MS 20
+
+#define THINKING_TIMEOUT_MS 10000     // 等待识别结果的最长时间
+#define RESULT_HOLD_MS 2000           // 识别结果表情保持时间
+
+enum SatelliteState : uint8_t {
+  SAT_OFFLINE,
+  SAT_IDLE,
+  SAT_LISTENING,
+  SAT_THINKING,
+  SAT_RESULT
+};
+
+SatelliteState g_sat_state = SAT_OFFLINE;
+unsigned long g_sat_state_time = 0;
+
+// 显示屏链路（帧格式见display_protocol.h）
+FrameParser g_display_parser;
+uint8_t g_display_seq = 0;
+uint8_t g_display_pending_seq = 0;
+uint32_t g_display_sent_us = 0;
+bool g_display_ack_pending = false;
+volatile uint32_t g_touch_events = 0;
+volatile uint32_t g_display_ack_us = 0;       // 最近一次EXPR命令的往返时间
+volatile uint32_t g_display_nacks = 0;
+
+void sendDisplayExpression(ExpressionId expression) {
+#if ENABLE_DISPLAY_LINK
+  uint8_t frame[FRAME_OVERHEAD + 1];
+  uint8_t payload = expression;
+  size_t length = frameEncode(FRAME_EXPR, g_display_seq, &payload, 1, frame);
+  Serial1.write(frame, length);
+  g_display_pending_seq = g_display_seq++;
+  g_display_sent_us = micros();
+  g_display_ack_pending = true;
+#endif
+}
+
+// 状态灯：arduino-esp32自带的RMT驱动，发送时不需要关中断
+void setStatusLed(uint8_t red, uint8_t green, uint8_t blue) {
+  neopixelWrite(WS2812_PIN, red, green, blue);
+}
+
+void setSatelliteState(SatelliteState state, int expression) {
+  g_sat_state = state;
+  g_sat_state_time = millis();
+
+  switch (state) {
+    case SAT_OFFLINE:   setStatusLed(16, 0, 0);  break;  // 红色
+    case SAT_LISTENING: setStatusLed(0, 0, 24);  break;  // 蓝色
+    case SAT_THINKING:  setStatusLed(16, 8, 0);  break;  // 橙色
+    case SAT_RESULT:    setStatusLed(0, 16, 0);  break;  // 绿色
+    default:            setStatusLed(0, 2, 0);   break;  // 空闲时由呼吸效果接管
+  }
+
+  if (expression >= 0) {
+    sendDisplayExpression((ExpressionId)expression);
+  }
+}
+
+void handleUiEvent(const UiEvent& event) {
+  switch (event.type) {
+    case UI_EVENT_WS_CONNECTED:
+      setSatelliteState(SAT_IDLE, EXPR_NEUTRAL);
+      break;
+
+    case UI_EVENT_WS_DISCONNECTED:
+      setSatelliteState(SAT_OFFLINE, EXPR_SAD);
+      break;
+
+    case UI_EVENT_STREAM_STARTED:
+      setSatelliteState(SAT_LISTENING, EXPR_SURPRISED);
+      break;
+
+    case UI_EVENT_STREAM_STOPPED:
+      setSatelliteState(SAT_THINKING, EXPR_THINKING);
+      break;
+
+    case UI_EVENT_TRANSCRIPT:
+      setSatelliteState(SAT_RESULT, EXPR_SMILE);
+      break;
+
+    case UI_EVENT_STT_ERROR:
+      setSatelliteState(SAT_RESULT, EXPR_CONFUSED);
+      break;
+  }
+}
+
+// 按键去抖：连续两次采样一致才认为状态改变
+void pollKey() {
+  static bool stableState = HIGH;
+  static bool lastSample = HIGH;
+
+  bool sample = digitalRead(KEY_PIN);
+  if (sample == lastSample && sample != stableState) {
+    stableState = sample;
+    postNetCommand(stableState == LOW ? NET_CMD_PTT_DOWN : NET_CMD_PTT_UP);
+  }
+  lastSample = sample;
+}
+
+void handleDisplayFrame(const Frame& frame) {
+  switch (frame.type) {
+    case FRAME_ACK:
+      if (frame.length >= 2 && g_display_ack_pending && frame.payload[0] == g_display_pending_seq) {
+        g_display_ack_pending = false;
+        g_display_ack_us = micros() - g_display_sent_us;
+      }
+      if (frame.length >= 2 && frame.payload[1] != FRAME_STATUS_OK) {
+        g_display_nacks++;
+      }
+      break;
+
+    case FRAME_TOUCH:
+      if (frame.length >= 4) {
+        g_touch_events++;
+        Serial.printf("👆 显示屏触摸 %u,%u\n",
+                      frame.payload[0] | (frame.payload[1] << 8),
+                      frame.payload[2] | (frame.payload[3] << 8));
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void pollDisplayLink() {
+#if ENABLE_DISPLAY_LINK
+  while (Serial1.available()) {
+    if (frameParseByte(g_display_parser, Serial1.read())) {
+      handleDisplayFrame(g_display_parser.frame);
+    }
+  }
+#endif
+}
+
+// 超时回到空闲，空闲时绿色呼吸
+void updateSatelliteState() {
+  unsigned long elapsed = millis() - g_sat_state_time;
+
+  if ((g_sat_state == SAT_THINKING && elapsed >= THINKING_TIMEOUT_MS) ||
+      (g_sat_state == SAT_RESULT && elapsed >= RESULT_HOLD_MS)) {
+    setSatelliteState(SAT_IDLE, EXPR_NEUTRAL);
+    return;
+  }
+
+  if (g_sat_state == SAT_IDLE) {
+    uint8_t step = (elapsed / 100) % 20;
+    uint8_t brightness = step < 10 ? step * 2 : (19 - step) * 2;
+    setStatusLed(0, brightness, 0);
+  }
+}
+
+void printAudioStats() {
+  Serial.printf("📊 captured %u, overrun %u, i2s err %u | sent %u frames / %u chunks, send fail %u | "
+                "encode %s avg %u us / max %u us | streams %u, last transcript %u ms | VAD segments %u, suppressed %u, noise %u, eos %u ms | "
+                "WiFi %s, WS %s | ui drops %u, touches %u, display ack %u us, nack %u, crc err %u | heap %u\n",
+                g_frames_captured, g_frames_overrun, g_i2s_read_errors,
+                g_frames_sent, g_chunks_sent, g_send_failures,
+                AUDIO_CODEC_NAME, encodeAverageUs(), g_encode_us_max,
+                g_streams, g_last_transcript_ms,
+                g_vad_segments, g_frames_suppressed, vadNoiseFloor(), g_last_eos_ms,
+                WiFi.status() == WL_CONNECTED ? "up" : "down",
+                g_ws_connected ? "up" : "down",
+                g_ui_events_dropped, g_touch_events, g_display_ack_us, g_display_nacks,
+                g_display_parser.crcErrors, ESP.getFreeHeap());
+}
+
+void uiTask(void* arg) {
+  unsigned long lastTick = 0;
+  unsigned long lastStats = 0;
+
+  setSatelliteState(SAT_OFFLINE, -1);
+
+  for (;;) {
+    UiEvent event;
+    if (xQueueReceive(g_ui_queue, &event, pdMS_TO_TICKS(UI_TICK_MS)) == pdTRUE) {
+      handleUiEvent(event);
+    }
+
+    unsigned long now = millis();
+    if (now - lastTick >= UI_TICK_MS) {
+      lastTick = now;
+      pollKey();
+      pollDisplayLink();
+      updateSatelliteState();
+    }
+
+    if (now - lastStats >= STATS_INTERVAL_MS) {
+      lastStats = now;
+      printAudioStats();
+    }
+  }
+}
+
+void initSatelliteUi() {
+  pinMode(KEY_PIN, INPUT_PULLUP);
+  setStatusLed(0, 0, 0);
+  frameParserReset(g_display_parser);
+#if ENABLE_DISPLAY_LINK
+  Serial1.begin(DISPLAY_UART_BAUD, SERIAL_8N1, DISPLAY_RX_PIN, DISPLAY_TX_PIN);
+#endif
+}
+
+void startUiTask() {
+  xTaskCreatePinnedToCore(uiTask, "satellite_ui", UI_TASK_STACK, nullptr,
+                          UI_TASK_PRIORITY, nullptr, UI_TASK_CORE);
+}
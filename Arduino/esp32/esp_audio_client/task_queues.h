@@ -0,0 +1,52 @@
+// 任务间通信：各任务只通过队列交换消息，不直接调用对方的函数或共享状态
+//   UI任务 -> 网络任务：g_net_queue（按键按下/松开）
+//   网络任务 -> UI任务：g_ui_queue（连接状态、上传开始/结束、识别结果）
+// 所有发送都是非阻塞的，队列满时丢弃事件，实时任务不会被低优先级任务卡住
+
+#define UI_QUEUE_LENGTH 16
+#define NET_QUEUE_LENGTH 8
+
+enum UiEventType : uint8_t {
+  UI_EVENT_WS_CONNECTED,
+  UI_EVENT_WS_DISCONNECTED,
+  UI_EVENT_STREAM_STARTED,
+  UI_EVENT_STREAM_STOPPED,
+  UI_EVENT_TRANSCRIPT,
+  UI_EVENT_STT_ERROR
+};
+
+struct UiEvent {
+  UiEventType type;
+  uint32_t timestamp_ms;
+};
+
+enum NetCommandType : uint8_t {
+  NET_CMD_PTT_DOWN,
+  NET_CMD_PTT_UP
+};
+
+struct NetCommand {
+  NetCommandType type;
+};
+
+QueueHandle_t g_ui_queue = nullptr;
+QueueHandle_t g_net_queue = nullptr;
+
+volatile uint32_t g_ui_events_dropped = 0;
+
+void initTaskQueues() {
+  g_ui_queue = xQueueCreate(UI_QUEUE_LENGTH, sizeof(UiEvent));
+  g_net_queue = xQueueCreate(NET_QUEUE_LENGTH, sizeof(NetCommand));
+}
+
+void postUiEvent(UiEventType type) {
+  UiEvent event = {type, (uint32_t)millis()};
+  if (xQueueSend(g_ui_queue, &event, 0) != pdTRUE) {
+    g_ui_events_dropped++;
+  }
+}
+
+void postNetCommand(NetCommandType type) {
+  NetCommand command = {type};
+  xQueueSend(g_net_queue, &command, 0);
+}
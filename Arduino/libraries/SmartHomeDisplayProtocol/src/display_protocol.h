@@ -0,0 +1,166 @@
+// 显示屏控制器与语音卫星之间的UART帧协议
+// 显示屏控制器和语音卫星共用（Arduino/libraries/SmartHomeDisplayProtocol）
+//
+// 帧格式：[0xA5][0x5A][type][seq][len][payload 0..64字节][crc16 LE]
+// crc16为CRC-16/CCITT-FALSE，覆盖type..payload；接收端逐字节解析，CRC错误或长度越界时重新找同步头
+
+#define FRAME_SYNC1 0xA5
+#define FRAME_SYNC2 0x5A
+#define FRAME_MAX_PAYLOAD 64
+#define FRAME_HEADER_BYTES 5
+#define FRAME_OVERHEAD (FRAME_HEADER_BYTES + 2)
+
+enum FrameType : uint8_t {
+  FRAME_EXPR  = 0x01,   // 卫星 -> 显示屏：payload[0] = ExpressionId
+  FRAME_PING  = 0x02,   // 卫星 -> 显示屏：链路检测
+  FRAME_ACK   = 0x81,   // 显示屏 -> 卫星：payload = [seq][FrameStatus]
+  FRAME_TOUCH = 0x82    // 显示屏 -> 卫星：payload = [x LE16][y LE16]
+};
+
+enum FrameStatus : uint8_t {
+  FRAME_STATUS_OK = 0,
+  FRAME_STATUS_BAD_ARG = 1,
+  FRAME_STATUS_UNKNOWN = 2
+};
+
+// 表情编号，与显示屏的imagePaths顺序一致
+enum ExpressionId : uint8_t {
+  EXPR_NEUTRAL = 0,
+  EXPR_SMILE,
+  EXPR_THINKING,
+  EXPR_SAD,
+  EXPR_SURPRISED,
+  EXPR_HAPPY,
+  EXPR_CONFUSED,
+  EXPR_COUNT
+};
+
+struct Frame {
+  uint8_t type;
+  uint8_t seq;
+  uint8_t length;
+  uint8_t payload[FRAME_MAX_PAYLOAD];
+};
+
+enum FrameParseState : uint8_t {
+  PARSE_SYNC1,
+  PARSE_SYNC2,
+  PARSE_TYPE,
+  PARSE_SEQ,
+  PARSE_LENGTH,
+  PARSE_PAYLOAD,
+  PARSE_CRC_LOW,
+  PARSE_CRC_HIGH
+};
+
+struct FrameParser {
+  FrameParseState state;
+  Frame frame;
+  uint8_t index;
+  uint16_t crc;
+  uint16_t receivedCrc;
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t lengthErrors;
+};
+
+uint16_t crc16Update(uint16_t crc, uint8_t byte) {
+  crc ^= (uint16_t)byte << 8;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// 编码一帧到out（至少FRAME_OVERHEAD + length字节），返回帧长度
+size_t frameEncode(uint8_t type, uint8_t seq, const uint8_t* payload, uint8_t length, uint8_t* out) {
+  if (length > FRAME_MAX_PAYLOAD) {
+    return 0;
+  }
+
+  out[0] = FRAME_SYNC1;
+  out[1] = FRAME_SYNC2;
+  out[2] = type;
+  out[3] = seq;
+  out[4] = length;
+  memcpy(out + FRAME_HEADER_BYTES, payload, length);
+
+  uint16_t crc = 0xFFFF;
+  size_t end = FRAME_HEADER_BYTES + length;
+  for (size_t i = 2; i < end; i++) {
+    crc = crc16Update(crc, out[i]);
+  }
+  out[FRAME_HEADER_BYTES + length] = crc & 0xFF;
+  out[FRAME_HEADER_BYTES + length + 1] = crc >> 8;
+  return FRAME_OVERHEAD + length;
+}
+
+void frameParserReset(FrameParser& parser) {
+  memset(&parser, 0, sizeof(parser));
+  parser.state = PARSE_SYNC1;
+}
+
+// 输入一个字节，收到一帧完整且CRC正确的帧时返回true，帧内容在parser.frame中
+bool frameParseByte(FrameParser& parser, uint8_t byte) {
+  switch (parser.state) {
+    case PARSE_SYNC1:
+      if (byte == FRAME_SYNC1) {
+        parser.state = PARSE_SYNC2;
+      }
+      return false;
+
+    case PARSE_SYNC2:
+      parser.state = byte == FRAME_SYNC2 ? PARSE_TYPE : (byte == FRAME_SYNC1 ? PARSE_SYNC2 : PARSE_SYNC1);
+      parser.crc = 0xFFFF;
+      return false;
+
+    case PARSE_TYPE:
+      parser.frame.type = byte;
+      parser.crc = crc16Update(parser.crc, byte);
+      parser.state = PARSE_SEQ;
+      return false;
+
+    case PARSE_SEQ:
+      parser.frame.seq = byte;
+      parser.crc = crc16Update(parser.crc, byte);
+      parser.state = PARSE_LENGTH;
+      return false;
+
+    case PARSE_LENGTH:
+      if (byte > FRAME_MAX_PAYLOAD) {
+        parser.lengthErrors++;
+        parser.state = PARSE_SYNC1;
+        return false;
+      }
+      parser.frame.length = byte;
+      parser.crc = crc16Update(parser.crc, byte);
+      parser.index = 0;
+      parser.state = byte ? PARSE_PAYLOAD : PARSE_CRC_LOW;
+      return false;
+
+    case PARSE_PAYLOAD:
+      parser.frame.payload[parser.index++] = byte;
+      parser.crc = crc16Update(parser.crc, byte);
+      if (parser.index >= parser.frame.length) {
+        parser.state = PARSE_CRC_LOW;
+      }
+      return false;
+
+    case PARSE_CRC_LOW:
+      parser.receivedCrc = byte;
+      parser.state = PARSE_CRC_HIGH;
+      return false;
+
+    case PARSE_CRC_HIGH:
+      parser.receivedCrc |= (uint16_t)byte << 8;
+      parser.state = PARSE_SYNC1;
+      if (parser.receivedCrc != parser.crc) {
+        parser.crcErrors++;
+        return false;
+      }
+      parser.frames++;
+      return true;
+  }
+  parser.state = PARSE_SYNC1;
+  return false;
+}
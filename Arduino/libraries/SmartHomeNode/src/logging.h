@@ -0,0 +1,48 @@
+// 编译期日志级别
+// 传感器节点和家具节点共用（Arduino/libraries/SmartHomeNode）
+//
+// 低于LOG_LEVEL的日志在编译期整体去掉：格式化、串口阻塞和字符串常量都不进入固件，
+// 参数仍参与类型检查，只在日志里用到的变量不会产生unused警告。
+// 保留的日志格式串用PSTR放在Flash中，不占用RAM。
+// 115200波特率下每输出一行约阻塞1ms，采样、上传、收帧等每个周期都会执行的路径使用LOG_DEBUG。
+//
+// 在include之前定义LOG_LEVEL即可覆盖默认级别，发布版本建议LOG_LEVEL_WARN
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_ENABLED(level) (LOG_LEVEL >= (level))
+
+#define LOG_PRINT(format, ...) Serial.printf_P(PSTR(format), ##__VA_ARGS__)
+#define LOG_DISCARD(format, ...) do { if (false) Serial.printf(format, ##__VA_ARGS__); } while (0)
+
+#if LOG_ENABLED(LOG_LEVEL_ERROR)
+#define LOG_ERROR(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) LOG_DISCARD(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_WARN)
+#define LOG_WARN(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) LOG_DISCARD(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_INFO)
+#define LOG_INFO(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) LOG_DISCARD(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
+#define LOG_DEBUG(format, ...) LOG_PRINT(format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) LOG_DISCARD(format, ##__VA_ARGS__)
+#endif
@@ -0,0 +1,208 @@
+// 固件遥测：loop()单次耗时直方图、各通道（I2C传感器、LED输出等）的耗时与错误、堆、重连与发送失败
+// 传感器节点和家具节点共用（Arduino/libraries/SmartHomeNode）
+//
+// 统计只做整数累加，每次loop()开销为两次micros()和一次查表；
+// 每TELEMETRY_INTERVAL_MS打包成一帧紧凑JSON发给IoT服务，发送后清零窗口内的直方图、最大值和通道统计，
+// 重连次数和发送计数为开机累计值
+
+#define TELEMETRY_INTERVAL_MS 60000
+#define TELEMETRY_MAX_CHANNELS 6
+#define TELEMETRY_BUCKETS 8
+
+// loop()耗时直方图各桶上界(us)，最后一个桶为溢出；IoT服务按同样的边界解释hist
+static const uint32_t TELEMETRY_BUCKET_US[TELEMETRY_BUCKETS - 1] = {
+  500, 1000, 2000, 5000, 10000, 50000, 100000
+};
+
+struct TelemetryChannel {
+  const char* name;
+  uint32_t count;
+  uint32_t errors;
+  uint32_t total_us;
+  uint32_t max_us;
+  uint32_t pending;   // 异步测量未完成的轮询次数，不计入count和耗时
+};
+
+struct Telemetry {
+  // 当前窗口
+  uint32_t loop_hist[TELEMETRY_BUCKETS];
+  uint32_t loop_count;
+  uint32_t loop_max_us;
+  uint32_t loop_begin_us;
+  uint32_t min_free_heap;
+  unsigned long window_start;
+  TelemetryChannel channels[TELEMETRY_MAX_CHANNELS];
+  uint8_t channel_count;
+  // 开机累计
+  uint32_t ws_sends;
+  uint32_t ws_send_failures;
+  uint32_t ws_disconnects;
+  uint32_t wifi_reconnects;
+};
+
+Telemetry g_telemetry;
+
+void telemetryResetWindow() {
+  memset(g_telemetry.loop_hist, 0, sizeof(g_telemetry.loop_hist));
+  g_telemetry.loop_count = 0;
+  g_telemetry.loop_max_us = 0;
+  g_telemetry.min_free_heap = ESP.getFreeHeap();
+  g_telemetry.window_start = millis();
+  for (uint8_t i = 0; i < g_telemetry.channel_count; i++) {
+    TelemetryChannel& channel = g_telemetry.channels[i];
+    channel.count = 0;
+    channel.errors = 0;
+    channel.total_us = 0;
+    channel.max_us = 0;
+    channel.pending = 0;
+  }
+}
+
+void initTelemetry() {
+  memset(&g_telemetry, 0, sizeof(g_telemetry));
+  telemetryResetWindow();
+}
+
+// 注册一个计时通道，返回通道号；通道已满时返回-1，之后对它的记录会被忽略
+int8_t telemetryAddChannel(const char* name) {
+  if (g_telemetry.channel_count >= TELEMETRY_MAX_CHANNELS) {
+    return -1;
+  }
+  TelemetryChannel& channel = g_telemetry.channels[g_telemetry.channel_count];
+  memset(&channel, 0, sizeof(channel));
+  channel.name = name;
+  return g_telemetry.channel_count++;
+}
+
+void telemetryRecord(int8_t channel, uint32_t elapsed_us, bool ok) {
+  if (channel < 0 || channel >= g_telemetry.channel_count) {
+    return;
+  }
+  TelemetryChannel& c = g_telemetry.channels[channel];
+  c.count++;
+  c.total_us += elapsed_us;
+  if (elapsed_us > c.max_us) {
+    c.max_us = elapsed_us;
+  }
+  if (!ok) {
+    c.errors++;
+  }
+}
+
+// 记录一次未完成的轮询（传感器还在测量），只计数，不算作一次事务
+void telemetryRecordPending(int8_t channel) {
+  if (channel < 0 || channel >= g_telemetry.channel_count) {
+    return;
+  }
+  g_telemetry.channels[channel].pending++;
+}
+
+void telemetryLoopBegin() {
+  g_telemetry.loop_begin_us = micros();
+}
+
+// 在loop()的每个出口（delay之前）调用，有意的delay不计入
+void telemetryLoopEnd() {
+  uint32_t elapsed = micros() - g_telemetry.loop_begin_us;
+  uint8_t bucket = 0;
+  while (bucket < TELEMETRY_BUCKETS - 1 && elapsed >= TELEMETRY_BUCKET_US[bucket]) {
+    bucket++;
+  }
+  g_telemetry.loop_hist[bucket]++;
+  g_telemetry.loop_count++;
+  if (elapsed > g_telemetry.loop_max_us) {
+    g_telemetry.loop_max_us = elapsed;
+  }
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < g_telemetry.min_free_heap) {
+    g_telemetry.min_free_heap = freeHeap;
+  }
+}
+
+// 记录一次WebSocket发送结果，原样返回，可直接包住sendTXT/sendBIN
+bool telemetryWsSend(bool ok) {
+  g_telemetry.ws_sends++;
+  if (!ok) {
+    g_telemetry.ws_send_failures++;
+  }
+  return ok;
+}
+
+// 上行帧缓冲区：前WEBSOCKETS_MAX_HEADER_SIZE字节留给帧头，负载从WS_FRAME_PAYLOAD()开始写
+// 用headerToPayload方式发送时库直接把帧头写在负载前面，否则每个小于1400字节的帧都会malloc一块头部+负载的缓冲区
+// 客户端帧的掩码在缓冲区上原地计算，发送之后负载内容不再可读
+#define WS_FRAME_BUFFER_SIZE(payload) (WEBSOCKETS_MAX_HEADER_SIZE + (payload))
+#define WS_FRAME_PAYLOAD(frame) ((char*)(frame) + WEBSOCKETS_MAX_HEADER_SIZE)
+
+// 发送frame中length字节的负载（不产生堆分配）并记录结果
+bool telemetryWsSendFrame(WebSocketsClient& ws, uint8_t* frame, size_t length, bool binary = false) {
+  return telemetryWsSend(binary ? ws.sendBIN(frame, length, true) : ws.sendTXT(frame, length, true));
+}
+
+void telemetryWsDisconnect() {
+  g_telemetry.ws_disconnects++;
+}
+
+void telemetryWiFiReconnect() {
+  g_telemetry.wifi_reconnects++;
+}
+
+bool telemetryDue() {
+  return millis() - g_telemetry.window_start >= TELEMETRY_INTERVAL_MS;
+}
+
+static bool telemetryAppend(char* out, size_t size, size_t& length, const char* format, ...) {
+  if (length >= size) {
+    return false;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(out + length, size - length, format, args);
+  va_end(args);
+  if (n < 0 || (size_t)n >= size - length) {
+    length = size;
+    return false;
+  }
+  length += n;
+  return true;
+}
+
+// 把当前窗口写成一帧JSON，返回长度；缓冲区不够时返回0
+// 通道格式为 "name":[count,errors,avg_us,max_us,pending]
+size_t telemetryFormat(char* out, size_t size, const char* deviceId, const char* location) {
+  size_t length = 0;
+  unsigned long now = millis();
+
+  telemetryAppend(out, size, length,
+                  "{\"type\":\"telemetry\",\"device_id\":\"%s\",\"location\":\"%s\",\"uptime_s\":%lu,\"window_ms\":%lu,",
+                  deviceId, location, now / 1000, now - g_telemetry.window_start);
+
+  telemetryAppend(out, size, length, "\"loop\":{\"n\":%u,\"max_us\":%u,\"hist\":[",
+                  g_telemetry.loop_count, g_telemetry.loop_max_us);
+  for (uint8_t i = 0; i < TELEMETRY_BUCKETS; i++) {
+    telemetryAppend(out, size, length, i ? ",%u" : "%u", g_telemetry.loop_hist[i]);
+  }
+
+  telemetryAppend(out, size, length,
+                  "]},\"heap\":{\"free\":%u,\"min_free\":%u,\"max_block\":%u,\"frag\":%u},",
+                  ESP.getFreeHeap(), g_telemetry.min_free_heap,
+                  ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation());
+
+  telemetryAppend(out, size, length,
+                  "\"rssi\":%d,\"wifi_reconnects\":%u,\"ws_disconnects\":%u,\"ws_sends\":%u,\"ws_send_failures\":%u,\"channels\":{",
+                  WiFi.RSSI(), g_telemetry.wifi_reconnects, g_telemetry.ws_disconnects,
+                  g_telemetry.ws_sends, g_telemetry.ws_send_failures);
+
+  for (uint8_t i = 0; i < g_telemetry.channel_count; i++) {
+    const TelemetryChannel& c = g_telemetry.channels[i];
+    telemetryAppend(out, size, length, "%s\"%s\":[%u,%u,%u,%u,%u]",
+                    i ? "," : "", c.name, c.count, c.errors,
+                    c.count ? c.total_us / c.count : 0, c.max_us, c.pending);
+  }
+
+  if (!telemetryAppend(out, size, length, "}}")) {
+    return 0;
+  }
+  return length;
+}
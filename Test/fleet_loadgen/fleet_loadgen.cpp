@@ -0,0 +1,964 @@
+// Fleet load generator for the IoT service WebSocket endpoint (/ws).
+//
+// Simulates many sensor nodes over one epoll loop. Each node speaks the same protocol as
+// Arduino/Basic_Sensor_Data_Upload_Real_for_Single_room/network.h:
+//   - connect, wait for "init", send "subscribe" for its own room (device_update only)
+//   - periodic uploads: a v2 binary sensor frame (binary_frame.h) once init.capabilities offers
+//     binary_sensor_frame 2 and lists the node's room, otherwise a "control" frame with one
+//     sensors/data_update command; both carry window stats. --json forces the JSON format
+//   - application "ping" (with heap/RSSI fields) when the link has been idle for --ping-idle seconds
+// JSON uploads are answered with "control_results", matched to the upload by the echoed
+// parameters.timestamp. Binary frames get no reply, so binary nodes also send a "ping" every
+// --probe seconds and the ping round trip stands in for the upload latency.
+//
+// Build:  cmake -S Test/fleet_loadgen -B build/fleet_loadgen && cmake --build build/fleet_loadgen
+// Run:    build/fleet_loadgen/fleet_loadgen --host 127.0.0.1 --port 8002 --nodes 200 --rate 1 --duration 60
+//
+// Output: one progress line per --report-interval, then a single key=value LOADGEN_SUMMARY line
+// so runs can be compared by script.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "websocket.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int RECONNECT_DELAY_MS = 10000;       // webSocket.setReconnectInterval() in the firmware
+constexpr int FIRST_UPLOAD_MAX_WAIT_MS = 500;   // WS_FIRST_UPLOAD_MAX_WAIT_MS
+constexpr int HANDSHAKE_TIMEOUT_MS = 10000;
+constexpr int EPOLL_TICK_MS = 2;
+constexpr size_t READ_CHUNK = 16384;
+constexpr int SENSOR_FRAME_VERSION = 2;         // binary_frame.h
+constexpr int SAMPLE_FIELD_COUNT = 6;
+
+const char* const SAMPLE_FIELD_NAMES[SAMPLE_FIELD_COUNT] = {
+    "temperature", "humidity", "co2", "voc", "light_level", "motion"
+};
+// SAMPLE_FIELD_SCALE in sample_buffer.h: fixed-point units of the binary frame
+const double SAMPLE_FIELD_SCALE[SAMPLE_FIELD_COUNT] = {100.0, 100.0, 1.0, 1.0, 0.5, 1.0};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8002;
+    std::string path = "/ws";
+    int nodes = 100;
+    double rate = 1.0;             // uploads per node per second
+    double duration = 60.0;        // seconds, after the ramp
+    double ramp = 5.0;             // seconds over which nodes connect
+    double pingIdle = 60.0;        // APP_PING_IDLE_MS
+    double timeout = 10.0;         // seconds before an unanswered upload counts as a timeout
+    double reportInterval = 5.0;
+    std::vector<std::string> rooms = {"living_room", "bedroom", "kitchen", "study", "bathroom"};
+    bool subscribe = true;
+    bool stats = true;
+    bool json = false;             // force JSON uploads even when the service offers binary frames
+    double probe = 5.0;            // ping interval of binary nodes, whose uploads get no reply; 0 = never
+    uint32_t seed = 1;
+};
+
+enum NodeState {
+    NODE_IDLE,
+    NODE_CONNECTING,
+    NODE_HANDSHAKE,
+    NODE_OPEN
+};
+
+struct Node {
+    int index = 0;
+    int fd = -1;
+    NodeState state = NODE_IDLE;
+    std::string room;
+    char deviceId[18] = "";
+    uint32_t rng = 1;
+
+    std::string inbound;
+    std::string outbound;
+    std::string message;           // reassembly of fragmented text frames
+    bool wantWrite = false;
+
+    Clock::time_point connectStarted;
+    Clock::time_point reconnectAt;
+    Clock::time_point nextUpload;
+    Clock::time_point lastTx;
+    bool initReceived = false;
+    bool firstUploadDone = false;
+
+    int binaryRoomId = -1;         // index into init.capabilities.rooms, -1 = JSON uploads
+    uint16_t frameSeq = 0;
+    uint64_t lastUploadId = 0;
+    Clock::time_point lastProbe;
+
+    // JSON uploads awaiting control_results, keyed by the parameters.timestamp they carry
+    std::map<uint64_t, Clock::time_point> pendingUploads;
+    std::deque<Clock::time_point> pendingPings;
+
+    // random-walked readings
+    double temperature = 23.5;
+    double humidity = 55.0;
+    int co2 = 420;
+    int voc = 15;
+    int lightLevel = 300;
+};
+
+struct Stats {
+    uint64_t uploads = 0;
+    uint64_t binaryUploads = 0;
+    uint64_t results = 0;
+    uint64_t resultErrors = 0;
+    uint64_t timeouts = 0;
+    uint64_t lost = 0;
+    uint64_t pings = 0;
+    uint64_t pongs = 0;
+    uint64_t rxFrames = 0;
+    uint64_t rxBytes = 0;
+    uint64_t txBytes = 0;
+    uint64_t connects = 0;
+    uint64_t connectFailures = 0;
+    uint64_t disconnects = 0;
+    std::vector<uint32_t> resultUs;
+    std::vector<uint32_t> pingUs;
+    std::vector<uint32_t> connectUs;
+    std::map<std::string, uint64_t> rxByType;
+
+    void reset() { *this = Stats(); }
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+Options g_options;
+sockaddr_storage g_address;
+socklen_t g_addressLength = 0;
+int g_epoll = -1;
+std::vector<Node> g_nodes;
+Stats g_window;
+Stats g_total;
+
+void onSignal(int) {
+    g_stop = 1;
+}
+
+uint32_t elapsedUs(Clock::time_point from, Clock::time_point to) {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+Clock::time_point after(Clock::time_point base, double seconds) {
+    return base + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+double uniform(uint32_t& rng) {
+    return (ws::nextRandom(rng) & 0xFFFFFF) / double(0x1000000);
+}
+
+double percentileMs(std::vector<uint32_t> samples, double fraction) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t k = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k] / 1000.0;
+}
+
+double maxMs(const std::vector<uint32_t>& samples) {
+    return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end()) / 1000.0;
+}
+
+void record(uint64_t Stats::*counter, uint64_t amount = 1) {
+    g_window.*counter += amount;
+    g_total.*counter += amount;
+}
+
+void recordSample(std::vector<uint32_t> Stats::*samples, uint32_t value) {
+    (g_window.*samples).push_back(value);
+    (g_total.*samples).push_back(value);
+}
+
+// Value of the top-level "type" field; tolerant of both compact and spaced json.dumps output
+std::string messageType(const std::string& text) {
+    size_t key = text.find("\"type\"");
+    if (key == std::string::npos) {
+        return "";
+    }
+    size_t quote = text.find('"', text.find(':', key + 6) + 1);
+    if (quote == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find('"', quote + 1);
+    return end == std::string::npos ? "" : text.substr(quote + 1, end - quote - 1);
+}
+
+// Unsigned integer value of the first "key" at or after from
+bool findUnsigned(const std::string& text, const char* key, size_t from, uint64_t& value) {
+    size_t pos = text.find(key, from);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = text.find(':', pos + strlen(key));
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = text.find_first_not_of(" ", pos + 1);
+    if (pos == std::string::npos || text[pos] < '0' || text[pos] > '9') {
+        return false;
+    }
+    value = strtoull(text.c_str() + pos, nullptr, 10);
+    return true;
+}
+
+// Same rule as negotiateBinaryFrames() in network.h: binary uploads only when the service
+// speaks our frame version and lists this node's room
+int negotiateRoomId(const std::string& text, const std::string& room) {
+    size_t capabilities = text.find("\"capabilities\"");
+    uint64_t version = 0;
+    if (capabilities == std::string::npos ||
+        !findUnsigned(text, "\"binary_sensor_frame\"", capabilities, version) ||
+        version != SENSOR_FRAME_VERSION) {
+        return -1;
+    }
+    size_t rooms = text.find("\"rooms\"", capabilities);
+    size_t open = rooms == std::string::npos ? rooms : text.find('[', rooms);
+    size_t close = open == std::string::npos ? open : text.find(']', open);
+    if (close == std::string::npos) {
+        return -1;
+    }
+    int index = 0;
+    for (size_t quote = text.find('"', open); quote < close; quote = text.find('"', quote + 1)) {
+        size_t end = text.find('"', quote + 1);
+        if (end == std::string::npos || end > close) {
+            break;
+        }
+        if (text.compare(quote + 1, end - quote - 1, room) == 0) {
+            return index;
+        }
+        index++;
+        quote = end;
+    }
+    return -1;
+}
+
+void updateEpoll(Node& node, bool wantWrite) {
+    if (node.wantWrite == wantWrite) {
+        return;
+    }
+    node.wantWrite = wantWrite;
+    epoll_event event{};
+    event.events = EPOLLIN | (wantWrite ? uint32_t(EPOLLOUT) : 0u);
+    event.data.u32 = node.index;
+    epoll_ctl(g_epoll, EPOLL_CTL_MOD, node.fd, &event);
+}
+
+void closeNode(Node& node, Clock::time_point now, bool failure) {
+    if (node.fd >= 0) {
+        close(node.fd);
+    }
+    if (node.state == NODE_OPEN) {
+        record(&Stats::disconnects);
+    } else if (failure) {
+        record(&Stats::connectFailures);
+    }
+    record(&Stats::lost, node.pendingUploads.size());
+
+    node.fd = -1;
+    node.state = NODE_IDLE;
+    node.inbound.clear();
+    node.outbound.clear();
+    node.message.clear();
+    node.wantWrite = false;
+    node.pendingUploads.clear();
+    node.pendingPings.clear();
+    node.binaryRoomId = -1;  // renegotiated from the next init
+    node.reconnectAt = now + std::chrono::milliseconds(RECONNECT_DELAY_MS);
+}
+
+void flush(Node& node, Clock::time_point now) {
+    while (!node.outbound.empty()) {
+        ssize_t n = send(node.fd, node.outbound.data(), node.outbound.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            record(&Stats::txBytes, n);
+            node.outbound.erase(0, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        closeNode(node, now, true);
+        return;
+    }
+    updateEpoll(node, !node.outbound.empty());
+}
+
+void sendFrame(Node& node, ws::Opcode opcode, const char* data, size_t length, Clock::time_point now) {
+    ws::appendFrame(node.outbound, opcode, data, length, node.rng);
+    node.lastTx = now;
+    flush(node, now);
+}
+
+void sendText(Node& node, const char* text, size_t length, Clock::time_point now) {
+    sendFrame(node, ws::OP_TEXT, text, length, now);
+}
+
+void startConnect(Node& node, Clock::time_point now) {
+    int fd = socket(g_address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        record(&Stats::connectFailures);
+        node.reconnectAt = now + std::chrono::milliseconds(RECONNECT_DELAY_MS);
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    node.fd = fd;
+    node.state = NODE_CONNECTING;
+    node.connectStarted = now;
+    node.initReceived = false;
+    node.firstUploadDone = false;
+    node.lastProbe = now;
+    node.wantWrite = true;
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.u32 = node.index;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, fd, &event);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&g_address), g_addressLength) < 0 && errno != EINPROGRESS) {
+        closeNode(node, now, true);
+    }
+}
+
+// ===== Firmware messages =====
+
+void sendSubscribe(Node& node, Clock::time_point now) {
+    char text[192];
+    int length = snprintf(text, sizeof(text),
+                          "{\"type\":\"subscribe\",\"device_id\":\"%s\",\"rooms\":[\"%s\"],\"types\":[\"device_update\"]}",
+                          node.deviceId, node.room.c_str());
+    sendText(node, text, length, now);
+}
+
+void stepReadings(Node& node) {
+    node.temperature = std::clamp(node.temperature + (uniform(node.rng) - 0.5) * 0.2, 18.0, 30.0);
+    node.humidity = std::clamp(node.humidity + (uniform(node.rng) - 0.5) * 1.0, 30.0, 80.0);
+    node.co2 = std::clamp(node.co2 + static_cast<int>(ws::nextRandom(node.rng) % 21) - 10, 380, 2000);
+    node.voc = std::clamp(node.voc + static_cast<int>(ws::nextRandom(node.rng) % 5) - 2, 0, 500);
+    node.lightLevel = std::clamp(node.lightLevel + static_cast<int>(ws::nextRandom(node.rng) % 41) - 20, 0, 2000);
+}
+
+// Window stats both formats report: readings +/- a fixed spread over 30 samples
+constexpr unsigned STATS_COUNT = 30;
+constexpr unsigned long STATS_SPAN_MS = 29000;
+const double STATS_SPREAD[SAMPLE_FIELD_COUNT] = {0.2, 0.8, 15.0, 3.0, 25.0, 0.0};
+
+void fieldValues(const Node& node, bool motion, double values[SAMPLE_FIELD_COUNT]) {
+    values[0] = node.temperature;
+    values[1] = node.humidity;
+    values[2] = node.co2;
+    values[3] = node.voc;
+    values[4] = node.lightLevel;
+    values[5] = motion ? 1.0 : 0.0;
+}
+
+double statsLow(int field, const double values[]) {
+    return field == 5 ? 0.0 : values[field] - STATS_SPREAD[field];
+}
+
+double statsHigh(int field, const double values[], bool motion) {
+    return field == 5 ? (motion ? 1.0 : 0.0) : values[field] + STATS_SPREAD[field];
+}
+
+// toFixedSample() in sample_buffer.h
+int32_t toFixed(int field, double value) {
+    double scaled = value * SAMPLE_FIELD_SCALE[field];
+    double lo = field == 0 ? -32768.0 : 0.0;
+    double hi = field == 0 ? 32767.0 : 65535.0;
+    scaled = std::clamp(scaled, lo, hi);
+    return static_cast<int32_t>(scaled >= 0 ? scaled + 0.5 : scaled - 0.5);
+}
+
+void putLe(std::string& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// SensorFrame + stats_bitmap + FrameFieldStats per field, as sendSensorData() builds it in network.h
+void sendBinaryUpload(Node& node, Clock::time_point now, uint64_t uptimeMs, bool motion) {
+    double values[SAMPLE_FIELD_COUNT];
+    fieldValues(node, motion, values);
+
+    std::string frame;
+    frame.reserve(26 + 1 + SAMPLE_FIELD_COUNT * 15);
+    putLe(frame, SENSOR_FRAME_VERSION, 1);
+    putLe(frame, static_cast<uint32_t>(node.binaryRoomId), 1);
+    putLe(frame, node.frameSeq++, 2);
+    putLe(frame, 0x3F, 1);                                   // sensor_bitmap: all six fields
+    putLe(frame, 0x01 | (motion ? 0x02 : 0), 1);             // FRAME_FLAG_REAL_DATA | FRAME_FLAG_MOTION
+    for (int i = 0; i < 5; i++) {
+        putLe(frame, static_cast<uint32_t>(toFixed(i, values[i])), 2);
+    }
+    putLe(frame, static_cast<uint32_t>(uptimeMs), 4);
+    unsigned int mac[6] = {};
+    sscanf(node.deviceId, "%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]);
+    for (unsigned int byte : mac) {
+        putLe(frame, byte, 1);
+    }
+
+    putLe(frame, g_options.stats ? 0x3F : 0, 1);             // stats_bitmap
+    for (int i = 0; g_options.stats && i < SAMPLE_FIELD_COUNT; i++) {
+        int32_t mean = toFixed(i, values[i]);
+        putLe(frame, static_cast<uint32_t>(toFixed(i, statsLow(i, values))), 2);
+        putLe(frame, static_cast<uint32_t>(toFixed(i, statsHigh(i, values, motion))), 2);
+        putLe(frame, static_cast<uint32_t>(mean), 2);
+        putLe(frame, static_cast<uint32_t>(mean * static_cast<int32_t>(STATS_COUNT)), 4);
+        putLe(frame, STATS_COUNT, 1);
+        putLe(frame, STATS_SPAN_MS, 4);
+    }
+
+    record(&Stats::uploads);
+    record(&Stats::binaryUploads);
+    sendFrame(node, ws::OP_BINARY, frame.data(), frame.size(), now);
+}
+
+// Same layout as buildSensorDataMessage() in network.h
+void sendUpload(Node& node, Clock::time_point now, uint64_t uptimeMs) {
+    stepReadings(node);
+    bool motion = uniform(node.rng) < 0.05;
+
+    if (node.binaryRoomId >= 0) {
+        sendBinaryUpload(node, now, uptimeMs, motion);
+        return;
+    }
+
+    // control_results echoes parameters.timestamp; keep it unique per node so replies match exactly
+    uint64_t uploadId = std::max<uint64_t>(uptimeMs, node.lastUploadId + 1);
+    node.lastUploadId = uploadId;
+
+    char text[2048];
+    int length = snprintf(text, sizeof(text),
+                          "{\"type\":\"control\",\"commands\":[{\"device\":\"sensors\",\"action\":\"data_update\","
+                          "\"location\":\"%s\",\"parameters\":{"
+                          "\"temperature\":%.2f,\"humidity\":%.2f,\"co2\":%d,\"voc\":%d,\"light_level\":%d,\"motion\":%s,"
+                          "\"device_id\":\"%s\",\"source\":\"esp8266_real_sensors\",\"data_type\":\"real\",\"timestamp\":%llu",
+                          node.room.c_str(), node.temperature, node.humidity, node.co2, node.voc, node.lightLevel,
+                          motion ? "true" : "false", node.deviceId, static_cast<unsigned long long>(uploadId));
+
+    if (g_options.stats) {
+        double values[SAMPLE_FIELD_COUNT];
+        fieldValues(node, motion, values);
+        length += snprintf(text + length, sizeof(text) - length, ",\"stats\":{");
+        for (int i = 0; i < SAMPLE_FIELD_COUNT; i++) {
+            length += snprintf(text + length, sizeof(text) - length,
+                               "%s\"%s\":{\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"last\":%.2f,\"n\":%u,\"span_ms\":%lu}",
+                               i ? "," : "", SAMPLE_FIELD_NAMES[i], statsLow(i, values),
+                               statsHigh(i, values, motion), values[i], values[i], STATS_COUNT, STATS_SPAN_MS);
+        }
+        length += snprintf(text + length, sizeof(text) - length, "}");
+    }
+    length += snprintf(text + length, sizeof(text) - length, "}}]}");
+
+    node.pendingUploads[uploadId] = now;
+    record(&Stats::uploads);
+    sendText(node, text, length, now);
+}
+
+// Same fields as sendPing() in network.h
+void sendPing(Node& node, Clock::time_point now, uint64_t uptimeMs) {
+    char text[384];
+    int length = snprintf(text, sizeof(text),
+                          "{\"type\":\"ping\",\"device_id\":\"%s\",\"location\":\"%s\",\"timestamp\":%llu,\"sensor_status\":\"active\","
+                          "\"free_heap\":%u,\"max_block\":%u,\"heap_frag\":%u,"
+                          "\"rssi\":%d,\"wifi_reconnects\":0,\"wifi_reconnect_ms\":0,\"wifi_reconnect_max_ms\":0,\"wifi_fast_reconnect\":false}",
+                          node.deviceId, node.room.c_str(), static_cast<unsigned long long>(uptimeMs),
+                          30000u + ws::nextRandom(node.rng) % 2000, 20000u, 5u,
+                          -50 - static_cast<int>(ws::nextRandom(node.rng) % 30));
+    node.pendingPings.push_back(now);
+    record(&Stats::pings);
+    sendText(node, text, length, now);
+}
+
+// ===== Inbound =====
+
+void handleText(Node& node, const std::string& text, Clock::time_point now) {
+    std::string type = messageType(text);
+    g_window.rxByType[type]++;
+    g_total.rxByType[type]++;
+
+    if (type == "control_results") {
+        // Error results carry no parameters; count them against the oldest pending upload
+        uint64_t uploadId = 0;
+        size_t parameters = text.find("\"parameters\"");
+        auto pending = parameters != std::string::npos && findUnsigned(text, "\"timestamp\"", parameters, uploadId)
+                       ? node.pendingUploads.find(uploadId) : node.pendingUploads.begin();
+        if (pending != node.pendingUploads.end()) {
+            recordSample(&Stats::resultUs, elapsedUs(pending->second, now));
+            node.pendingUploads.erase(pending);
+            record(&Stats::results);
+        }
+        if (text.find("\"status\":\"error\"") != std::string::npos ||
+            text.find("\"status\": \"error\"") != std::string::npos) {
+            record(&Stats::resultErrors);
+        }
+    } else if (type == "pong") {
+        if (!node.pendingPings.empty()) {
+            recordSample(&Stats::pingUs, elapsedUs(node.pendingPings.front(), now));
+            node.pendingPings.pop_front();
+            record(&Stats::pongs);
+        }
+    } else if (type == "init") {
+        if (!node.initReceived) {
+            node.initReceived = true;
+            recordSample(&Stats::connectUs, elapsedUs(node.connectStarted, now));
+        }
+        node.binaryRoomId = g_options.json ? -1 : negotiateRoomId(text, node.room);
+    }
+}
+
+void handleFrames(Node& node, Clock::time_point now) {
+    ws::Frame frame;
+    for (;;) {
+        ws::ParseResult result = ws::parseFrame(node.inbound, frame);
+        if (result == ws::PARSE_NEED_MORE) {
+            return;
+        }
+        if (result == ws::PARSE_ERROR) {
+            closeNode(node, now, false);
+            return;
+        }
+
+        record(&Stats::rxFrames);
+        switch (frame.opcode) {
+            case ws::OP_TEXT:
+            case ws::OP_CONTINUATION:
+                node.message += frame.payload;
+                if (frame.fin) {
+                    handleText(node, node.message, now);
+                    node.message.clear();
+                }
+                break;
+            case ws::OP_PING:
+                ws::appendFrame(node.outbound, ws::OP_PONG, frame.payload.data(), frame.payload.size(), node.rng);
+                flush(node, now);
+                break;
+            case ws::OP_CLOSE:
+                closeNode(node, now, false);
+                return;
+            default:
+                break;
+        }
+        if (node.fd < 0) {
+            return;
+        }
+    }
+}
+
+void handleHandshake(Node& node, Clock::time_point now) {
+    size_t end = node.inbound.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return;
+    }
+    if (node.inbound.compare(0, 12, "HTTP/1.1 101") != 0) {
+        closeNode(node, now, true);
+        return;
+    }
+    node.inbound.erase(0, end + 4);
+    node.state = NODE_OPEN;
+    record(&Stats::connects);
+
+    // Firmware subscribes on the next loop() after CONNECTED and uploads once init arrives (or 500 ms later)
+    if (g_options.subscribe) {
+        sendSubscribe(node, now);
+    }
+    node.nextUpload = now + std::chrono::milliseconds(FIRST_UPLOAD_MAX_WAIT_MS);
+    handleFrames(node, now);
+}
+
+void handleReadable(Node& node, Clock::time_point now) {
+    char chunk[READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(node.fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            record(&Stats::rxBytes, n);
+            node.inbound.append(chunk, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        closeNode(node, now, node.state != NODE_OPEN);
+        return;
+    }
+
+    if (node.state == NODE_HANDSHAKE) {
+        handleHandshake(node, now);
+    } else if (node.state == NODE_OPEN) {
+        handleFrames(node, now);
+    }
+}
+
+void handleEvent(Node& node, uint32_t events, Clock::time_point now) {
+    if (node.state == NODE_CONNECTING) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(node.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            closeNode(node, now, true);
+            return;
+        }
+        node.state = NODE_HANDSHAKE;
+        node.outbound = ws::upgradeRequest(g_options.host, g_options.port, g_options.path, node.rng);
+        flush(node, now);
+        return;
+    }
+
+    if (events & EPOLLIN) {
+        handleReadable(node, now);
+    }
+    if (node.fd >= 0 && (events & EPOLLOUT)) {
+        flush(node, now);
+    }
+    if (node.fd >= 0 && (events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN)) {
+        closeNode(node, now, node.state != NODE_OPEN);
+    }
+}
+
+// ===== Timers =====
+
+void serviceNode(Node& node, Clock::time_point now, Clock::time_point startTime) {
+    uint64_t uptimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
+
+    if (node.state == NODE_IDLE) {
+        if (now >= node.reconnectAt) {
+            startConnect(node, now);
+        }
+        return;
+    }
+    if (node.state != NODE_OPEN) {
+        if (now - node.connectStarted > std::chrono::milliseconds(HANDSHAKE_TIMEOUT_MS)) {
+            closeNode(node, now, true);
+        }
+        return;
+    }
+
+    auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(g_options.timeout));
+    // Upload IDs grow with send time, so the oldest pending upload is always first
+    while (!node.pendingUploads.empty() && now - node.pendingUploads.begin()->second > timeout) {
+        node.pendingUploads.erase(node.pendingUploads.begin());
+        record(&Stats::timeouts);
+    }
+
+    bool firstUploadDue = !node.firstUploadDone && (node.initReceived || now >= node.nextUpload);
+    if (firstUploadDue || (node.firstUploadDone && now >= node.nextUpload)) {
+        sendUpload(node, now, uptimeMs);
+        if (node.fd < 0) {
+            return;
+        }
+        node.firstUploadDone = true;
+        // ±10 % jitter keeps nodes from drifting into lockstep
+        double period = g_options.rate > 0 ? 1.0 / g_options.rate : 1e9;
+        node.nextUpload = after(now, period * (0.9 + 0.2 * uniform(node.rng)));
+    }
+
+    if (g_options.pingIdle > 0 && now - node.lastTx >= std::chrono::duration<double>(g_options.pingIdle)) {
+        sendPing(node, now, uptimeMs);
+        node.lastProbe = now;
+    } else if (node.binaryRoomId >= 0 && g_options.probe > 0 &&
+               now - node.lastProbe >= std::chrono::duration<double>(g_options.probe)) {
+        sendPing(node, now, uptimeMs);
+        node.lastProbe = now;
+    }
+}
+
+// ===== Reporting =====
+
+size_t openNodes() {
+    return std::count_if(g_nodes.begin(), g_nodes.end(), [](const Node& node) { return node.state == NODE_OPEN; });
+}
+
+uint64_t broadcastFrames(const Stats& stats) {
+    uint64_t total = 0;
+    for (const char* type : {"sensor_update", "device_update"}) {
+        auto it = stats.rxByType.find(type);
+        if (it != stats.rxByType.end()) {
+            total += it->second;
+        }
+    }
+    return total;
+}
+
+void printWindow(double elapsed, double windowSeconds) {
+    const Stats& w = g_window;
+    printf("[%6.1fs] open %zu/%zu | up %.1f/s (binary %.1f/s) results %.1f/s err %llu timeout %llu | "
+           "result p50 %.2f ms p99 %.2f ms max %.2f ms | ping p50 %.2f ms | rx %.1f fr/s (broadcast %.1f/s) | "
+           "disc %llu connfail %llu\n",
+           elapsed, openNodes(), g_nodes.size(),
+           w.uploads / windowSeconds, w.binaryUploads / windowSeconds, w.results / windowSeconds,
+           static_cast<unsigned long long>(w.resultErrors), static_cast<unsigned long long>(w.timeouts),
+           percentileMs(w.resultUs, 0.50), percentileMs(w.resultUs, 0.99), maxMs(w.resultUs),
+           percentileMs(w.pingUs, 0.50),
+           w.rxFrames / windowSeconds, broadcastFrames(w) / windowSeconds,
+           static_cast<unsigned long long>(w.disconnects), static_cast<unsigned long long>(w.connectFailures));
+    fflush(stdout);
+}
+
+void printSummary(double measuredSeconds, double cpuSeconds) {
+    const Stats& t = g_total;
+    printf("LOADGEN_SUMMARY nodes=%d rate=%.3f duration_s=%.1f open=%zu uploads=%llu binary_uploads=%llu results=%llu "
+           "result_errors=%llu timeouts=%llu lost=%llu throughput_rps=%.1f "
+           "result_p50_ms=%.2f result_p90_ms=%.2f result_p99_ms=%.2f result_max_ms=%.2f "
+           "ping_p50_ms=%.2f ping_p99_ms=%.2f connect_p50_ms=%.2f connect_p99_ms=%.2f "
+           "rx_frames=%llu broadcast_frames=%llu rx_kbps=%.1f tx_kbps=%.1f "
+           "connects=%llu disconnects=%llu connect_failures=%llu client_cpu_pct=%.1f\n",
+           g_options.nodes, g_options.rate, measuredSeconds, openNodes(),
+           static_cast<unsigned long long>(t.uploads), static_cast<unsigned long long>(t.binaryUploads),
+           static_cast<unsigned long long>(t.results),
+           static_cast<unsigned long long>(t.resultErrors), static_cast<unsigned long long>(t.timeouts),
+           static_cast<unsigned long long>(t.lost), t.results / measuredSeconds,
+           percentileMs(t.resultUs, 0.50), percentileMs(t.resultUs, 0.90),
+           percentileMs(t.resultUs, 0.99), maxMs(t.resultUs),
+           percentileMs(t.pingUs, 0.50), percentileMs(t.pingUs, 0.99),
+           percentileMs(t.connectUs, 0.50), percentileMs(t.connectUs, 0.99),
+           static_cast<unsigned long long>(t.rxFrames), static_cast<unsigned long long>(broadcastFrames(t)),
+           t.rxBytes * 8 / 1000.0 / measuredSeconds, t.txBytes * 8 / 1000.0 / measuredSeconds,
+           static_cast<unsigned long long>(t.connects), static_cast<unsigned long long>(t.disconnects),
+           static_cast<unsigned long long>(t.connectFailures), 100.0 * cpuSeconds / measuredSeconds);
+}
+
+// ===== Setup =====
+
+void usage(const char* program) {
+    printf("Usage: %s [options]\n"
+           "  --host HOST             IoT service host (default 127.0.0.1)\n"
+           "  --port PORT             IoT service port (default 8002)\n"
+           "  --path PATH             WebSocket path (default /ws)\n"
+           "  --nodes N               virtual sensor nodes (default 100)\n"
+           "  --rate R                uploads per node per second (default 1)\n"
+           "  --duration S            measurement time after the ramp (default 60)\n"
+           "  --ramp S                spread node connects over S seconds (default 5)\n"
+           "  --ping-idle S           app ping after S idle seconds, 0 = never (default 60)\n"
+           "  --timeout S             unanswered upload timeout (default 10)\n"
+           "  --report-interval S     progress line interval (default 5)\n"
+           "  --rooms a,b,c           rooms assigned round-robin (default the five service rooms)\n"
+           "  --no-subscribe          skip subscribe, receive every broadcast like legacy firmware\n"
+           "  --no-stats              omit window stats from uploads\n"
+           "  --json                  always upload JSON control frames, even when binary frames are offered\n"
+           "  --probe S               binary nodes ping every S seconds to measure latency, 0 = never (default 5)\n"
+           "  --seed N                random seed (default 1)\n",
+           program);
+}
+
+bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Missing value for %s\n", arg.c_str());
+                exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--host") g_options.host = value();
+        else if (arg == "--port") g_options.port = atoi(value());
+        else if (arg == "--path") g_options.path = value();
+        else if (arg == "--nodes") g_options.nodes = atoi(value());
+        else if (arg == "--rate") g_options.rate = atof(value());
+        else if (arg == "--duration") g_options.duration = atof(value());
+        else if (arg == "--ramp") g_options.ramp = atof(value());
+        else if (arg == "--ping-idle") g_options.pingIdle = atof(value());
+        else if (arg == "--timeout") g_options.timeout = atof(value());
+        else if (arg == "--report-interval") g_options.reportInterval = atof(value());
+        else if (arg == "--no-subscribe") g_options.subscribe = false;
+        else if (arg == "--no-stats") g_options.stats = false;
+        else if (arg == "--json") g_options.json = true;
+        else if (arg == "--probe") g_options.probe = atof(value());
+        else if (arg == "--seed") g_options.seed = static_cast<uint32_t>(strtoul(value(), nullptr, 10));
+        else if (arg == "--rooms") {
+            g_options.rooms.clear();
+            std::string list = value();
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t comma = list.find(',', start);
+                std::string room = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+                if (!room.empty()) g_options.rooms.push_back(room);
+                if (comma == std::string::npos) break;
+                start = comma + 1;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            exit(0);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (g_options.nodes <= 0 || g_options.rooms.empty() || g_options.reportInterval <= 0) {
+        fprintf(stderr, "--nodes, --rooms and --report-interval must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+bool resolveAddress() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    int error = getaddrinfo(g_options.host.c_str(), std::to_string(g_options.port).c_str(), &hints, &result);
+    if (error != 0 || !result) {
+        fprintf(stderr, "Cannot resolve %s: %s\n", g_options.host.c_str(), gai_strerror(error));
+        return false;
+    }
+    memcpy(&g_address, result->ai_addr, result->ai_addrlen);
+    g_addressLength = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+// One descriptor per node plus headroom
+void raiseFileLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    rlim_t wanted = static_cast<rlim_t>(g_options.nodes) + 64;
+    if (limit.rlim_cur < wanted) {
+        limit.rlim_cur = std::min(wanted, limit.rlim_max);
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < wanted) {
+            fprintf(stderr, "Warning: file descriptor limit %llu is below %llu, some nodes will fail to connect\n",
+                    static_cast<unsigned long long>(limit.rlim_cur), static_cast<unsigned long long>(wanted));
+        }
+    }
+}
+
+double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv) || !resolveAddress()) {
+        return 2;
+    }
+    raiseFileLimit();
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    g_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epoll < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    Clock::time_point startTime = Clock::now();
+    g_nodes.resize(g_options.nodes);
+    for (int i = 0; i < g_options.nodes; i++) {
+        Node& node = g_nodes[i];
+        node.index = i;
+        node.room = g_options.rooms[i % g_options.rooms.size()];
+        node.rng = g_options.seed * 2654435761u + i * 40503u + 1;
+        // Locally administered MACs, unique per node
+        snprintf(node.deviceId, sizeof(node.deviceId), "02:4C:47:%02X:%02X:%02X",
+                 (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+        node.reconnectAt = after(startTime, g_options.ramp * i / g_options.nodes);
+        node.lastTx = startTime;
+        node.temperature += (uniform(node.rng) - 0.5) * 4;
+        node.humidity += (uniform(node.rng) - 0.5) * 10;
+    }
+
+    printf("Fleet load: %d nodes -> ws://%s:%d%s, %.2f uploads/node/s, ramp %.1fs, duration %.1fs, subscribe %s, "
+           "format %s\n",
+           g_options.nodes, g_options.host.c_str(), g_options.port, g_options.path.c_str(),
+           g_options.rate, g_options.ramp, g_options.duration, g_options.subscribe ? "on" : "off",
+           g_options.json ? "json" : "binary when offered");
+
+    // Statistics cover only the steady state after the ramp
+    Clock::time_point measureStart = after(startTime, g_options.ramp);
+    Clock::time_point endTime = after(measureStart, g_options.duration);
+    Clock::time_point nextReport = after(measureStart, g_options.reportInterval);
+    Clock::time_point windowStart = measureStart;
+    bool measuring = false;
+    double cpuAtMeasureStart = 0;
+
+    std::vector<epoll_event> events(std::min(g_options.nodes, 1024));
+    while (!g_stop) {
+        Clock::time_point now = Clock::now();
+        if (now >= endTime) {
+            break;
+        }
+        if (!measuring && now >= measureStart) {
+            measuring = true;
+            // Keep the ramp's connect statistics, everything else starts from steady state
+            Stats ramp = g_total;
+            g_window.reset();
+            g_total.reset();
+            g_total.connects = ramp.connects;
+            g_total.connectFailures = ramp.connectFailures;
+            g_total.connectUs = std::move(ramp.connectUs);
+            cpuAtMeasureStart = cpuSeconds();
+        }
+
+        for (Node& node : g_nodes) {
+            serviceNode(node, now, startTime);
+        }
+
+        int count = epoll_wait(g_epoll, events.data(), static_cast<int>(events.size()), EPOLL_TICK_MS);
+        now = Clock::now();
+        for (int i = 0; i < count; i++) {
+            Node& node = g_nodes[events[i].data.u32];
+            if (node.fd >= 0) {
+                handleEvent(node, events[i].events, now);
+            }
+        }
+
+        if (measuring && now >= nextReport) {
+            double elapsed = std::chrono::duration<double>(now - measureStart).count();
+            printWindow(elapsed, std::chrono::duration<double>(now - windowStart).count());
+            g_window.reset();
+            windowStart = now;
+            nextReport = after(nextReport, g_options.reportInterval);
+        }
+    }
+
+    Clock::time_point now = Clock::now();
+    double measured = measuring ? std::chrono::duration<double>(now - measureStart).count() : 0.0;
+    if (measured > 0) {
+        printSummary(measured, cpuSeconds() - cpuAtMeasureStart);
+    } else {
+        printf("LOADGEN_SUMMARY nodes=%d duration_s=0 stopped_during_ramp=1\n", g_options.nodes);
+    }
+
+    for (Node& node : g_nodes) {
+        if (node.fd >= 0) {
+            close(node.fd);
+        }
+    }
+    close(g_epoll);
+    return 0;
+}
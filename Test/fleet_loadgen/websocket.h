@@ -0,0 +1,149 @@
+// Minimal RFC 6455 client framing for the fleet load generator.
+// Only what the firmware protocol needs: the upgrade request, masked text frames,
+// and parsing of unmasked server frames (text, binary, ping, close, continuation).
+// Sec-WebSocket-Accept is not verified; the tool only talks to our own IoT service.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ws {
+
+enum Opcode : uint8_t {
+    OP_CONTINUATION = 0x0,
+    OP_TEXT = 0x1,
+    OP_BINARY = 0x2,
+    OP_CLOSE = 0x8,
+    OP_PING = 0x9,
+    OP_PONG = 0xA
+};
+
+// xorshift32, good enough for masking keys and handshake nonces
+inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+inline std::string base64Encode(const uint8_t* data, size_t length) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((length + 2) / 3 * 4);
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = data[i] << 16;
+        if (i + 1 < length) chunk |= data[i + 1] << 8;
+        if (i + 2 < length) chunk |= data[i + 2];
+        out += table[(chunk >> 18) & 0x3F];
+        out += table[(chunk >> 12) & 0x3F];
+        out += i + 1 < length ? table[(chunk >> 6) & 0x3F] : '=';
+        out += i + 2 < length ? table[chunk & 0x3F] : '=';
+    }
+    return out;
+}
+
+inline std::string upgradeRequest(const std::string& host, int port, const std::string& path, uint32_t& rng) {
+    uint8_t nonce[16];
+    for (uint8_t& byte : nonce) {
+        byte = nextRandom(rng) & 0xFF;
+    }
+    return "GET " + path + " HTTP/1.1\r\n"
+           "Host: " + host + ":" + std::to_string(port) + "\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Key: " + base64Encode(nonce, sizeof(nonce)) + "\r\n"
+           "Sec-WebSocket-Version: 13\r\n"
+           "\r\n";
+}
+
+// Append one masked client frame to out
+inline void appendFrame(std::string& out, Opcode opcode, const char* payload, size_t length, uint32_t& rng) {
+    out += static_cast<char>(0x80 | opcode);
+    if (length < 126) {
+        out += static_cast<char>(0x80 | length);
+    } else if (length <= 0xFFFF) {
+        out += static_cast<char>(0x80 | 126);
+        out += static_cast<char>(length >> 8);
+        out += static_cast<char>(length & 0xFF);
+    } else {
+        out += static_cast<char>(0x80 | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out += static_cast<char>((static_cast<uint64_t>(length) >> shift) & 0xFF);
+        }
+    }
+
+    uint32_t key = nextRandom(rng);
+    uint8_t mask[4] = {
+        static_cast<uint8_t>(key >> 24), static_cast<uint8_t>(key >> 16),
+        static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key)
+    };
+    out.append(reinterpret_cast<const char*>(mask), 4);
+
+    size_t start = out.size();
+    out.append(payload, length);
+    for (size_t i = 0; i < length; i++) {
+        out[start + i] ^= mask[i & 3];
+    }
+}
+
+struct Frame {
+    Opcode opcode;
+    bool fin;
+    std::string payload;
+};
+
+enum ParseResult {
+    PARSE_NEED_MORE,
+    PARSE_FRAME,
+    PARSE_ERROR
+};
+
+// Try to take one complete frame from the front of buffer (consumed bytes are erased)
+inline ParseResult parseFrame(std::string& buffer, Frame& frame) {
+    if (buffer.size() < 2) {
+        return PARSE_NEED_MORE;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+    bool masked = data[1] & 0x80;
+    uint64_t length = data[1] & 0x7F;
+    size_t header = 2;
+
+    if (length == 126) {
+        if (buffer.size() < 4) return PARSE_NEED_MORE;
+        length = (data[2] << 8) | data[3];
+        header = 4;
+    } else if (length == 127) {
+        if (buffer.size() < 10) return PARSE_NEED_MORE;
+        length = 0;
+        for (int i = 0; i < 8; i++) {
+            length = (length << 8) | data[2 + i];
+        }
+        header = 10;
+    }
+    if (length > (64u << 20)) {
+        return PARSE_ERROR;
+    }
+
+    size_t maskOffset = header;
+    if (masked) {
+        header += 4;
+    }
+    if (buffer.size() < header + length) {
+        return PARSE_NEED_MORE;
+    }
+
+    frame.opcode = static_cast<Opcode>(data[0] & 0x0F);
+    frame.fin = data[0] & 0x80;
+    frame.payload.assign(buffer, header, length);
+    if (masked) {
+        for (size_t i = 0; i < length; i++) {
+            frame.payload[i] ^= data[maskOffset + (i & 3)];
+        }
+    }
+    buffer.erase(0, header + length);
+    return PARSE_FRAME;
+}
+
+}  // namespace ws
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""
+IoT Service Scene Execution Test
+Runs a predefined scene through the /execute_scene handler and checks that every
+command reaches the device state, the subscribed node (as one batched control
+frame per room) and the ack tracker
+
+Usage: pytest Test/test_iot_scene.py
+"""
+
+import asyncio
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "services", "iot"))
+
+import app as iot  # noqa: E402
+
+
+class FakeWebSocket:
+    """Records every broadcast sent to a connected node"""
+    def __init__(self):
+        self.sent = []
+
+    async def send_json(self, message):
+        self.sent.append(message)
+
+
+def test_home_mode_scene_end_to_end():
+    node = FakeWebSocket()
+    iot.connected_devices["test_node"] = node
+    iot.client_subscriptions["test_node"] = {
+        "rooms": {"living_room"},
+        "types": {"device_update"},
+        "acks": True
+    }
+    iot.device_states["ceiling_light"]["living_room"]["status"] = "off"
+    iot.device_states["ac"]["living_room"]["status"] = "off"
+    request_ts = time.time()
+
+    try:
+        response = asyncio.run(iot.execute_scene(
+            iot.SceneRequest(scene_name="home_mode", request_ts=request_ts)))
+    finally:
+        iot.connected_devices.pop("test_node", None)
+        iot.client_subscriptions.pop("test_node", None)
+
+    # 场景内每条命令都必须成功执行
+    assert response["status"] == "success"
+    assert len(response["results"]) == 2
+    for result in response["results"]:
+        assert result["status"] == "success", result
+        assert result["seq"] is not None
+
+    assert iot.device_states["ceiling_light"]["living_room"]["status"] == "on"
+    assert iot.device_states["ac"]["living_room"]["status"] == "on"
+
+    # 订阅了客厅的节点只收到一个 control 帧，包含场景内全部命令的 seq 和执行后的状态
+    assert [m["type"] for m in node.sent] == ["control"]
+    frame = node.sent[0]
+    assert frame["location"] == "living_room"
+    assert [c["device"] for c in frame["commands"]] == ["ceiling_light", "ac"]
+    assert [c["seq"] for c in frame["commands"]] == [r["seq"] for r in response["results"]]
+    assert frame["commands"][0]["state"]["status"] == "on"
+
+    # request_ts 一路传到确认跟踪，用于统计端到端延迟
+    for result in response["results"]:
+        cmd = iot.in_flight_commands.pop(result["seq"])
+        assert cmd["request_ts"] == request_ts
+
+
+def test_control_request_batches_per_room():
+    node = FakeWebSocket()
+    viewer = FakeWebSocket()
+    iot.connected_devices["test_node"] = node
+    iot.connected_devices["test_viewer"] = viewer
+    iot.client_subscriptions["test_node"] = {
+        "rooms": {"bedroom"},
+        "types": {"device_update"},
+        "acks": True
+    }
+    commands = [
+        {"device": "ceiling_light", "action": "on", "location": "bedroom"},
+        {"device": "desk_lamp", "action": "on", "location": "bedroom"},
+        {"device": "ceiling_light", "action": "on", "location": "kitchen"},
+    ]
+
+    try:
+        response = asyncio.run(iot.control_devices(iot.IoTControlRequest(commands=commands)))
+    finally:
+        iot.connected_devices.pop("test_node", None)
+        iot.connected_devices.pop("test_viewer", None)
+        iot.client_subscriptions.pop("test_node", None)
+
+    results = response["results"]
+    assert [r["status"] for r in results] == ["success"] * 3
+    # 只有卧室有确认节点，厨房的命令不分配 seq
+    assert results[0]["seq"] is not None and results[1]["seq"] is not None
+    assert results[2]["seq"] is None
+
+    # 节点收到卧室的一个 control 帧
+    assert [m["type"] for m in node.sent] == ["control"]
+    assert [c["seq"] for c in node.sent[0]["commands"]] == [results[0]["seq"], results[1]["seq"]]
+
+    # 未订阅的客户端照常收到每条 device_update，不带 seq
+    updates = [m for m in viewer.sent if m["type"] == "device_update"]
+    assert [(m["device"], m["location"]) for m in updates] == [
+        ("ceiling_light", "bedroom"), ("desk_lamp", "bedroom"), ("ceiling_light", "kitchen")]
+    assert all("seq" not in m for m in updates)
+
+    for result in results[:2]:
+        iot.in_flight_commands.pop(result["seq"])
+
+
+def test_unknown_scene_runs_nothing():
+    response = asyncio.run(iot.execute_scene(iot.SceneRequest(scene_name="party_mode")))
+    assert response["status"] == "success"
+    assert response["results"] == []
@@ -541,6 +541,7 @@ async def process_text_with_enhanced_llm(
     device_id: str = None  # 新增参数
 ):
     """Enhanced text processing with current model and all features"""
+    request_ts = time.time()  # 用于IoT服务统计“语音请求到设备执行”的端到端延迟
     
     # Get current model
     current_model = model_manager.get_current_model()
@@ -568,7 +569,7 @@ async def process_text_with_enhanced_llm(
         try:
             iot_url = f"http://{IOT_HOST}:{IOT_PORT}/control"
             # 正确格式：将所有命令放在commands数组中
-            iot_response = requests.post(iot_url, json={"commands": iot_commands})
+            iot_response = requests.post(iot_url, json={"commands": iot_commands, "request_ts": request_ts})
             
             if iot_response.status_code == 200:
                 iot_results = iot_response.json().get("results", [])
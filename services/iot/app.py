@@ -11,6 +11,8 @@ import uvicorn
 from pydantic import BaseModel
 from typing import List, Dict, Any, Optional
 import uuid
+import struct
+from collections import deque
 
 # Configure logging
 logging.basicConfig(
@@ -42,9 +44,61 @@ app.add_middleware(
 # Connected ESP32 devices
 connected_devices = {}
 
+# Per-client broadcast filters set by a "subscribe" message: client_id -> {"rooms": set, "types": set, "acks": bool}
+# Clients that never subscribe (web UI, older firmware) keep receiving every broadcast
+client_subscriptions = {}
+
 # Timer management for timed devices
 active_timers = {}
 
+# Binary sensor frame (WStype_BIN) - must match Arduino/.../binary_frame.h
+SENSOR_FRAME_VERSION = 2
+SENSOR_FRAME_STRUCT = struct.Struct("<BBHBBhHHHHI6s")
+# Per-field window stats after the header: [uint8 stats_bitmap] + one entry per set bit
+FRAME_STATS_STRUCT = struct.Struct("<HHHiBI")  # min, max, last, sum, count, span_ms
+ROOM_IDS = ["living_room", "bedroom", "kitchen", "study", "bathroom"]
+
+FRAME_HAS_TEMPERATURE = 0x01
+FRAME_HAS_HUMIDITY = 0x02
+FRAME_HAS_CO2 = 0x04
+FRAME_HAS_VOC = 0x08
+FRAME_HAS_LIGHT = 0x10
+FRAME_HAS_MOTION = 0x20
+FRAME_FLAG_REAL_DATA = 0x01
+FRAME_FLAG_MOTION = 0x02
+
+# Fixed-point fields in bitmap order - must match SAMPLE_FIELD_* in Arduino/.../sample_buffer.h
+# (name, scale, signed)
+FRAME_FIELDS = [
+    ("temperature", 100.0, True),
+    ("humidity", 100.0, False),
+    ("co2", 1.0, False),
+    ("voc", 1.0, False),
+    ("light_level", 0.5, False),
+    ("motion", 1.0, False),
+]
+
+# Last reported health of firmware nodes, keyed by device_id
+node_status = {}
+
+# Upper bounds (us) of the firmware loop-latency histogram buckets; must match
+# TELEMETRY_BUCKET_US in Arduino/libraries/SmartHomeNode/src/telemetry.h. The last bucket is overflow.
+TELEMETRY_LOOP_BUCKETS_US = [500, 1000, 2000, 5000, 10000, 50000, 100000, None]
+
+# Commands broadcast to firmware and not yet acknowledged, keyed by sequence ID
+command_seq = 0
+in_flight_commands = {}
+IN_FLIGHT_TIMEOUT_S = 30
+commands_timed_out = 0
+
+# Round-trip latency of acknowledged commands
+COMMAND_LATENCY_LIMIT = int(os.getenv("COMMAND_LATENCY_LIMIT", 200))
+command_latency = deque(maxlen=COMMAND_LATENCY_LIMIT)
+
+# Backfilled (store-and-forward) sensor readings per location
+SENSOR_HISTORY_LIMIT = int(os.getenv("SENSOR_HISTORY_LIMIT", 1000))
+sensor_history = {}
+
 # Enhanced device states - 对应Week 1设计
 device_states = {
     # 天花板灯 - 支持调光和色温
@@ -167,14 +221,123 @@ class IoTCommand(BaseModel):
 
 class IoTControlRequest(BaseModel):
     commands: List[dict]
+    request_ts: Optional[float] = None  # epoch seconds when the originating (voice) request started
 
 class SceneRequest(BaseModel):
     scene_name: str
     location: Optional[str] = None
+    request_ts: Optional[float] = None  # epoch seconds when the originating (voice) request started
 
 # Helper functions defined first to avoid undefined variable errors
 
-async def broadcast_device_update(device, location):
+def client_wants(client_id, message):
+    """Check a broadcast against the client's subscription"""
+    subscription = client_subscriptions.get(client_id)
+    if subscription is None:
+        return True
+    if message.get("type") not in subscription["types"]:
+        return False
+    location = message.get("location")
+    return location is None or location in subscription["rooms"]
+
+async def fan_out(message, clients=None, skip=()):
+    """Send a broadcast to every subscribed client, dropping dead sockets
+
+    clients restricts delivery to those client IDs regardless of subscription;
+    skip leaves the given client IDs out
+    """
+    disconnected_clients = []
+    for client_id, websocket in connected_devices.items():
+        if client_id in skip:
+            continue
+        if clients is not None:
+            if client_id not in clients:
+                continue
+        elif not client_wants(client_id, message):
+            continue
+        try:
+            await websocket.send_json(message)
+        except Exception as e:
+            logger.error(f"{message.get('type')} send failed for client {client_id}: {str(e)}")
+            disconnected_clients.append(client_id)
+    
+    # Remove disconnected clients
+    for client_id in disconnected_clients:
+        del connected_devices[client_id]
+        client_subscriptions.pop(client_id, None)
+
+def expire_in_flight_commands():
+    """Drop commands no firmware acknowledged within IN_FLIGHT_TIMEOUT_S"""
+    global commands_timed_out
+    now = time.time()
+    expired = [seq for seq, cmd in in_flight_commands.items() if now - cmd["issued_at"] > IN_FLIGHT_TIMEOUT_S]
+    for seq in expired:
+        cmd = in_flight_commands.pop(seq)
+        commands_timed_out += 1
+        logger.warning(f"Command {seq} ({cmd['device']} {cmd['action']} @ {cmd['location']}) was never acknowledged")
+
+def ack_subscribers(location):
+    """Client IDs of nodes that subscribed to device updates for this room and will ack them"""
+    return {client_id for client_id, sub in client_subscriptions.items()
+            if sub["acks"] and location in sub["rooms"] and "device_update" in sub["types"]}
+
+def room_has_subscriber(location):
+    """True when some node subscribed to device updates for this room and will ack them"""
+    return bool(ack_subscribers(location))
+
+def register_command(device, action, location, request_ts=None):
+    """Assign a sequence ID to a device command and track it until the firmware acks"""
+    global command_seq
+    expire_in_flight_commands()
+    command_seq += 1
+    in_flight_commands[command_seq] = {
+        "seq": command_seq,
+        "device": device,
+        "action": action,
+        "location": location,
+        "issued_at": time.time(),
+        "request_ts": request_ts
+    }
+    return command_seq
+
+def handle_command_ack(device_id, ack):
+    """Close out an in-flight command from a firmware ack entry"""
+    seq = ack.get("seq")
+    cmd = in_flight_commands.pop(seq, None)
+    if cmd is None:
+        return
+    
+    now = time.time()
+    record = {
+        "seq": seq,
+        "device": cmd["device"],
+        "action": cmd["action"],
+        "location": cmd["location"],
+        "device_id": device_id,
+        "status": ack.get("status"),
+        "applied_ms": ack.get("applied_ms"),
+        "round_trip_ms": round((now - cmd["issued_at"]) * 1000, 1),
+        "timestamp": now
+    }
+    if cmd["request_ts"] is not None:
+        record["request_to_apply_ms"] = round((now - cmd["request_ts"]) * 1000, 1)
+    command_latency.append(record)
+    logger.info(f"Command {seq} acked by {device_id}: {record['status']} in {record['round_trip_ms']} ms")
+
+def latency_summary(values):
+    """count/mean/p50/p95/max of a list of milliseconds"""
+    if not values:
+        return {"count": 0}
+    values = sorted(values)
+    return {
+        "count": len(values),
+        "mean_ms": round(sum(values) / len(values), 1),
+        "p50_ms": values[len(values) // 2],
+        "p95_ms": values[min(len(values) - 1, int(len(values) * 0.95))],
+        "max_ms": values[-1]
+    }
+
+async def broadcast_device_update(device, location, seq=None, skip=()):
     """Broadcast device state update to all connected WebSocket clients"""
     if not connected_devices:
         return
@@ -186,18 +349,25 @@ async def broadcast_device_update(device, location):
         "state": device_states[device][location],
         "timestamp": time.time()
     }
+    if seq is not None:
+        message["seq"] = seq  # firmware acks with this ID once the change is applied
     
-    disconnected_clients = []
-    for client_id, websocket in connected_devices.items():
-        try:
-            await websocket.send_json(message)
-        except Exception as e:
-            logger.error(f"WebSocket send failed for client {client_id}: {str(e)}")
-            disconnected_clients.append(client_id)
-    
-    # Remove disconnected clients
-    for client_id in disconnected_clients:
-        del connected_devices[client_id]
+    await fan_out(message, skip=skip)
+
+async def send_control_batch(batch):
+    """Send each room's batched commands to its ack subscribers as one control frame
+
+    batch maps location -> seq-tagged commands collected by execute_enhanced_command
+    over one request, so a node applies them together and answers with one ack frame
+    """
+    for location, commands in batch.items():
+        message = {
+            "type": "control",
+            "location": location,
+            "commands": commands,
+            "timestamp": time.time()
+        }
+        await fan_out(message, clients=ack_subscribers(location))
 
 async def broadcast_sensor_update(location):
     """Broadcast sensor data update"""
@@ -212,17 +382,7 @@ async def broadcast_sensor_update(location):
         "timestamp": time.time()
     }
     
-    disconnected_clients = []
-    for client_id, websocket in connected_devices.items():
-        try:
-            await websocket.send_json(message)
-        except Exception as e:
-            logger.error(f"Sensor update failed for client {client_id}: {str(e)}")
-            disconnected_clients.append(client_id)
-    
-    # Remove disconnected clients
-    for client_id in disconnected_clients:
-        del connected_devices[client_id]
+    await fan_out(message)
 
 async def update_environmental_impact(device, action, location, current_state):
     """Update environmental sensors based on device changes (simulation)"""
@@ -285,6 +445,97 @@ async def update_environmental_impact(device, action, location, current_state):
     # Broadcast sensor updates
     await broadcast_sensor_update(location)
 
+def decode_sensor_frame(data):
+    """Decode a binary sensor frame into (location, parameters, seq)"""
+    if len(data) < SENSOR_FRAME_STRUCT.size + 1:
+        raise ValueError(f"Invalid sensor frame size: {len(data)}")
+    
+    (version, room_id, seq, bitmap, flags, temperature, humidity,
+     co2, voc, light_level, timestamp, mac) = SENSOR_FRAME_STRUCT.unpack_from(data)
+    
+    if version != SENSOR_FRAME_VERSION:
+        raise ValueError(f"Unsupported sensor frame version: {version}")
+    if room_id >= len(ROOM_IDS):
+        raise ValueError(f"Unknown room id: {room_id}")
+    
+    real_data = bool(flags & FRAME_FLAG_REAL_DATA)
+    parameters = {
+        "device_id": ":".join(f"{b:02X}" for b in mac),
+        "source": "esp8266_real_sensors" if real_data else "esp8266_simulated",
+        "data_type": "real" if real_data else "simulated",
+        "timestamp": timestamp
+    }
+    if bitmap & FRAME_HAS_TEMPERATURE:
+        parameters["temperature"] = temperature / 100.0
+    if bitmap & FRAME_HAS_HUMIDITY:
+        parameters["humidity"] = humidity / 100.0
+    if bitmap & FRAME_HAS_CO2:
+        parameters["co2"] = co2
+    if bitmap & FRAME_HAS_VOC:
+        parameters["voc"] = voc
+    if bitmap & FRAME_HAS_LIGHT:
+        parameters["light_level"] = int(light_level / FRAME_FIELDS[4][1])
+    if bitmap & FRAME_HAS_MOTION:
+        parameters["motion"] = bool(flags & FRAME_FLAG_MOTION)
+    
+    stats = decode_frame_stats(data[SENSOR_FRAME_STRUCT.size:])
+    if stats:
+        parameters["stats"] = stats
+    
+    return ROOM_IDS[room_id], parameters, seq
+
+def decode_frame_stats(data):
+    """Decode the window stats block into the same shape as the JSON upload's "stats" """
+    stats_bitmap = data[0]
+    expected = 1 + FRAME_STATS_STRUCT.size * bin(stats_bitmap).count("1")
+    if len(data) != expected:
+        raise ValueError(f"Stats block is {len(data)} bytes, expected {expected}")
+    
+    def value(raw, signed):
+        return raw - 0x10000 if signed and raw >= 0x8000 else raw
+    
+    stats = {}
+    offset = 1
+    for bit, (name, scale, signed) in enumerate(FRAME_FIELDS):
+        if not stats_bitmap & (1 << bit):
+            continue
+        raw_min, raw_max, raw_last, total, count, span_ms = FRAME_STATS_STRUCT.unpack_from(data, offset)
+        offset += FRAME_STATS_STRUCT.size
+        if count == 0:
+            continue
+        stats[name] = {
+            "min": round(value(raw_min, signed) / scale, 2),
+            "max": round(value(raw_max, signed) / scale, 2),
+            "mean": round(total / count / scale, 2),
+            "last": round(value(raw_last, signed) / scale, 2),
+            "n": count,
+            "span_ms": span_ms
+        }
+    return stats
+
+def record_sensor_history(location, parameters):
+    """Store a backfilled sensor reading sent after a node reconnects"""
+    age_ms = parameters.get("age_ms")
+    entry = {
+        "recorded_at": time.time() - age_ms / 1000.0 if age_ms is not None else None,
+        "received_at": time.time(),
+        "device_id": parameters.get("device_id", "unknown")
+    }
+    for key in ("temperature", "humidity", "co2", "voc", "light_level", "motion"):
+        if key in parameters:
+            entry[key] = parameters[key]
+    
+    history = sensor_history.setdefault(location, deque(maxlen=SENSOR_HISTORY_LIMIT))
+    history.append(entry)
+    
+    return {
+        "status": "success",
+        "device": "sensors",
+        "location": location,
+        "action": "data_update",
+        "queued": True
+    }
+
 def set_device_timer(device, location, minutes):
     """Set a timer for a device"""
     timer_id = f"{device}_{location}_{int(time.time())}"
@@ -307,6 +558,43 @@ async def get_devices():
     """Get all device states"""
     return {"devices": device_states}
 
+@app.get("/nodes")
+async def get_nodes():
+    """Get last reported health (heap usage etc.) of firmware nodes"""
+    return {"nodes": node_status}
+
+def loop_percentile_bound(hist, fraction):
+    """Upper bound (us) of the histogram bucket containing the given fraction of loop iterations"""
+    total = sum(hist)
+    if not total:
+        return None
+    threshold = total * fraction
+    running = 0
+    for count, bound in zip(hist, TELEMETRY_LOOP_BUCKETS_US):
+        running += count
+        if running >= threshold:
+            return bound
+    return None
+
+@app.get("/nodes/{device_id}")
+async def get_node(device_id: str):
+    """Get last reported health and firmware telemetry of one node"""
+    node = node_status.get(device_id)
+    if node is None:
+        return JSONResponse(
+            status_code=404,
+            content={"error": f"Unknown node: {device_id}"}
+        )
+
+    response = {"device_id": device_id, **node}
+    telemetry = node.get("telemetry")
+    if telemetry:
+        hist = telemetry.get("loop", {}).get("hist", [])
+        response["loop_buckets_us"] = TELEMETRY_LOOP_BUCKETS_US
+        response["loop_p50_us"] = loop_percentile_bound(hist, 0.50)
+        response["loop_p99_us"] = loop_percentile_bound(hist, 0.99)
+    return response
+
 @app.get("/device/{device_type}/{location}")
 async def get_device_status(device_type: str, location: str):
     """Get specific device status"""
@@ -322,6 +610,23 @@ async def get_device_status(device_type: str, location: str):
         "state": device_states[device_type][location]
     }
 
+@app.get("/commands")
+async def get_commands():
+    """In-flight commands and acknowledged round-trip latency"""
+    expire_in_flight_commands()
+    now = time.time()
+    recent = list(command_latency)
+    return {
+        "in_flight": [
+            {**cmd, "age_ms": round((now - cmd["issued_at"]) * 1000, 1)}
+            for cmd in in_flight_commands.values()
+        ],
+        "timed_out": commands_timed_out,
+        "round_trip": latency_summary([r["round_trip_ms"] for r in recent]),
+        "request_to_apply": latency_summary([r["request_to_apply_ms"] for r in recent if "request_to_apply_ms" in r]),
+        "recent": recent[-20:]
+    }
+
 @app.get("/sensors")
 async def get_all_sensors():
     """Get all sensor data"""
@@ -367,6 +672,22 @@ async def get_sensor_info(location: str):
     
     return info
 
+@app.get("/sensors/{location}/history")
+async def get_sensor_history(location: str):
+    """Get backfilled sensor readings uploaded from a node's offline queue"""
+    if location not in device_states.get("sensors", {}):
+        return JSONResponse(
+            status_code=404,
+            content={"error": f"No sensors found for location: {location}"}
+        )
+    
+    history = list(sensor_history.get(location, []))
+    return {
+        "location": location,
+        "count": len(history),
+        "history": history
+    }
+
 @app.post("/sensors/{location}/reset_simulation")
 async def reset_sensor_simulation(location: str):
     """Reset sensor to simulation mode (for testing)"""
@@ -394,6 +715,7 @@ async def reset_sensor_simulation(location: str):
 async def control_devices(request: IoTControlRequest):
     """Control IoT devices with enhanced support"""
     results = []
+    batch = {}
     
     for cmd in request.commands:
         try:
@@ -430,7 +752,7 @@ async def control_devices(request: IoTControlRequest):
                     continue
             
             # Execute enhanced control command
-            result = await execute_enhanced_command(device, action, location, parameters)
+            result = await execute_enhanced_command(device, action, location, parameters, request.request_ts, batch)
             results.append(result)
             
         except Exception as e:
@@ -441,13 +763,14 @@ async def control_devices(request: IoTControlRequest):
                 "command": cmd
             })
     
+    await send_control_batch(batch)
     return {"results": results}
 
 @app.post("/execute_scene")
 async def execute_scene(request: SceneRequest):
     """Execute predefined scene mode"""
     try:
-        results = await execute_scene_mode(request.scene_name, request.location)
+        results = await execute_scene_mode(request.scene_name, request.location, request.request_ts)
         return {
             "scene": request.scene_name,
             "location": request.location,
@@ -461,12 +784,21 @@ async def execute_scene(request: SceneRequest):
             content={"error": f"Error executing scene: {str(e)}"}
         )
 
-async def execute_enhanced_command(device, action, location, parameters):
-    """Enhanced device control with full parameter support"""
+async def execute_enhanced_command(device, action, location, parameters, request_ts=None, batch=None):
+    """Enhanced device control with full parameter support
+
+    With a batch dict, commands for rooms with an acking node are collected there
+    instead of being sent as seq-tagged device_updates; the caller flushes them
+    with send_control_batch() once the whole request has run
+    """
     try:
         # 特殊处理：传感器数据更新
         if device == "sensors" and action == "data_update":
             # 更新传感器数据而不是设备状态
+            if location in device_states.get("sensors", {}) and parameters.get("queued"):
+                # 节点离线期间缓存的补传数据：只写入历史，不覆盖实时状态也不广播
+                return record_sensor_history(location, parameters)
+            
             if location in device_states.get("sensors", {}):
                 # 更新传感器数据
                 sensor_data = device_states["sensors"][location]
@@ -485,10 +817,19 @@ async def execute_enhanced_command(device, action, location, parameters):
                 if "motion" in parameters:
                     sensor_data["motion"] = bool(parameters["motion"])
                 
+                # 节点端上传窗口统计 (min/max/mean/last)，没有时保留上一次的
+                if isinstance(parameters.get("stats"), dict):
+                    sensor_data["stats"] = parameters["stats"]
+                
                 # 更新时间戳和来源信息
                 sensor_data["last_update"] = time.strftime("%Y-%m-%dT%H:%M:%S")
                 sensor_data["source"] = parameters.get("source", "unknown")
                 sensor_data["device_id"] = parameters.get("device_id", "unknown")
+                # Multi-room hubs report which TCA9548A channel this room's sensors hang off
+                if "hub_channel" in parameters:
+                    sensor_data["hub_channel"] = parameters["hub_channel"]
+                else:
+                    sensor_data.pop("hub_channel", None)
                 
                 # 标记为真实数据，避免被模拟数据覆盖
                 sensor_data["real_data"] = True
@@ -594,7 +935,19 @@ async def execute_enhanced_command(device, action, location, parameters):
         device_states[device][location] = current_state
         
         # Broadcast update to connected devices
-        await broadcast_device_update(device, location)
+        seq = register_command(device, action, location, request_ts) if room_has_subscriber(location) else None
+        if seq is not None and batch is not None:
+            batch.setdefault(location, []).append({
+                "seq": seq,
+                "device": device,
+                "action": action,
+                "location": location,
+                "parameters": parameters,
+                "state": current_state
+            })
+            await broadcast_device_update(device, location, skip=ack_subscribers(location))
+        else:
+            await broadcast_device_update(device, location, seq)
         
         # Update related sensor data (simulate environmental impact)
         await update_environmental_impact(device, action, location, current_state)
@@ -605,7 +958,8 @@ async def execute_enhanced_command(device, action, location, parameters):
             "location": location,
             "action": action,
             "parameters": parameters,
-            "current_state": current_state
+            "current_state": current_state,
+            "seq": seq
         }
     
     except Exception as e:
@@ -618,7 +972,7 @@ async def execute_enhanced_command(device, action, location, parameters):
             "action": action
         }
 
-async def execute_scene_mode(scene_name, location=None):
+async def execute_scene_mode(scene_name, location=None, request_ts=None):
     """Execute predefined scene modes"""
     scene_commands = []
     
@@ -640,6 +994,7 @@ async def execute_scene_mode(scene_name, location=None):
     
     # Execute scene commands
     results = []
+    batch = {}
     for cmd in scene_commands:
         try:
             device = cmd["device"]
@@ -647,7 +1002,7 @@ async def execute_scene_mode(scene_name, location=None):
             location = cmd["location"]
             parameters = cmd.get("parameters", {})
             
-            result = await execute_enhanced_command(device, action, location, parameters)
+            result = await execute_enhanced_command(device, action, location, parameters, request_ts, batch)
             results.append(result)
             
         except Exception as e:
@@ -658,6 +1013,7 @@ async def execute_scene_mode(scene_name, location=None):
                 "command": cmd
             })
     
+    await send_control_batch(batch)
     return results
 
 async def manage_device_timers():
@@ -702,16 +1058,50 @@ async def websocket_endpoint(websocket: WebSocket):
     
     try:
         # Send initial state to new client
+        # capabilities goes first so memory-constrained nodes can read it from a partial parse
         await websocket.send_json({
             "type": "init",
+            "capabilities": {
+                "binary_sensor_frame": SENSOR_FRAME_VERSION,
+                "rooms": ROOM_IDS
+            },
             "devices": device_states,
             "timestamp": time.time(),
             "message": "Connected to IoT Control Service"
         })
         
+        last_frame_seq = None
+        client_device_id = None
+        
         # Handle incoming messages
         while True:
-            data = await websocket.receive_text()
+            received = await websocket.receive()
+            if received["type"] == "websocket.disconnect":
+                raise WebSocketDisconnect(received.get("code", 1000))
+            
+            # Any frame counts as liveness; nodes only send app-level pings when idle
+            if client_device_id in node_status:
+                node_status[client_device_id]["last_seen"] = time.time()
+            
+            # Binary sensor frame: decode and apply, no reply to save airtime
+            if received.get("bytes") is not None:
+                try:
+                    location, parameters, seq = decode_sensor_frame(received["bytes"])
+                except (ValueError, struct.error) as e:
+                    logger.warning(f"Bad binary frame from {client_id}: {str(e)}")
+                    continue
+                
+                client_device_id = parameters["device_id"]
+                if last_frame_seq is not None and seq != (last_frame_seq + 1) & 0xFFFF:
+                    logger.warning(f"Sensor frame gap from {client_id}: {last_frame_seq} -> {seq}")
+                last_frame_seq = seq
+                
+                await execute_enhanced_command("sensors", "data_update", location, parameters)
+                continue
+            
+            data = received.get("text")
+            if data is None:
+                continue
             message = json.loads(data)
             
             try:
@@ -721,6 +1111,7 @@ async def websocket_endpoint(websocket: WebSocket):
                 if command_type == "control":
                     commands = message.get("commands", [])
                     results = []
+                    batch = {}
                     
                     for cmd in commands:
                         device = cmd.get("device")
@@ -729,15 +1120,40 @@ async def websocket_endpoint(websocket: WebSocket):
                         parameters = cmd.get("parameters", {})
                         
                         if all([device, action, location]):
-                            result = await execute_enhanced_command(device, action, location, parameters)
+                            result = await execute_enhanced_command(device, action, location, parameters, batch=batch)
                             results.append(result)
                     
+                    await send_control_batch(batch)
                     await websocket.send_json({
                         "type": "control_results",
                         "results": results,
                         "timestamp": time.time()
                     })
                 
+                elif command_type == "ack":
+                    # Batched per-frame acknowledgement from firmware; no reply to save airtime
+                    device_id = message.get("device_id")
+                    if device_id:
+                        client_device_id = device_id
+                    for ack in message.get("acks", []):
+                        handle_command_ack(device_id, ack)
+                
+                elif command_type == "subscribe":
+                    rooms = message.get("rooms") or []
+                    types = message.get("types") or []
+                    client_subscriptions[client_id] = {
+                        "rooms": set(rooms),
+                        "types": set(types),
+                        "acks": bool(message.get("acks"))  # node acks device_update by seq
+                    }
+                    logger.info(f"Client {client_id} subscribed to rooms={rooms} types={types}")
+                    await websocket.send_json({
+                        "type": "subscribed",
+                        "rooms": rooms,
+                        "types": types,
+                        "timestamp": time.time()
+                    })
+                
                 elif command_type == "get_sensors":
                     location = message.get("location")
                     if location:
@@ -756,11 +1172,43 @@ async def websocket_endpoint(websocket: WebSocket):
                         })
                 
                 elif command_type == "ping":
+                    device_id = message.get("device_id")
+                    if device_id:
+                        client_device_id = device_id
+                        # Update in place so the last telemetry frame survives pings
+                        node = node_status.setdefault(device_id, {})
+                        # Multi-room hubs list the rooms they serve; location is just "hub"
+                        if isinstance(message.get("rooms"), list):
+                            node["rooms"] = message["rooms"]
+                        node.update({
+                            "location": message.get("location"),
+                            "sensor_status": message.get("sensor_status"),
+                            "free_heap": message.get("free_heap"),
+                            "max_block": message.get("max_block"),
+                            "heap_frag": message.get("heap_frag"),
+                            "last_seen": time.time()
+                        })
                     await websocket.send_json({
                         "type": "pong",
                         "timestamp": time.time()
                     })
                 
+                elif command_type == "telemetry":
+                    # Periodic firmware telemetry (loop latency histogram, per-channel
+                    # timing, heap, reconnects); no reply to save airtime
+                    device_id = message.get("device_id")
+                    if device_id:
+                        client_device_id = device_id
+                        telemetry = {k: v for k, v in message.items() if k not in ("type", "device_id")}
+                        telemetry["received_at"] = time.time()
+                        node = node_status.setdefault(device_id, {})
+                        node["location"] = message.get("location")
+                        node["last_seen"] = telemetry["received_at"]
+                        node["telemetry"] = telemetry
+                        loop_stats = telemetry.get("loop", {})
+                        logger.debug(f"Telemetry from {device_id}: loop max {loop_stats.get('max_us')} us, "
+                                     f"ws send failures {telemetry.get('ws_send_failures')}")
+                
                 elif command_type == "get_status":
                     await websocket.send_json({
                         "type": "status_response",
@@ -791,6 +1239,7 @@ async def websocket_endpoint(websocket: WebSocket):
     finally:
         if client_id in connected_devices:
             del connected_devices[client_id]
+        client_subscriptions.pop(client_id, None)
 
 # Simulate realistic environmental changes
 async def simulate_environmental_changes():
@@ -910,6 +1359,7 @@ async def shutdown_event():
             pass
     
     connected_devices.clear()
+    client_subscriptions.clear()
     
     logger.info("✅ IoT Control Service shutdown complete")
 
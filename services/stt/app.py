@@ -1,4 +1,5 @@
 import os
+import json
 import logging
 import asyncio
 import socket
@@ -219,23 +220,186 @@ async def upload_pcm_audio(
             content={"error": f"Processing error: {str(e)}"}
         )
 
-# WebSocket endpoint for real-time audio streaming (future feature)
+# Streaming audio session limits
+STREAM_MAX_SECONDS = float(os.getenv("STREAM_MAX_SECONDS", 30))
+
+# IMA-ADPCM as encoded by Arduino/esp32/esp_audio_client/audio_codec.h:
+# one block per 20 ms frame, [int16 predictor][uint8 step index][pad] + 4-bit codes, low nibble first
+ADPCM_BLOCK_HEADER = 4
+ADPCM_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+]
+ADPCM_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+SUPPORTED_CODECS = ("pcm16", "ima_adpcm")
+DEFAULT_FRAME_MS = 20
+
+def adpcm_block_bytes(control: dict) -> int:
+    """Block size from the start message; older clients only send frame_ms"""
+    if control.get("frame_bytes"):
+        return int(control["frame_bytes"])
+    frame_ms = int(control.get("frame_ms", DEFAULT_FRAME_MS))
+    return ADPCM_BLOCK_HEADER + SAMPLE_RATE * frame_ms // 1000 // 2
+
+def decode_ima_adpcm(data: bytes, block_bytes: int) -> bytes:
+    """Decode a run of self-contained IMA-ADPCM blocks to int16 PCM bytes"""
+    if block_bytes <= ADPCM_BLOCK_HEADER or len(data) % block_bytes:
+        raise ValueError(f"ADPCM payload of {len(data)} bytes is not a multiple of {block_bytes}")
+
+    samples = np.empty((len(data) // block_bytes) * (block_bytes - ADPCM_BLOCK_HEADER) * 2, dtype=np.int16)
+    out = 0
+    for offset in range(0, len(data), block_bytes):
+        predictor = int.from_bytes(data[offset:offset + 2], "little", signed=True)
+        index = min(data[offset + 2], 88)
+        for byte in data[offset + ADPCM_BLOCK_HEADER:offset + block_bytes]:
+            for code in (byte & 0x0F, byte >> 4):
+                step = ADPCM_STEP_TABLE[index]
+                delta = step >> 3
+                if code & 4:
+                    delta += step
+                if code & 2:
+                    delta += step >> 1
+                if code & 1:
+                    delta += step >> 2
+                predictor = predictor - delta if code & 8 else predictor + delta
+                predictor = max(-32768, min(32767, predictor))
+                index = max(0, min(88, index + ADPCM_INDEX_TABLE[code & 7]))
+                samples[out] = predictor
+                out += 1
+    return samples.tobytes()
+
+def transcribe_pcm16(pcm_data: bytes) -> str:
+    """Transcribe raw 16 kHz mono int16 PCM without going through a WAV file"""
+    audio = np.frombuffer(pcm_data, dtype=np.int16).astype(np.float32) / 32768.0
+    result = model.transcribe(audio)
+    return result["text"].strip()
+
+# WebSocket endpoint for real-time audio streaming
 @app.websocket("/ws")
 async def websocket_endpoint(websocket: WebSocket):
-    """WebSocket endpoint for real-time audio streaming"""
+    """WebSocket endpoint for real-time audio streaming
+
+    Protocol (see Arduino/esp32/esp_audio_client):
+      {"type": "start", "device_id", "location", "sample_rate", "frame_ms", "codec", "frame_bytes"}
+      binary messages with pcm16 audio or whole IMA-ADPCM blocks of frame_bytes each
+      (frame_bytes defaults to one block per frame_ms of audio)
+      {"type": "stop"} -> {"type": "transcript", "text", "audio_ms", "stt_ms", "decode_ms"}
+    """
     await websocket.accept()
     logger.info("WebSocket client connected")
-    
+
+    session = None
+    buffer = bytearray()
+    decode_seconds = 0.0
+
+    async def finish_session():
+        nonlocal session, decode_seconds
+        if session is None:
+            return
+        current, session = session, None
+        pcm_data = bytes(buffer)
+        buffer.clear()
+        decode_ms = int(decode_seconds * 1000)
+        decode_seconds = 0.0
+
+        audio_ms = int(len(pcm_data) / 2 * 1000 / current["sample_rate"])
+        if not pcm_data:
+            await websocket.send_json({"type": "transcript", "text": "", "audio_ms": 0, "stt_ms": 0, "decode_ms": 0})
+            return
+
+        stt_start = time.time()
+        loop = asyncio.get_event_loop()
+        transcription = await loop.run_in_executor(None, transcribe_pcm16, pcm_data)
+        stt_ms = int((time.time() - stt_start) * 1000)
+        logger.info(f"Stream transcription ({audio_ms} ms {current['codec']} audio, "
+                    f"{decode_ms} ms decode, {stt_ms} ms STT): {transcription}")
+
+        await websocket.send_json({
+            "type": "transcript",
+            "text": transcription,
+            "audio_ms": audio_ms,
+            "stt_ms": stt_ms,
+            "decode_ms": decode_ms
+        })
+
+        if transcription and transcription.lower() not in ["", " ", "blank"]:
+            await send_to_coordinator(transcription, current["device_id"], current["location"])
+
     try:
         while True:
-            # Receive audio data
-            data = await websocket.receive_bytes()
-            
-            # Process audio chunk (placeholder for future implementation)
-            # For now, just echo back a message
-            await websocket.send_text("Audio chunk received")
-            
+            message = await websocket.receive()
+            if message["type"] == "websocket.disconnect":
+                break
+
+            if message.get("bytes") is not None:
+                if session is None:
+                    continue
+                if session["codec"] == "ima_adpcm":
+                    # Pure-Python decode runs in the thread pool so other connections keep being served
+                    decode_start = time.time()
+                    try:
+                        loop = asyncio.get_event_loop()
+                        buffer.extend(await loop.run_in_executor(
+                            None, decode_ima_adpcm, message["bytes"], session["frame_bytes"]))
+                    except ValueError as e:
+                        logger.warning(f"Dropping chunk from {session['device_id']}: {str(e)}")
+                        continue
+                    decode_seconds += time.time() - decode_start
+                else:
+                    buffer.extend(message["bytes"])
+                if len(buffer) >= session["max_bytes"]:
+                    logger.info(f"Stream from {session['device_id']} reached {STREAM_MAX_SECONDS}s, stopping")
+                    await finish_session()
+                continue
+
+            try:
+                control = json.loads(message.get("text") or "")
+            except ValueError:
+                await websocket.send_json({"type": "error", "message": "invalid JSON"})
+                continue
+
+            command = control.get("type")
+            if command == "start":
+                sample_rate = int(control.get("sample_rate", SAMPLE_RATE))
+                codec = control.get("codec", "pcm16")
+                if codec not in SUPPORTED_CODECS or sample_rate != SAMPLE_RATE:
+                    await websocket.send_json({"type": "error", "message": "unsupported audio format"})
+                    continue
+                frame_bytes = adpcm_block_bytes(control) if codec == "ima_adpcm" else 0
+                if codec == "ima_adpcm" and frame_bytes <= ADPCM_BLOCK_HEADER:
+                    await websocket.send_json({"type": "error", "message": f"invalid ADPCM frame_bytes: {frame_bytes}"})
+                    continue
+                buffer.clear()
+                decode_seconds = 0.0
+                session = {
+                    "codec": codec,
+                    "frame_bytes": frame_bytes,
+                    "device_id": control.get("device_id"),
+                    "location": control.get("location", "living_room"),
+                    "sample_rate": sample_rate,
+                    "max_bytes": int(STREAM_MAX_SECONDS * sample_rate) * 2
+                }
+                logger.info(f"Stream started: {session['device_id']} ({session['location']}, {codec})")
+            elif command == "stop":
+                await finish_session()
+
     except WebSocketDisconnect:
+        pass
+    finally:
+        # Transcribe whatever arrived before the client dropped
+        if session is not None and buffer:
+            try:
+                pcm_data = bytes(buffer)
+                loop = asyncio.get_event_loop()
+                transcription = await loop.run_in_executor(None, transcribe_pcm16, pcm_data)
+                if transcription:
+                    await send_to_coordinator(transcription, session["device_id"], session["location"])
+            except Exception as e:
+                logger.error(f"Error finishing dropped stream: {str(e)}")
         logger.info("WebSocket client disconnected")
 
 # UDP server for real-time audio (alternative to WebSocket)
@@ -264,7 +428,7 @@ class UDPServerProtocol:
         # TODO: Implement audio processing
 
 # Send transcribed text to Coordinator
-async def send_to_coordinator(text: str, device_id: str = None):
+async def send_to_coordinator(text: str, device_id: str = None, location: str = "living_room"):
     """Send transcribed text to coordinator for processing"""
     try:
         coordinator_url = f"http://{COORDINATOR_HOST}:{COORDINATOR_PORT}/process_text"
@@ -278,7 +442,7 @@ async def send_to_coordinator(text: str, device_id: str = None):
         # Add device_id if provided
         if device_id:
             payload["device_id"] = device_id
-            payload["location"] = "living_room"  # Default location
+            payload["location"] = location
         
         logger.info(f"Sending to coordinator: {text[:50]}...")
         